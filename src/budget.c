@@ -0,0 +1,51 @@
+/* * * * * * * * *
+ * Memory budget: the most memory any one table may grow to take, set at
+ * runtime, in place of a fixed cap on the size of a table
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+
+#include "budget.h"
+
+// the budget set with set_memory_budget, or 0 for the default. it is only
+// set before tables are created, so threads building tables can read it
+static int64 budget = 0 ;
+
+/* * * *
+ * helper functions
+ */
+
+// the machine's physical memory in bytes, or as much as can be addressed if
+// it can't be found
+static int64 physical_memory(void) {
+	long npages = sysconf(_SC_PHYS_PAGES) ;
+	long pagesize = sysconf(_SC_PAGESIZE) ;
+	if (npages <= 0 || pagesize <= 0) {
+		return (int64)-1 ;
+	}
+	return (int64)npages * pagesize ;
+}
+
+/* * * *
+ * main functions
+ */
+
+// sets the most memory any one table may grow to take, in bytes, or restores
+// the default if bytes is 0
+void set_memory_budget(int64 bytes) {
+	budget = bytes ;
+}
+
+// the most memory any one table may grow to take, in bytes
+int64 memory_budget(void) {
+	return budget ? budget : physical_memory() ;
+}
+
+// checks whether a table taking the given number of bytes is within budget
+bool within_memory_budget(int64 bytes) {
+	return bytes <= memory_budget() ;
+}
@@ -0,0 +1,31 @@
+/* * * * * * * * *
+ * Memory budget: the most memory any one table may grow to take, set at
+ * runtime, in place of a fixed cap on the size of a table
+ *
+ * each table estimates the memory it would take before it grows its largest
+ * parts (a cuckoo table's slots, an extendible table's table of pointers and
+ * buckets), and fails with an error if that would be over budget. n-key
+ * extendible tables instead stop splitting buckets at the budget, and put
+ * further keys in overflow pages, which the budget doesn't count
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdbool.h>
+#include "inthash.h"
+
+// sets the most memory any one table may grow to take, in bytes, or restores
+// the default (the machine's physical memory) if bytes is 0
+// set before creating any tables, as tables don't shrink to fit
+void set_memory_budget(int64 bytes) ;
+
+// the most memory any one table may grow to take, in bytes
+int64 memory_budget(void) ;
+
+// checks whether a table taking the given number of bytes is within budget
+bool within_memory_budget(int64 bytes) ;
+
+#endif
@@ -0,0 +1,495 @@
+/* * * * * * * * *
+ * Hash diagnostics program:
+ * reads a set of keys and reports how a hash function spreads them, to help
+ * choose hash functions and bucket sizes before loading a data set: slot
+ * occupancy, extendible table depths and the keys forcing the deepest
+ * splits, and cuckoo cycles at a target load against ideal random hashing
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#include   <stdio.h>
+#include  <stdlib.h>
+#include <stdbool.h>
+#include  <string.h>
+#include  <getopt.h>
+#include    <math.h>
+#include   <ctype.h>
+#include  <assert.h>
+
+#include "inthash.h"
+
+/* cli options */
+typedef struct options {
+	int hash ;          // which hash function to examine (1 to 4)
+	int bucketsize ;    // keys per bucket of an extendible table
+	double load ;       // load factor of a two-table cuckoo table
+	int nshow ;         // most keys to show from the deepest buckets
+	char *key_path ;    // file of keys, or NULL for stdin
+} Options ;
+
+Options get_options(int argc, char** argv) ;
+/* ------------ */
+
+// the hash functions, by number
+typedef int64 (*HashFunction)(Key key) ;
+static const HashFunction hashes[] = { h1, h2, h3, h4 } ;
+
+// hash values are 64 bits wide, so no two keys share more low bits than this
+#define HASH_BITS 64
+
+// occupancies of at least this many keys per slot are counted together
+#define MAX_OCCUPANCY 8
+
+// number of ideal random hashings to compare cuckoo cycles against
+#define RANDOM_TRIALS 16
+
+#define MAX_LINE_LEN 80
+
+/* extendible depths */
+typedef struct hashed_key {
+	int64 reversed ;    // hash value with its bits reversed
+	int64 hash ;
+	Key key ;
+} HashedKey ;
+
+// a bucket an extendible table would end up with: a run of the keys sorted
+// by reversed hash value, which all share their lowest depth bits
+typedef struct leaf {
+	int first ;
+	int last ;
+	int depth ;
+} Leaf ;
+
+typedef struct leaves {
+	Leaf *leaves ;
+	int nleaves ;
+	int capacity ;
+} Leaves ;
+
+void split_keys(HashedKey *keys, int first, int last, int depth,
+  int bucketsize, Leaves *leaves) ;
+/* ----------------- */
+
+/* cuckoo cycles */
+// the components of a cuckoo graph, whose vertices are slots and whose edges
+// are keys joining their two slots. a component with as many keys as slots
+// has a cycle, and one with more keys than slots can't be placed at all
+typedef struct cycles {
+	int ncycles ;       // components with exactly one cycle
+	int noverfull ;     // components with more keys than slots
+	int nstranded ;     // keys in overfull components
+} Cycles ;
+
+Cycles count_cycles(const int *left, const int *right, int nkeys, int size) ;
+/* ------------- */
+
+int read_keys(FILE *file, Key **keys) ;
+int compare_keys(const void *a, const void *b) ;
+int compare_reversed(const void *a, const void *b) ;
+int64 reverse_bits(int64 x) ;
+unsigned int next_random(unsigned int *state) ;
+
+int main(int argc, char **argv) {
+	Options options = get_options(argc, argv) ;
+	HashFunction hash = hashes[options.hash - 1] ;
+
+	FILE *file = options.key_path ? fopen(options.key_path, "r") : stdin ;
+	if (!file) {
+		fprintf(stderr, "could not open key file '%s'\n", options.key_path) ;
+		exit(EXIT_FAILURE) ;
+	}
+	Key *keys ;
+	int nread = read_keys(file, &keys) ;
+	if (file != stdin) {
+		fclose(file) ;
+	}
+
+	// only distinct keys go in a table
+	qsort(keys, nread, sizeof *keys, compare_keys) ;
+	int nkeys = 0 ;
+	int i ;
+	for (i=0; i<nread; i++) {
+		if (nkeys == 0 || keys[i] != keys[nkeys-1]) {
+			keys[nkeys++] = keys[i] ;
+		}
+	}
+	printf("----- keys -----\n") ;
+	printf("keys read         :\t%d\n", nread) ;
+	printf("distinct keys     :\t%d\n", nkeys) ;
+	printf("hash function     :\th%d\n", options.hash) ;
+	if (nkeys == 0) {
+		free(keys) ;
+		return 0 ;
+	}
+
+	/* slot occupancy: keys per slot of a power-of-two table addressed by
+	   the low bits of the hash value, against a Poisson distribution */
+	int size = 1 ;
+	while (size < nkeys) {
+		size *= 2 ;
+	}
+	int *slots = calloc(size, sizeof *slots) ;
+	assert(slots) ;
+	for (i=0; i<nkeys; i++) {
+		slots[hash(keys[i]) & (size - 1)]++ ;
+	}
+	int64 occupancy[MAX_OCCUPANCY + 1] = { 0 } ;
+	int fullest = 0 ;
+	for (i=0; i<size; i++) {
+		int n = slots[i] < MAX_OCCUPANCY ? slots[i] : MAX_OCCUPANCY ;
+		occupancy[n]++ ;
+		if (slots[i] > fullest) {
+			fullest = slots[i] ;
+		}
+	}
+	free(slots) ;
+
+	printf("\n----- slot occupancy -----\n") ;
+	printf("slots             :\t%d\n", size) ;
+	printf("fullest slot      :\t%d keys\n", fullest) ;
+	printf("  keys   slots   expected\n") ;
+	double mean = (double)nkeys / size ;
+	double poisson = exp(-mean) ;
+	double tail = 1 ;
+	for (i=0; i<=MAX_OCCUPANCY; i++) {
+		double expected = i < MAX_OCCUPANCY ? poisson : tail ;
+		printf("  %s%-3d  %-7llu %.1f\n", i < MAX_OCCUPANCY ? " " : ">=", i,
+		  occupancy[i], expected * size) ;
+		tail -= poisson ;
+		poisson *= mean / (i + 1) ;
+	}
+	printf("   --- end slot occupancy ---\n") ;
+	/* ---------------------------------------------------------------- */
+
+	/* extendible depths: the buckets left by splitting on successive low
+	   bits of the hash value until each holds at most bucketsize keys */
+	HashedKey *hashed = malloc((sizeof *hashed) * nkeys) ;
+	assert(hashed) ;
+	for (i=0; i<nkeys; i++) {
+		hashed[i].hash = hash(keys[i]) ;
+		hashed[i].reversed = reverse_bits(hashed[i].hash) ;
+		hashed[i].key = keys[i] ;
+	}
+	qsort(hashed, nkeys, sizeof *hashed, compare_reversed) ;
+
+	Leaves leaves = { .nleaves = 0, .capacity = 16 } ;
+	leaves.leaves = malloc((sizeof *leaves.leaves) * leaves.capacity) ;
+	assert(leaves.leaves) ;
+	split_keys(hashed, 0, nkeys, 0, options.bucketsize, &leaves) ;
+
+	int64 depths[HASH_BITS + 1] = { 0 } ;
+	int global_depth = 0 ;
+	int nunsplittable = 0 ;
+	for (i=0; i<leaves.nleaves; i++) {
+		Leaf *leaf = &leaves.leaves[i] ;
+		depths[leaf->depth]++ ;
+		if (leaf->depth > global_depth) {
+			global_depth = leaf->depth ;
+		}
+		nunsplittable += leaf->last - leaf->first > options.bucketsize ;
+	}
+
+	printf("\n----- extendible depths -----\n") ;
+	printf("bucket size       :\t%d\n", options.bucketsize) ;
+	printf("buckets           :\t%d\n", leaves.nleaves) ;
+	printf("global depth      :\t%d\n", global_depth) ;
+	printf("pointers/bucket   :\t%.2f\n",
+	  (double)((int64)1 << global_depth) / leaves.nleaves) ;
+	printf("space usage factor:\t%.3f%%\n",
+	  nkeys * 100.0 / ((double)leaves.nleaves * options.bucketsize)) ;
+	if (nunsplittable > 0) {
+		printf("unsplittable      :\t%d buckets share a whole hash value\n",
+		  nunsplittable) ;
+	}
+	printf("  depth  buckets\n") ;
+	for (i=0; i<=global_depth; i++) {
+		if (depths[i] > 0) {
+			printf("  %-5d  %llu%s\n", i, depths[i],
+			  i == global_depth ? "  <- global depth" : "") ;
+		}
+	}
+
+	// the deepest buckets set the global depth, and so the directory size
+	printf("deepest buckets' keys:\n") ;
+	printf("                 key | hash               | low bits\n") ;
+	int shown = 0 ;
+	for (i=0; i<leaves.nleaves && shown<options.nshow; i++) {
+		Leaf *leaf = &leaves.leaves[i] ;
+		if (leaf->depth != global_depth) {
+			continue ;
+		}
+		int k ;
+		for (k=leaf->first; k<leaf->last && shown<options.nshow; k++) {
+			char keystr[KEY_STR_LEN] ;
+			char bits[HASH_BITS + 1] ;
+			int b ;
+			for (b=0; b<global_depth; b++) {
+				bits[b] = '0' + ((hashed[k].hash >> (global_depth-1-b)) & 1) ;
+			}
+			bits[global_depth] = '\0' ;
+			printf(" %19s | 0x%016llx | %s\n", keytostr(hashed[k].key, keystr),
+			  hashed[k].hash, bits) ;
+			shown++ ;
+		}
+	}
+	printf("   --- end extendible depths ---\n") ;
+	free(leaves.leaves) ;
+	free(hashed) ;
+	/* -------------------------------------------------------------- */
+
+	/* cuckoo cycles: the graph of a two-table cuckoo table at the target
+	   load, addressed by h1 and h2, against random addresses */
+	int tablesize = ceil(nkeys / (2 * options.load)) ;
+	int *left = malloc((sizeof *left) * nkeys) ;
+	int *right = malloc((sizeof *right) * nkeys) ;
+	assert(left && right) ;
+	for (i=0; i<nkeys; i++) {
+		left[i] = h1(keys[i]) % tablesize ;
+		right[i] = h2(keys[i]) % tablesize ;
+	}
+	Cycles actual = count_cycles(left, right, nkeys, tablesize) ;
+
+	double random_cycles = 0, random_overfull = 0 ;
+	int nfailed = 0 ;
+	unsigned int state = 2463534242u ;
+	int trial ;
+	for (trial=0; trial<RANDOM_TRIALS; trial++) {
+		for (i=0; i<nkeys; i++) {
+			left[i] = next_random(&state) % tablesize ;
+			right[i] = next_random(&state) % tablesize ;
+		}
+		Cycles ideal = count_cycles(left, right, nkeys, tablesize) ;
+		random_cycles += ideal.ncycles ;
+		random_overfull += ideal.noverfull ;
+		nfailed += ideal.noverfull > 0 ;
+	}
+	free(left) ;
+	free(right) ;
+
+	printf("\n----- cuckoo cycles (h1, h2) -----\n") ;
+	printf("target load       :\t%.3f\n", options.load) ;
+	printf("slots per table   :\t%d\n", tablesize) ;
+	printf("                        h1, h2     random\n") ;
+	printf("cycles            :\t%-10d %.1f\n", actual.ncycles,
+	  random_cycles / RANDOM_TRIALS) ;
+	printf("overfull groups   :\t%-10d %.1f\n", actual.noverfull,
+	  random_overfull / RANDOM_TRIALS) ;
+	printf("stranded keys     :\t%d\n", actual.nstranded) ;
+	printf("failure chance    :\t%-10s %.3f\n",
+	  actual.noverfull > 0 ? "fails" : "fits",
+	  (double)nfailed / RANDOM_TRIALS) ;
+	printf("   --- end cuckoo cycles ---\n") ;
+	/* ----------------------------------------------------------- */
+
+	free(keys) ;
+	return 0 ;
+}
+
+// splits the keys first to last (sorted by reversed hash value), which share
+// their lowest depth bits, on their next bit until each run fits a bucket,
+// recording each run as a leaf
+void split_keys(HashedKey *keys, int first, int last, int depth,
+  int bucketsize, Leaves *leaves) {
+	if (last - first <= bucketsize || depth == HASH_BITS) {
+		if (leaves->nleaves == leaves->capacity) {
+			leaves->capacity *= 2 ;
+			leaves->leaves = realloc(leaves->leaves,
+			  (sizeof *leaves->leaves) * leaves->capacity) ;
+			assert(leaves->leaves) ;
+		}
+		Leaf leaf = { .first = first, .last = last, .depth = depth } ;
+		leaves->leaves[leaves->nleaves++] = leaf ;
+		return ;
+	}
+
+	// keys with a 0 at this bit sort first
+	int middle = first ;
+	while (middle < last && !((keys[middle].hash >> depth) & 1)) {
+		middle++ ;
+	}
+	split_keys(keys, first, middle, depth + 1, bucketsize, leaves) ;
+	split_keys(keys, middle, last, depth + 1, bucketsize, leaves) ;
+}
+
+// finds the components of a cuckoo graph, with the slots of the first table
+// numbered from 0 and the second from size, by union-find
+Cycles count_cycles(const int *left, const int *right, int nkeys, int size) {
+	int nslots = 2 * size ;
+	int *parent = malloc((sizeof *parent) * nslots) ;
+	int *nedges = calloc(nslots, sizeof *nedges) ;
+	int *nvertices = malloc((sizeof *nvertices) * nslots) ;
+	assert(parent && nedges && nvertices) ;
+	int i ;
+	for (i=0; i<nslots; i++) {
+		parent[i] = i ;
+		nvertices[i] = 1 ;
+	}
+
+	for (i=0; i<nkeys; i++) {
+		int a = left[i], b = size + right[i] ;
+		while (parent[a] != a) {
+			a = parent[a] = parent[parent[a]] ;
+		}
+		while (parent[b] != b) {
+			b = parent[b] = parent[parent[b]] ;
+		}
+		if (a != b) {
+			if (nvertices[a] < nvertices[b]) {
+				int swap = a ;
+				a = b ;
+				b = swap ;
+			}
+			parent[b] = a ;
+			nvertices[a] += nvertices[b] ;
+			nedges[a] += nedges[b] ;
+		}
+		nedges[a]++ ;
+	}
+
+	Cycles cycles = { 0 } ;
+	for (i=0; i<nslots; i++) {
+		if (parent[i] != i) {
+			continue ;
+		}
+		if (nedges[i] == nvertices[i]) {
+			cycles.ncycles++ ;
+		} else if (nedges[i] > nvertices[i]) {
+			cycles.noverfull++ ;
+			cycles.nstranded += nedges[i] ;
+		}
+	}
+
+	free(parent) ;
+	free(nedges) ;
+	free(nvertices) ;
+	return cycles ;
+}
+
+// reads keys from file, one per line, into a new array at *keys. lines of
+// interpreter commands are also accepted, taking the keys of inserts only
+// returns the number of keys read
+int read_keys(FILE *file, Key **keys) {
+	int capacity = 1024, nkeys = 0 ;
+	*keys = malloc((sizeof **keys) * capacity) ;
+	assert(*keys) ;
+
+	char line[MAX_LINE_LEN] ;
+	while (fgets(line, MAX_LINE_LEN, file)) {
+		char *start = line ;
+		if (isalpha((unsigned char)*start)) {
+			if (*start != 'i') {
+				continue ;
+			}
+			start++ ;
+		}
+
+		Key key ;
+		if (!strtokey(start, &key)) {
+			continue ;
+		}
+		if (nkeys == capacity) {
+			capacity *= 2 ;
+			*keys = realloc(*keys, (sizeof **keys) * capacity) ;
+			assert(*keys) ;
+		}
+		(*keys)[nkeys++] = key ;
+	}
+	return nkeys ;
+}
+
+// orders keys for qsort
+int compare_keys(const void *a, const void *b) {
+	Key x = *(const Key *)a, y = *(const Key *)b ;
+	return (x > y) - (x < y) ;
+}
+
+// orders hashed keys by reversed hash value for qsort, so that keys sharing
+// low hash bits sort together
+int compare_reversed(const void *a, const void *b) {
+	int64 x = ((const HashedKey *)a)->reversed ;
+	int64 y = ((const HashedKey *)b)->reversed ;
+	return (x > y) - (x < y) ;
+}
+
+// reverses the order of the 64 bits of x
+int64 reverse_bits(int64 x) {
+	int64 reversed = 0 ;
+	int b ;
+	for (b=0; b<64; b++) {
+		reversed = (reversed << 1) | ((x >> b) & 1) ;
+	}
+	return reversed ;
+}
+
+// the next value of a xorshift random number generator
+unsigned int next_random(unsigned int *state) {
+	*state ^= *state << 13 ;
+	*state ^= *state >> 17 ;
+	*state ^= *state << 5 ;
+	return *state ;
+}
+
+// scans command line arguments for program options,
+// prints usage info and exits if commands are missing or otherwise invalid
+Options get_options(int argc, char** argv) {
+
+	// create the Options structure with defaults
+	Options options = { .hash = 1, .bucketsize = 4, .load = 0.45,
+		.nshow = 10, .key_path = NULL } ;
+
+	// scan inputs by flag
+	int option ;
+	while ((option = getopt(argc, argv, "f:s:L:k:")) != -1) {
+		switch (option) {
+			// set hash function to examine
+			case 'f':
+				options.hash = atoi(optarg) ;
+				break ;
+			// set extendible bucket size
+			case 's':
+				options.bucketsize = atoi(optarg) ;
+				break ;
+			// set cuckoo load factor
+			case 'L':
+				options.load = atof(optarg) ;
+				break ;
+			// set number of deepest keys to show
+			case 'k':
+				options.nshow = atoi(optarg) ;
+				break ;
+			default:
+				break ;
+		}
+	}
+	if (optind < argc) {
+		options.key_path = argv[optind] ;
+	}
+
+	bool valid = true ;
+
+	if(options.hash < 1 || options.hash > 4) {
+		fprintf(stderr,
+			"please specify a hash function (1 to 4) using the -f flag\n") ;
+		valid = false ;
+	}
+	if(options.bucketsize <= 0) {
+		fprintf(stderr,
+			"please specify bucket size (>0) using the -s flag\n") ;
+		valid = false ;
+	}
+	if(options.load <= 0 || options.load > 1) {
+		fprintf(stderr,
+			"please specify a cuckoo load factor in (0, 1] using -L\n") ;
+		valid = false ;
+	}
+
+	if(!valid) {
+		fprintf(stderr,
+			"usage: %s [-f hash] [-s bucketsize] [-L load] [-k keys] "
+			"[keyfile]\n", argv[0]) ;
+		exit(EXIT_FAILURE) ;
+	}
+
+	return options ;
+}
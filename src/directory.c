@@ -0,0 +1,121 @@
+/* * * * * * * * *
+ * Segmented directories: the tables of pointers of extendible hash tables,
+ * kept as a small top-level array of fixed-size segments of entries, so that
+ * doubling a directory never reallocates or copies its entries
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "directory.h"
+
+/* * * *
+ * helper functions
+ */
+
+// creates a new segment with a single reference and unset entries
+static DirectorySegment *new_segment(void) {
+	DirectorySegment *segment = malloc(sizeof *segment) ;
+	assert(segment) ;
+	segment->refs = 1 ;
+	return segment ;
+}
+
+// gives the nth reference of a directory a segment of its own, copying the
+// one it refers to if that is shared
+// returns the directory's own segment
+static DirectorySegment *own_segment(Directory *directory, int64 n) {
+	DirectorySegment *segment = directory->segments[n] ;
+	if (segment->refs == 1) {
+		return segment ;
+	}
+
+	DirectorySegment *copy = new_segment() ;
+	memcpy(copy->entries, segment->entries, sizeof copy->entries) ;
+	segment->refs-- ;
+	directory->segments[n] = copy ;
+	return copy ;
+}
+
+/* * * *
+ * main functions
+ */
+
+// initialises a directory of size entries (a power of two), which are all
+// to be set before they are read
+void init_directory(Directory *directory, int64 size) {
+	directory->nsegments = size > DIRECTORY_SEGMENT_SIZE
+	  ? size / DIRECTORY_SEGMENT_SIZE : 1 ;
+	directory->segments = malloc((sizeof *directory->segments) *
+	  directory->nsegments) ;
+	assert(directory->segments) ;
+
+	int64 i ;
+	for (i=0; i<directory->nsegments; i++) {
+		directory->segments[i] = new_segment() ;
+	}
+}
+
+// releases a directory's references to its segments, freeing those no other
+// directory refers to
+void free_directory(Directory *directory) {
+	int64 i ;
+	for (i=0; i<directory->nsegments; i++) {
+		if (--directory->segments[i]->refs == 0) {
+			free(directory->segments[i]) ;
+		}
+	}
+	free(directory->segments) ;
+}
+
+// doubles a directory of size entries, so that each entry at address + size
+// is the entry at address. only the top-level array grows, unless the
+// entries all fit in one segment
+void double_directory(Directory *directory, int64 size) {
+
+	// a directory within one segment copies its entries down the segment
+	if (size < DIRECTORY_SEGMENT_SIZE) {
+		DirectorySegment *segment = own_segment(directory, 0) ;
+		memcpy(segment->entries + size, segment->entries,
+		  (sizeof *segment->entries) * size) ;
+		return ;
+	}
+
+	// otherwise the new half of the top-level array refers to the same
+	// segments as the old half
+	int64 n = directory->nsegments ;
+	directory->segments = realloc(directory->segments,
+	  (sizeof *directory->segments) * n * 2) ;
+	assert(directory->segments) ;
+	int64 i ;
+	for (i=0; i<n; i++) {
+		directory->segments[n + i] = directory->segments[i] ;
+		directory->segments[i]->refs++ ;
+	}
+	directory->nsegments = n * 2 ;
+}
+
+// initialises copy as a directory with the same entries as directory,
+// sharing all of its segments until either sets an entry in one
+void share_directory(Directory *copy, Directory *directory) {
+	copy->nsegments = directory->nsegments ;
+	copy->segments = malloc((sizeof *copy->segments) * copy->nsegments) ;
+	assert(copy->segments) ;
+
+	int64 i ;
+	for (i=0; i<copy->nsegments; i++) {
+		copy->segments[i] = directory->segments[i] ;
+		copy->segments[i]->refs++ ;
+	}
+}
+
+// sets the entry at address in a directory, first copying its segment if
+// it is shared
+void directory_set(Directory *directory, int64 address, void *entry) {
+	DirectorySegment *segment =
+	  own_segment(directory, address >> DIRECTORY_SEGMENT_BITS) ;
+	segment->entries[address & (DIRECTORY_SEGMENT_SIZE - 1)] = entry ;
+}
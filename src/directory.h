@@ -0,0 +1,66 @@
+/* * * * * * * * *
+ * Segmented directories: the tables of pointers of extendible hash tables,
+ * kept as a small top-level array of fixed-size segments of entries, so that
+ * doubling a directory never reallocates or copies its entries
+ *
+ * after a doubling, the second half of the top-level array refers to the
+ * same segments as the first half, since the entries there are the same. a
+ * segment with more than one reference is copied only when one of its
+ * entries is first set through one of them, so entries are materialised
+ * lazily, as the table changes them. a directory can also share all of its
+ * segments with a copy of itself in the same way
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include "inthash.h"
+
+// each segment holds 2^DIRECTORY_SEGMENT_BITS entries: 8KB of pointers
+#define DIRECTORY_SEGMENT_BITS 10
+#define DIRECTORY_SEGMENT_SIZE ((int64)1 << DIRECTORY_SEGMENT_BITS)
+
+// a run of a directory's entries, referred to refs times from the top-level
+// arrays of one or more directories
+typedef struct directory_segment {
+	int refs ;
+	void *entries[DIRECTORY_SEGMENT_SIZE] ;
+} DirectorySegment ;
+
+// a directory of a power of two entries, the first DIRECTORY_SEGMENT_SIZE of
+// which (or all, if fewer) are in the first segment, and so on
+typedef struct directory {
+	DirectorySegment **segments ;  // top-level array of segments
+	int64 nsegments ;   // number of segments referred to
+} Directory ;
+
+// initialises a directory of size entries (a power of two), which are all
+// to be set before they are read
+void init_directory(Directory *directory, int64 size) ;
+
+// releases a directory's references to its segments, freeing those no other
+// directory refers to
+void free_directory(Directory *directory) ;
+
+// doubles a directory of size entries, so that each entry at address + size
+// is the entry at address. only the top-level array grows, unless the
+// entries all fit in one segment
+void double_directory(Directory *directory, int64 size) ;
+
+// initialises copy as a directory with the same entries as directory,
+// sharing all of its segments until either sets an entry in one
+void share_directory(Directory *copy, Directory *directory) ;
+
+// sets the entry at address in a directory, first copying its segment if
+// it is shared
+void directory_set(Directory *directory, int64 address, void *entry) ;
+
+// the entry at address in a directory
+static inline void *directory_get(const Directory *directory, int64 address) {
+	return directory->segments[address >> DIRECTORY_SEGMENT_BITS]
+	  ->entries[address & (DIRECTORY_SEGMENT_SIZE - 1)] ;
+}
+
+#endif
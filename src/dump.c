@@ -0,0 +1,204 @@
+/* * * * * * * * *
+ * Table dumps: streaming output of a table's slots, or of an extendible
+ * table's directory, through a large buffer rather than a printf per slot
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#include  <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "dump.h"
+
+// records are buffered in memory and written out in blocks of this size
+#define DUMP_BUFFER_SIZE (1 << 20)
+
+// the longest a single record can be, in any format
+#define MAX_RECORD_LEN 128
+
+struct dump {
+	FILE *out ;
+	DumpOptions options ;
+	char *buffer ;
+	int used ;          // number of bytes of the buffer in use
+	bool header ;       // has the CSV header row been written?
+} ;
+
+/* * * *
+ * helper functions
+ */
+
+// makes room in a dump's buffer for another record
+static char *dump_space(Dump *dump) {
+	if (dump->used > DUMP_BUFFER_SIZE - MAX_RECORD_LEN) {
+		fwrite(dump->buffer, 1, dump->used, dump->out) ;
+		dump->used = 0 ;
+	}
+	return dump->buffer + dump->used ;
+}
+
+// appends n bytes of a field to a binary record at *record
+static void put_field(char **record, const void *field, int n) {
+	memcpy(*record, field, n) ;
+	*record += n ;
+}
+
+// appends the decimal digits of n to a text record at *record, right-aligned
+// in at least width characters
+static void put_number(char **record, int64 n, int width) {
+	char digits[24] ;
+	int ndigits = 0 ;
+	do {
+		digits[ndigits++] = '0' + n % 10 ;
+		n /= 10 ;
+	} while (n > 0) ;
+
+	while (width-- > ndigits) {
+		*(*record)++ = ' ' ;
+	}
+	while (ndigits > 0) {
+		*(*record)++ = digits[--ndigits] ;
+	}
+}
+
+// appends a string to a text record at *record
+static void put_string(char **record, const char *string) {
+	while (*string) {
+		*(*record)++ = *string++ ;
+	}
+}
+
+// writes a CSV dump's header row before its first record
+static void csv_header(Dump *dump, const char *columns) {
+	if (!dump->header) {
+		dump->used += sprintf(dump_space(dump), "%s\n", columns) ;
+		dump->header = true ;
+	}
+}
+
+/* * * *
+ * main functions
+ */
+
+// starts a dump to out with the given options
+Dump *new_dump(FILE *out, DumpOptions options) {
+	Dump *dump = malloc(sizeof *dump) ;
+	assert(dump) ;
+	dump->out = out ;
+	dump->options = options ;
+	dump->buffer = malloc(DUMP_BUFFER_SIZE) ;
+	assert(dump->buffer) ;
+	dump->used = 0 ;
+	dump->header = false ;
+
+	// anything already written to out comes first
+	fflush(out) ;
+	return dump ;
+}
+
+// the options a dump was started with
+DumpOptions dump_options(Dump *dump) {
+	return dump->options ;
+}
+
+// clamps a dump's range of addresses to a part with size addresses
+void dump_range(Dump *dump, int64 size, int64 *first, int64 *last) {
+	*first = dump->options.first < size ? dump->options.first : size ;
+	*last = dump->options.last < size ? dump->options.last : size ;
+	if (*last < *first) {
+		*last = *first ;
+	}
+}
+
+// starts a titled section of a dump, shown in text dumps only
+void dump_section(Dump *dump, const char *title) {
+	if (dump->options.format == DUMP_TEXT) {
+		dump->used += snprintf(dump_space(dump), MAX_RECORD_LEN,
+		  "--- %s ---\n", title) ;
+	}
+}
+
+// adds a slot to a dump, unless it is empty and only occupied slots are
+// being dumped
+void dump_slot(Dump *dump, int64 part, int64 address, bool occupied, Key key) {
+	if (!occupied && dump->options.occupied) {
+		return ;
+	}
+
+	// slots are most of a dump, so they are formatted by hand
+	char keystr[KEY_STR_LEN] ;
+	char kind = occupied ? 'k' : 'e' ;
+	Key none = 0 ;
+	bool text = dump->options.format == DUMP_TEXT ;
+	if (dump->options.format == DUMP_CSV) {
+		csv_header(dump, "part,address,key") ;
+	}
+	char *record = dump_space(dump) ;
+	char *start = record ;
+	switch (dump->options.format) {
+		case DUMP_TEXT:
+		case DUMP_CSV:
+			put_number(&record, part, text ? 9 : 0) ;
+			put_string(&record, text ? " | " : ",") ;
+			put_number(&record, address, text ? 9 : 0) ;
+			put_string(&record, text ? " | " : ",") ;
+			if (occupied) {
+				put_string(&record, keytostr(key, keystr)) ;
+			}
+			*record++ = '\n' ;
+			break ;
+
+		case DUMP_BINARY:
+			put_field(&record, &kind, 1) ;
+			put_field(&record, &part, sizeof part) ;
+			put_field(&record, &address, sizeof address) ;
+			put_field(&record, occupied ? &key : &none, sizeof key) ;
+			break ;
+	}
+	dump->used += record - start ;
+}
+
+// adds a bucket of an extendible table's directory to a dump
+void dump_bucket(Dump *dump, int64 part, int64 address, int depth,
+  int64 npointers, int nkeys) {
+	char *record ;
+	switch (dump->options.format) {
+		case DUMP_TEXT:
+			record = dump_space(dump) ;
+			dump->used += sprintf(record,
+			  "%9llu | %9llu | depth %2d | %9llu pointers | %d keys\n",
+			  part, address, depth, npointers, nkeys) ;
+			break ;
+
+		case DUMP_CSV:
+			csv_header(dump, "part,address,depth,pointers,keys") ;
+			record = dump_space(dump) ;
+			dump->used += sprintf(record, "%llu,%llu,%d,%llu,%d\n", part,
+			  address, depth, npointers, nkeys) ;
+			break ;
+
+		case DUMP_BINARY:
+			record = dump_space(dump) ;
+			char *start = record ;
+			char kind = 'b' ;
+			put_field(&record, &kind, 1) ;
+			put_field(&record, &part, sizeof part) ;
+			put_field(&record, &address, sizeof address) ;
+			put_field(&record, &depth, sizeof depth) ;
+			put_field(&record, &npointers, sizeof npointers) ;
+			put_field(&record, &nkeys, sizeof nkeys) ;
+			dump->used += record - start ;
+			break ;
+	}
+}
+
+// writes out the rest of a dump and frees it
+void free_dump(Dump *dump) {
+	assert(dump) ;
+	fwrite(dump->buffer, 1, dump->used, dump->out) ;
+	fflush(dump->out) ;
+	free(dump->buffer) ;
+	free(dump) ;
+}
@@ -0,0 +1,76 @@
+/* * * * * * * * *
+ * Table dumps: streaming output of a table's slots, or of an extendible
+ * table's directory, through a large buffer rather than a printf per slot,
+ * restricted to a range of addresses and optionally to occupied slots only
+ *
+ * a dump is a sequence of records of two kinds:
+ * - slots: a part, an address within it, and the key there if any. the part
+ *   is the inner table of a cuckoo or xuckoo table (0 for a cuckoo table's
+ *   stash), or the bucket of an extendible table, by its first address, in
+ *   which case the address is the slot's position in the bucket, counting on
+ *   through its overflow pages
+ * - buckets, for directory dumps of extendible tables: a part (the inner
+ *   table of a xuckoo table, or 1), a bucket's first address, its depth, the
+ *   number of directory pointers to it and the number of keys in it
+ *   (including its overflow pages)
+ *
+ * as text, each record is a line of columns separated by '|'. as CSV, each
+ * record is a row under a header row naming the columns. in binary, each
+ * record is a kind byte ('k' for an occupied slot, 'e' for an empty slot, or
+ * 'b' for a bucket) followed by its fields in the host's byte order: for a
+ * slot the part and address as 8-byte integers then the key in KEY_BITS/8
+ * bytes (zero if empty), and for a bucket the part and first address as
+ * 8-byte integers, the depth as a 4-byte integer, the number of pointers as
+ * an 8-byte integer and the number of keys as a 4-byte integer
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef DUMP_H
+#define DUMP_H
+
+#include   <stdio.h>
+#include <stdbool.h>
+#include "inthash.h"
+
+typedef enum dump_format {
+	DUMP_TEXT, DUMP_CSV, DUMP_BINARY
+} DumpFormat ;
+
+typedef struct dump_options {
+	DumpFormat format ;
+	int64 first ;       // first address to dump
+	int64 last ;        // address after the last to dump, clamped to the
+                        // table's size
+	bool occupied ;     // dump occupied slots only
+	bool directory ;    // dump extendible tables' directories rather than
+                        // their keys
+} DumpOptions ;
+
+typedef struct dump Dump ;
+
+// starts a dump to out with the given options
+Dump *new_dump(FILE *out, DumpOptions options) ;
+
+// the options a dump was started with
+DumpOptions dump_options(Dump *dump) ;
+
+// clamps a dump's range of addresses to a part with size addresses, into
+// *first and *last (exclusive)
+void dump_range(Dump *dump, int64 size, int64 *first, int64 *last) ;
+
+// starts a titled section of a dump, shown in text dumps only
+void dump_section(Dump *dump, const char *title) ;
+
+// adds a slot to a dump, unless it is empty and only occupied slots are
+// being dumped
+void dump_slot(Dump *dump, int64 part, int64 address, bool occupied, Key key) ;
+
+// adds a bucket of an extendible table's directory to a dump
+void dump_bucket(Dump *dump, int64 part, int64 address, int depth,
+  int64 npointers, int nkeys) ;
+
+// writes out the rest of a dump and frees it
+void free_dump(Dump *dump) ;
+
+#endif
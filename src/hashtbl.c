@@ -5,15 +5,20 @@
  * created by Maxim Kirkman <max.kirkman94@gmail.com>, following Matt Farrugia
  */
 
+#include  <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "hashtbl.h"
 
 #include "tables/cuckoo.h"
 #include "tables/xtndbln.h"
 #include "tables/xuckoo.h"
+#include "tables/xtndbls.h"
+#include "tables/xtndbld.h"
+#include "tables/xtndblc.h"
 
 // get a TableType constant from a string representation:
 TableType strtotype(char *str) {
@@ -26,34 +31,831 @@ TableType strtotype(char *str) {
 	if (strcmp("2", str) == 0 || strcmp("xuckoo",  str) == 0) {
 		return XUCKOO ;
 	}
+	if (strcmp("3", str) == 0 || strcmp("xtndbls", str) == 0) {
+		return XTNDBLS ;
+	}
+	if (strcmp("4", str) == 0 || strcmp("adaptive", str) == 0) {
+		return ADAPTIVE ;
+	}
+	if (strcmp("5", str) == 0 || strcmp("xtndbld", str) == 0) {
+		return XTNDBLD ;
+	}
+	if (strcmp("6", str) == 0 || strcmp("xtndblc", str) == 0) {
+		return XTNDBLC ;
+	}
 	return NOTYPE ;
 }
 
-// a wrapper for a table of any type, also storing its type
+// get the name of a TableType constant, as accepted by strtotype
+const char *typetostr(TableType type) {
+	switch (type) {
+		case CUCKOO:
+			return "cuckoo" ;
+		case XTNDBLN:
+			return "xtndbln" ;
+		case XUCKOO:
+			return "xuckoo" ;
+		case XTNDBLS:
+			return "xtndbls" ;
+		case ADAPTIVE:
+			return "adaptive" ;
+		case XTNDBLD:
+			return "xtndbld" ;
+		case XTNDBLC:
+			return "xtndblc" ;
+		default:
+			return "none" ;
+	}
+}
+
+// does a table of this type store string keys rather than integer keys?
+bool has_string_keys(TableType type) {
+	return type == XTNDBLS ;
+}
+
+// can a table of this type keep a count of each of its keys?
+bool has_counts(TableType type) {
+	return type == CUCKOO || type == XTNDBLN || type == XUCKOO ||
+	  type == ADAPTIVE || type == XTNDBLC ;
+}
+
+/* * * *
+ * per-type operations
+ */
+
+// the operations on a table of one type. a table's operations are resolved
+// once when it is created, so that each call is a single indirect call
+// rather than a switch on the table's type
+typedef struct table_ops {
+	void (*free)(void *table) ;
+	void (*reserve)(void *table, int64 expected_keys) ;
+	bool (*insert)(void *table, Key key) ;
+	bool (*lookup)(void *table, Key key) ;
+	bool (*insert_str)(void *table, const char *key, int len) ;
+	bool (*lookup_str)(void *table, const char *key, int len) ;
+	bool (*next)(void *table, int64 *cursor, Key *key) ;
+	bool (*increment)(void *table, Key key, int64 delta, int64 *count) ;
+	int64 (*count)(void *table, Key key) ;
+	void (*print)(void *table) ;
+	void (*stats)(void *table) ;
+	void (*metrics)(void *table, FILE *out) ;
+	void (*dump)(void *table, Dump *dump) ; // or NULL to dump by iterating
+} TableOps ;
+
+// defines adaptors from the functions of the table type with the given name
+// prefix (e.g. cuckoo) to the untyped TableOps signatures
+#define TABLE_ADAPTORS(name, Type) \
+	static void name##_free(void *table) { \
+		free_##name##_hash_table((Type *)table) ; \
+	} \
+	static void name##_reserve(void *table, int64 expected_keys) { \
+		name##_hash_table_reserve((Type *)table, expected_keys) ; \
+	} \
+	static void name##_print(void *table) { \
+		name##_hash_table_print((Type *)table) ; \
+	} \
+	static void name##_stats(void *table) { \
+		name##_hash_table_stats((Type *)table) ; \
+	} \
+	static void name##_metrics(void *table, FILE *out) { \
+		name##_hash_table_metrics((Type *)table, out) ; \
+	}
+
+// defines adaptors for the insert and lookup functions of a table type
+// storing integer keys
+#define INT_KEY_ADAPTORS(name, Type) \
+	static bool name##_insert(void *table, Key key) { \
+		return name##_hash_table_insert((Type *)table, key) ; \
+	} \
+	static bool name##_lookup(void *table, Key key) { \
+		return name##_hash_table_lookup((Type *)table, key) ; \
+	} \
+	static bool name##_next(void *table, int64 *cursor, Key *key) { \
+		return name##_hash_table_next((Type *)table, cursor, key) ; \
+	}
+
+// defines an adaptor for the dump function of a table type
+#define DUMP_ADAPTOR(name, Type) \
+	static void name##_dump(void *table, Dump *dump) { \
+		name##_hash_table_dump((Type *)table, dump) ; \
+	}
+
+// defines adaptors for the increment and count functions of a table type
+// counting its integer keys
+#define COUNT_ADAPTORS(name, Type) \
+	static bool name##_increment(void *table, Key key, int64 delta, \
+	  int64 *count) { \
+		return name##_hash_table_increment((Type *)table, key, delta, \
+		  count) ; \
+	} \
+	static int64 name##_count(void *table, Key key) { \
+		return name##_hash_table_count((Type *)table, key) ; \
+	}
+
+// defines adaptors for the insert and lookup functions of a table type
+// storing string keys
+#define STR_KEY_ADAPTORS(name, Type) \
+	static bool name##_insert_str(void *table, const char *key, int len) { \
+		return name##_hash_table_insert((Type *)table, key, len) ; \
+	} \
+	static bool name##_lookup_str(void *table, const char *key, int len) { \
+		return name##_hash_table_lookup((Type *)table, key, len) ; \
+	}
+
+TABLE_ADAPTORS(cuckoo, CuckooHashTable)
+INT_KEY_ADAPTORS(cuckoo, CuckooHashTable)
+DUMP_ADAPTOR(cuckoo, CuckooHashTable)
+COUNT_ADAPTORS(cuckoo, CuckooHashTable)
+TABLE_ADAPTORS(xtndbln, XtndblNHashTable)
+INT_KEY_ADAPTORS(xtndbln, XtndblNHashTable)
+DUMP_ADAPTOR(xtndbln, XtndblNHashTable)
+COUNT_ADAPTORS(xtndbln, XtndblNHashTable)
+TABLE_ADAPTORS(xuckoo, XuckooHashTable)
+INT_KEY_ADAPTORS(xuckoo, XuckooHashTable)
+DUMP_ADAPTOR(xuckoo, XuckooHashTable)
+COUNT_ADAPTORS(xuckoo, XuckooHashTable)
+TABLE_ADAPTORS(xtndbls, XtndblSHashTable)
+STR_KEY_ADAPTORS(xtndbls, XtndblSHashTable)
+TABLE_ADAPTORS(xtndbld, XtndblDHashTable)
+INT_KEY_ADAPTORS(xtndbld, XtndblDHashTable)
+TABLE_ADAPTORS(xtndblc, XtndblCHashTable)
+INT_KEY_ADAPTORS(xtndblc, XtndblCHashTable)
+COUNT_ADAPTORS(xtndblc, XtndblCHashTable)
+
+// stand-ins for operations a table type doesn't support, which always fail
+static void no_reserve(void *table, int64 expected_keys) {
+}
+static bool no_insert(void *table, Key key) {
+	return false ;
+}
+static bool no_lookup(void *table, Key key) {
+	return false ;
+}
+static bool no_insert_str(void *table, const char *key, int len) {
+	return false ;
+}
+static bool no_lookup_str(void *table, const char *key, int len) {
+	return false ;
+}
+static bool no_next(void *table, int64 *cursor, Key *key) {
+	return false ;
+}
+static bool no_increment(void *table, Key key, int64 delta, int64 *count) {
+	*count = 0 ;
+	return false ;
+}
+static int64 no_count(void *table, Key key) {
+	return 0 ;
+}
+
+static const TableOps cuckoo_ops = {
+	.free = cuckoo_free, .reserve = cuckoo_reserve,
+	.insert = cuckoo_insert, .lookup = cuckoo_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = cuckoo_next, .increment = cuckoo_increment,
+	.count = cuckoo_count, .print = cuckoo_print, .stats = cuckoo_stats,
+	.metrics = cuckoo_metrics, .dump = cuckoo_dump
+} ;
+static const TableOps xtndbln_ops = {
+	.free = xtndbln_free, .reserve = xtndbln_reserve,
+	.insert = xtndbln_insert, .lookup = xtndbln_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = xtndbln_next, .increment = xtndbln_increment,
+	.count = xtndbln_count, .print = xtndbln_print, .stats = xtndbln_stats,
+	.metrics = xtndbln_metrics, .dump = xtndbln_dump
+} ;
+// a snapshot of an extendible table can be read but never changed
+static const TableOps xtndbln_snapshot_ops = {
+	.free = xtndbln_free, .reserve = no_reserve,
+	.insert = no_insert, .lookup = xtndbln_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = xtndbln_next, .increment = no_increment,
+	.count = xtndbln_count, .print = xtndbln_print, .stats = xtndbln_stats,
+	.metrics = xtndbln_metrics, .dump = xtndbln_dump
+} ;
+static const TableOps xuckoo_ops = {
+	.free = xuckoo_free, .reserve = xuckoo_reserve,
+	.insert = xuckoo_insert, .lookup = xuckoo_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = xuckoo_next, .increment = xuckoo_increment,
+	.count = xuckoo_count, .print = xuckoo_print, .stats = xuckoo_stats,
+	.metrics = xuckoo_metrics, .dump = xuckoo_dump
+} ;
+static const TableOps xtndbls_ops = {
+	.free = xtndbls_free, .reserve = xtndbls_reserve,
+	.insert = no_insert, .lookup = no_lookup,
+	.insert_str = xtndbls_insert_str, .lookup_str = xtndbls_lookup_str,
+	.next = no_next, .increment = no_increment,
+	.count = no_count, .print = xtndbls_print, .stats = xtndbls_stats,
+	.metrics = xtndbls_metrics
+} ;
+static const TableOps xtndbld_ops = {
+	.free = xtndbld_free, .reserve = xtndbld_reserve,
+	.insert = xtndbld_insert, .lookup = xtndbld_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = xtndbld_next, .increment = no_increment,
+	.count = no_count, .print = xtndbld_print, .stats = xtndbld_stats,
+	.metrics = xtndbld_metrics
+} ;
+static const TableOps xtndblc_ops = {
+	.free = xtndblc_free, .reserve = xtndblc_reserve,
+	.insert = xtndblc_insert, .lookup = xtndblc_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = xtndblc_next, .increment = xtndblc_increment,
+	.count = xtndblc_count, .print = xtndblc_print, .stats = xtndblc_stats,
+	.metrics = xtndblc_metrics
+} ;
+
+/* * * *
+ * adaptive tables
+ */
+
+// an adaptive table keeps its keys in a table of whichever type suits its
+// recent workload: an extendible table while keys are mostly being inserted,
+// as it grows by splitting single buckets, then a compact cuckoo table of
+// four inner tables once they are mostly being looked up, as any lookup then
+// takes at most four probes. when the workload shifts, it migrates its keys
+// into a new table of the other type a few keys per operation, answering
+// every operation from both tables until the migration is done
+typedef struct adaptive_table {
+	HashTable *current ;    // table holding the keys and serving operations
+	HashTable *target ;     // table being migrated into, or NULL
+	int64 cursor ;          // how far through current the migration is
+	int bucketsize ;        // bucket size for extendible tables
+	int64 nkeys ;           // number of keys stored
+	int64 capacity ;        // number of keys the cuckoo table was sized for
+	int ninserts ;          // number of inserts in the current window
+	int nlookups ;          // number of lookups in the current window
+	int nmigrations ;       // number of migrations completed
+	int64 nmigrated ;       // number of keys moved by migrations
+	bool counting ;         // have any keys been incremented?
+} AdaptiveTable ;
+
+// number of operations in each window over which the workload is measured
+#define ADAPT_WINDOW 4096
+
+// share of a window's operations which must be lookups to move to cuckoo
+#define SERVING_LOOKUP_SHARE 0.90
+
+// share of a window's operations which must be inserts to move back to an
+// extendible table
+#define LOADING_INSERT_SHARE 0.50
+
+// number of inner tables of the cuckoo table serving lookups
+#define SERVING_TABLES 4
+
+// space for this many times the number of keys is reserved when moving to
+// cuckoo, keeping it well below its maximum load
+#define SERVING_HEADROOM 1.25
+
+// number of keys migrated by each operation during a migration
+#define MIGRATE_STEP 16
+
+// moves up to nkeys keys of an adaptive table's migration into the target
+// table, swapping the target in for the current table once all are moved
+static void migrate_keys(AdaptiveTable *table, int nkeys) {
+	Key key ;
+	int i ;
+	for (i=0; i<nkeys; i++) {
+		if (!hash_table_next(table->current, &table->cursor, &key)) {
+			free_hash_table(table->current) ;
+			table->current = table->target ;
+			table->target = NULL ;
+			table->nmigrations++ ;
+			return ;
+		}
+		// no new key enters target if it is still in current, so this
+		// never finds a duplicate. a counted key takes its count along
+		int64 count = table->counting ? hash_table_count(table->current, key)
+		  : 0 ;
+		if (count) {
+			hash_table_increment(table->target, key, count, &count) ;
+		} else {
+			hash_table_insert(table->target, key) ;
+		}
+		table->nmigrated++ ;
+	}
+}
+
+// starts migrating an adaptive table's keys to a new table of the given type
+static void start_migration(AdaptiveTable *table, TableType type) {
+	if (type == CUCKOO) {
+		table->capacity = table->nkeys * SERVING_HEADROOM + 1 ;
+		table->target = new_dary_cuckoo_table(1, SERVING_TABLES) ;
+		hash_table_reserve(table->target, table->capacity) ;
+	} else {
+		table->target = new_hash_table(XTNDBLN, table->bucketsize) ;
+		hash_table_reserve(table->target, table->nkeys) ;
+	}
+	table->cursor = 0 ;
+}
+
+// counts an operation towards an adaptive table's current window, and at the
+// end of a window decides whether to migrate to the other type of table.
+// a cuckoo table also moves back to an extendible table when its keys have
+// outgrown the space it was sized for, rather than doubling all at once,
+// and so returns to cuckoo at a larger size in a later window
+static void adapt(AdaptiveTable *table) {
+	if (table->ninserts + table->nlookups < ADAPT_WINDOW) {
+		return ;
+	}
+
+	if (!table->target) {
+		TableType type = hash_table_type(table->current) ;
+		if (type == XTNDBLN &&
+		  table->nlookups >= ADAPT_WINDOW * SERVING_LOOKUP_SHARE) {
+			start_migration(table, CUCKOO) ;
+		} else if (type == CUCKOO &&
+		  (table->ninserts >= ADAPT_WINDOW * LOADING_INSERT_SHARE ||
+		  table->nkeys > table->capacity)) {
+			start_migration(table, XTNDBLN) ;
+		}
+	}
+
+	table->ninserts = 0 ;
+	table->nlookups = 0 ;
+}
+
+// initialises an adaptive table, starting with an extendible table of the
+// given bucket size
+static AdaptiveTable *new_adaptive_table(int bucketsize) {
+	AdaptiveTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+
+	table->current = new_hash_table(XTNDBLN, bucketsize) ;
+	table->target = NULL ;
+	table->cursor = 0 ;
+	table->bucketsize = bucketsize ;
+	table->nkeys = 0 ;
+	table->capacity = 0 ;
+	table->ninserts = 0 ;
+	table->nlookups = 0 ;
+	table->nmigrations = 0 ;
+	table->nmigrated = 0 ;
+	table->counting = false ;
+	return table ;
+}
+
+static void adaptive_free(void *table) {
+	AdaptiveTable *adaptive = table ;
+	free_hash_table(adaptive->current) ;
+	if (adaptive->target) {
+		free_hash_table(adaptive->target) ;
+	}
+	free(adaptive) ;
+}
+
+// reserves space in whichever table new keys are going into
+static void adaptive_reserve(void *table, int64 expected_keys) {
+	AdaptiveTable *adaptive = table ;
+	HashTable *receiving = adaptive->target ? adaptive->target
+	  : adaptive->current ;
+	hash_table_reserve(receiving, expected_keys) ;
+	if (hash_table_type(receiving) == CUCKOO &&
+	  expected_keys > adaptive->capacity) {
+		adaptive->capacity = expected_keys ;
+	}
+}
+
+// during a migration new keys go into the target table, once it is known
+// they are not in the current table
+static bool adaptive_insert(void *table, Key key) {
+	AdaptiveTable *adaptive = table ;
+	bool inserted ;
+	if (adaptive->target) {
+		inserted = !hash_table_lookup(adaptive->current, key) &&
+		  hash_table_insert(adaptive->target, key) ;
+		migrate_keys(adaptive, MIGRATE_STEP) ;
+	} else {
+		inserted = hash_table_insert(adaptive->current, key) ;
+	}
+
+	adaptive->nkeys += inserted ;
+	adaptive->ninserts++ ;
+	adapt(adaptive) ;
+	return inserted ;
+}
+
+// during a migration every key is in the current table, the target, or both
+static bool adaptive_lookup(void *table, Key key) {
+	AdaptiveTable *adaptive = table ;
+	bool found = hash_table_lookup(adaptive->current, key) ;
+	if (adaptive->target) {
+		found = found || hash_table_lookup(adaptive->target, key) ;
+		migrate_keys(adaptive, MIGRATE_STEP) ;
+	}
+
+	adaptive->nlookups++ ;
+	adapt(adaptive) ;
+	return found ;
+}
+
+// during a migration a key still in the current table is counted there, and
+// in the target too if it has already been migrated, so that its count
+// there stays right. other keys are counted in the target
+static bool adaptive_increment(void *table, Key key, int64 delta,
+  int64 *count) {
+	AdaptiveTable *adaptive = table ;
+	adaptive->counting = true ;
+	bool inserted ;
+	if (adaptive->target) {
+		if (hash_table_lookup(adaptive->current, key)) {
+			hash_table_increment(adaptive->current, key, delta, count) ;
+			if (hash_table_lookup(adaptive->target, key)) {
+				hash_table_increment(adaptive->target, key, delta, count) ;
+			}
+			inserted = false ;
+		} else {
+			inserted = hash_table_increment(adaptive->target, key, delta,
+			  count) ;
+		}
+		migrate_keys(adaptive, MIGRATE_STEP) ;
+	} else {
+		inserted = hash_table_increment(adaptive->current, key, delta,
+		  count) ;
+	}
+
+	adaptive->nkeys += inserted ;
+	adaptive->ninserts++ ;
+	adapt(adaptive) ;
+	return inserted ;
+}
+
+// during a migration a key's count is right in whichever table it was
+// counted in first, the current table
+static int64 adaptive_count(void *table, Key key) {
+	AdaptiveTable *adaptive = table ;
+	if (adaptive->target && !hash_table_lookup(adaptive->current, key)) {
+		return hash_table_count(adaptive->target, key) ;
+	}
+	return hash_table_count(adaptive->current, key) ;
+}
+
+// finishes any migration before the first key, so that all of the keys are
+// in one table to step through
+static bool adaptive_next(void *table, int64 *cursor, Key *key) {
+	AdaptiveTable *adaptive = table ;
+	if (*cursor == 0) {
+		while (adaptive->target) {
+			migrate_keys(adaptive, MIGRATE_STEP) ;
+		}
+	}
+	return hash_table_next(adaptive->current, cursor, key) ;
+}
+
+static void adaptive_print(void *table) {
+	AdaptiveTable *adaptive = table ;
+	hash_table_print(adaptive->current) ;
+	if (adaptive->target) {
+		printf("--- migrating into: ---\n") ;
+		hash_table_print(adaptive->target) ;
+	}
+}
+
+static void adaptive_stats(void *table) {
+	AdaptiveTable *adaptive = table ;
+
+	printf("\n----- adaptive table stats -----\n") ;
+	printf("serving from:\t\t%s\n",
+	  typetostr(hash_table_type(adaptive->current))) ;
+	if (adaptive->target) {
+		printf("migrating into:\t\t%s\n",
+		  typetostr(hash_table_type(adaptive->target))) ;
+	}
+	printf("total load:\t\t%llu items\n", adaptive->nkeys) ;
+	printf("migrations:\t\t%d\n", adaptive->nmigrations) ;
+	printf("keys migrated:\t\t%llu\n", adaptive->nmigrated) ;
+	printf("window so far:\t\t%d inserts, %d lookups\n",
+	  adaptive->ninserts, adaptive->nlookups) ;
+	printf("   --- end adaptive stats ---\n") ;
+
+	hash_table_stats(adaptive->current) ;
+}
+
+// includes the metrics of the current table, and of the target table during
+// a migration
+static void adaptive_metrics(void *table, FILE *out) {
+	AdaptiveTable *adaptive = table ;
+
+	fprintf(out, "{\"nkeys\":%llu,\"migrations\":%d,\"keys_migrated\":%llu,"
+	  "\"window\":{\"inserts\":%d,\"lookups\":%d},\"current\":",
+	  adaptive->nkeys, adaptive->nmigrations, adaptive->nmigrated,
+	  adaptive->ninserts, adaptive->nlookups) ;
+	hash_table_metrics(adaptive->current, out) ;
+	if (adaptive->target) {
+		fprintf(out, ",\"target\":") ;
+		hash_table_metrics(adaptive->target, out) ;
+	}
+	fprintf(out, "}") ;
+}
+
+static const TableOps adaptive_ops = {
+	.free = adaptive_free, .reserve = adaptive_reserve,
+	.insert = adaptive_insert, .lookup = adaptive_lookup,
+	.insert_str = no_insert_str, .lookup_str = no_lookup_str,
+	.next = adaptive_next, .increment = adaptive_increment,
+	.count = adaptive_count, .print = adaptive_print, .stats = adaptive_stats,
+	.metrics = adaptive_metrics
+} ;
+
+/* * * *
+ * front cache
+ */
+
+// a front cache is a small direct-mapped array of recent lookup results, both
+// positive and negative, which a table can keep in front of its structure so
+// that frequently looked up keys are answered from a few cache lines. the
+// only negative result an insert can invalidate is one for the inserted key,
+// and the only tables that remove keys (cuckoo caches) can't have one, as an
+// eviction would leave a stale positive result behind
+#define CACHE_EMPTY   0
+#define CACHE_PRESENT 1
+#define CACHE_ABSENT  2
+
+typedef struct cache_entry {
+	Key key ;
+	char state ;        // CACHE_EMPTY, CACHE_PRESENT or CACHE_ABSENT
+} CacheEntry ;
+
+typedef struct front_cache {
+	CacheEntry *entries ;
+	int bits ;          // log2 of the number of entries
+	int64 nhits ;       // lookups answered by the cache
+	int64 npositive ;   // lookups answered by the cache as found
+	int64 nmisses ;     // lookups passed on to the table
+} FrontCache ;
+
+// the most entries a front cache can have
+#define MAX_CACHE_BITS 24
+
+// creates a front cache of at least nentries entries, up to 2^MAX_CACHE_BITS
+static FrontCache *new_front_cache(int nentries) {
+	FrontCache *cache = malloc(sizeof *cache) ;
+	assert(cache) ;
+
+	cache->bits = 0 ;
+	while ((1 << cache->bits) < nentries && cache->bits < MAX_CACHE_BITS) {
+		cache->bits++ ;
+	}
+	cache->entries = calloc(1 << cache->bits, sizeof *cache->entries) ;
+	assert(cache->entries) ;
+
+	cache->nhits = 0 ;
+	cache->npositive = 0 ;
+	cache->nmisses = 0 ;
+	return cache ;
+}
+
+static void free_front_cache(FrontCache *cache) {
+	free(cache->entries) ;
+	free(cache) ;
+}
+
+// the entry of a front cache a key maps to, by multiplicative hashing of its
+// low 64 bits: much cheaper than the tables' own hash functions
+static CacheEntry *cache_entry(FrontCache *cache, Key key) {
+	int64 hash = (int64)key * 0x9E3779B97F4A7C15ULL ;
+	return &cache->entries[cache->bits ? hash >> (64 - cache->bits) : 0] ;
+}
+
+/* * * *
+ * main functions
+ */
+
+// a wrapper for a table of any type, also storing its type and operations,
+// and counts of the operations given to it
 struct table {
 	TableType type  ;
+	const TableOps *ops ;
 	void *table ;
+	int64 ninserts ;    // number of inserts
+	int64 ninserted ;   // number of inserts of new keys
+	int64 nlookups ;    // number of lookups
+	int64 nfound ;      // number of lookups which found their key
+	int64 nincrements ; // number of increments
+	FrontCache *cache ; // cache of recent lookup results, or NULL
+	bool evicts ;       // whether the table drops keys to make room
 } ;
 
+// zeroes a table's operation counts, and starts it without a front cache as
+// a table which keeps every key inserted
+static void clear_op_counts(HashTable *table) {
+	table->ninserts = 0 ;
+	table->ninserted = 0 ;
+	table->nlookups = 0 ;
+	table->nfound = 0 ;
+	table->nincrements = 0 ;
+	table->cache = NULL ;
+	table->evicts = false ;
+}
+
+// adds n to one of a table's operation counts. a concurrent table may be
+// given operations by any number of threads at once, so its counts are
+// added to atomically
+static void count_ops(HashTable *table, int64 *count, int64 n) {
+	if (table->type == XTNDBLC) {
+		__atomic_fetch_add(count, n, __ATOMIC_RELAXED) ;
+	} else {
+		*count += n ;
+	}
+}
+
+// looks up a key through a table's front cache, passing misses on to the
+// table and remembering their results
+static bool cached_lookup(HashTable *table, Key key) {
+	CacheEntry *entry = cache_entry(table->cache, key) ;
+	if (entry->state != CACHE_EMPTY && entry->key == key) {
+		table->cache->nhits++ ;
+		table->cache->npositive += entry->state == CACHE_PRESENT ;
+		return entry->state == CACHE_PRESENT ;
+	}
+
+	bool found = table->ops->lookup(table->table, key) ;
+	table->cache->nmisses++ ;
+	entry->key = key ;
+	entry->state = found ? CACHE_PRESENT : CACHE_ABSENT ;
+	return found ;
+}
+
+/* * * *
+ * parallel builds
+ */
+
+// the most threads a parallel build uses
+#define MAX_BUILD_THREADS 64
+
+// in a parallel build each thread inserts a share of the keys into a private
+// table of its own, with no locking, and the tables are merged at the end.
+// for extendible tables the shares are partitions of the keys by the low bits
+// of their first hash value, so that the tables hold disjoint ranges of
+// addresses which fit together. other types take equal slices of the input,
+// as partitioning on a hash value they address by would crowd their slots
+typedef struct build_worker {
+	const Key *keys ;   // this thread's slice of the input keys
+	int64 nkeys ;       // number of keys in the slice
+	unsigned char *parts ;  // the partition of each key in the slice
+	int64 *offsets ;    // counts of the slice's keys in each partition, then
+                        // where the next key of each goes in partitioned
+	Key *partitioned ;  // all of the keys, grouped by partition
+	int nparts ;        // number of partitions (a power of two)
+
+	TableType type ;    // type of table to build
+	int64 size ;        // size to create it with
+	const Key *input ;  // the keys to build from: partitioned, or the input
+	int64 first ;       // this thread's share, as a range of input
+	int64 last ;
+	HashTable *table ;  // the table built from the share
+	int64 ninserted ;   // number of keys new to a shared table
+} BuildWorker ;
+
+// counts the keys of a worker's slice falling in each partition
+static void *count_partitions(void *arg) {
+	BuildWorker *worker = arg ;
+	int64 i ;
+	for (i=0; i<worker->nkeys; i++) {
+		int part = h1(worker->keys[i]) & (worker->nparts - 1) ;
+		worker->parts[i] = part ;
+		worker->offsets[part]++ ;
+	}
+	return NULL ;
+}
+
+// moves the keys of a worker's slice to their places in partitioned
+static void *scatter_partitions(void *arg) {
+	BuildWorker *worker = arg ;
+	int64 i ;
+	for (i=0; i<worker->nkeys; i++) {
+		worker->partitioned[worker->offsets[worker->parts[i]]++] =
+		  worker->keys[i] ;
+	}
+	return NULL ;
+}
+
+// inserts a worker's share of the keys into a new table of its own
+static void *build_share(void *arg) {
+	BuildWorker *worker = arg ;
+	worker->table = new_hash_table(worker->type, worker->size) ;
+	if (!worker->table) {
+		return NULL ;
+	}
+	int64 i ;
+	for (i=worker->first; i<worker->last; i++) {
+		hash_table_insert(worker->table, worker->input[i]) ;
+	}
+	return NULL ;
+}
+
+// inserts a worker's share of the keys straight into a concurrent table
+// shared by all of the workers
+static void *insert_share(void *arg) {
+	BuildWorker *worker = arg ;
+	worker->ninserted = 0 ;
+	int64 i ;
+	for (i=worker->first; i<worker->last; i++) {
+		worker->ninserted +=
+		  xtndblc_hash_table_insert(worker->table->table, worker->input[i]) ;
+	}
+	return NULL ;
+}
+
+// runs one step of a parallel build on a thread per worker, and waits for
+// them all to finish it
+static void run_workers(void *(*step)(void *), BuildWorker *workers,
+  int nworkers) {
+	pthread_t threads[MAX_BUILD_THREADS] ;
+	int w ;
+	for (w=0; w<nworkers; w++) {
+		int error = pthread_create(&threads[w], NULL, step, &workers[w]) ;
+		assert(!error && "error: couldn't start a build thread!") ;
+	}
+	for (w=0; w<nworkers; w++) {
+		pthread_join(threads[w], NULL) ;
+	}
+}
+
+// combines the tables built by the workers into the first worker's table:
+// extendible tables by stitching their buckets together, and other types by
+// reserving space for all of the keys and reinserting the other tables' keys
+static HashTable *merge_shares(BuildWorker *workers, int nworkers) {
+	HashTable *table = workers[0].table ;
+	int64 ninserts = 0, ninserted = 0 ;
+	int w ;
+	for (w=0; w<nworkers; w++) {
+		ninserts += workers[w].table->ninserts ;
+		ninserted += workers[w].table->ninserted ;
+	}
+
+	if (table->type == XTNDBLN) {
+		XtndblNHashTable *parts[MAX_BUILD_THREADS] ;
+		for (w=0; w<nworkers; w++) {
+			parts[w] = workers[w].table->table ;
+		}
+		table->table = xtndbln_hash_table_merge(parts, nworkers) ;
+		for (w=1; w<nworkers; w++) {
+			free(workers[w].table) ;
+		}
+	} else {
+		// slices can share keys, so only count those new to the table
+		table->ops->reserve(table->table, ninserted) ;
+		ninserted = table->ninserted ;
+		for (w=1; w<nworkers; w++) {
+			int64 cursor = 0 ;
+			Key key ;
+			while (hash_table_next(workers[w].table, &cursor, &key)) {
+				ninserted += table->ops->insert(table->table, key) ;
+			}
+			free_hash_table(workers[w].table) ;
+		}
+	}
+
+	table->ninserts = ninserts ;
+	table->ninserted = ninserted ;
+	return table ;
+}
+
 // initialise a hash table with the given paramaters and return its pointer
-HashTable *new_hash_table(TableType type, int size) {
+HashTable *new_hash_table(TableType type, int64 size) {
 	
 	// allocate space for the table wrapper
 	HashTable *table = malloc(sizeof *table) ;
 	assert(table) ;
 	// store the type
 	table->type = type ;
+	clear_op_counts(table) ;
 
-	// create and store the table itself
+	// create and store the table itself, along with its operations
 	switch (type) {
 		case CUCKOO:
 			table->table = new_cuckoo_hash_table(size) ;
+			table->ops = &cuckoo_ops ;
 			break ;
 		case XTNDBLN:
 			table->table = new_xtndbln_hash_table(size) ;
+			table->ops = &xtndbln_ops ;
 			break ;
 		case XUCKOO:
 			table->table = new_xuckoo_hash_table() ;
+			table->ops = &xuckoo_ops ;
+			break ;
+		case XTNDBLS:
+			table->table = new_xtndbls_hash_table(size) ;
+			table->ops = &xtndbls_ops ;
+			break ;
+		case ADAPTIVE:
+			table->table = new_adaptive_table(size) ;
+			table->ops = &adaptive_ops ;
+			break ;
+		case XTNDBLD:
+			table->table = new_xtndbld_hash_table(NULL, size) ;
+			table->ops = &xtndbld_ops ;
+			if (!table->table) {
+				free(table) ;
+				return NULL ;
+			}
+			break ;
+		case XTNDBLC:
+			table->table = new_xtndblc_hash_table(size) ;
+			table->ops = &xtndblc_ops ;
 			break ;
 		default:
 			// unexpected table type - error
@@ -64,97 +866,475 @@ HashTable *new_hash_table(TableType type, int size) {
 	return table ;
 }
 
-// free all memory associated with a given table
-void free_hash_table(HashTable *table) {
-	assert(table != NULL) ;
+// initialise a cuckoo hash table using ntables (2 to MAX_CUCKOO_TABLES) inner
+// tables and hash functions, and return its pointer
+HashTable *new_dary_cuckoo_table(int64 size, int ntables) {
+	HashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->type = CUCKOO ;
+	clear_op_counts(table) ;
+	table->table = new_dary_cuckoo_hash_table(size, ntables) ;
+	table->ops = &cuckoo_ops ;
+	return table ;
+}
 
-	switch (table->type) {
-		case CUCKOO:
-			free_cuckoo_hash_table(table->table) ;
-			break ;
+// initialise a compact cuckoo hash table using ntables (2 to
+// MAX_CUCKOO_TABLES) inner tables, and return its pointer
+HashTable *new_compact_cuckoo_table(int64 size, int ntables) {
+	HashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->type = CUCKOO ;
+	clear_op_counts(table) ;
+	table->table = new_compact_cuckoo_hash_table(size, ntables) ;
+	table->ops = &cuckoo_ops ;
+	return table ;
+}
+
+// initialise a cuckoo hash table using ntables (2 to MAX_CUCKOO_TABLES)
+// inner tables as a cache of at most capacity keys, and return its pointer
+HashTable *new_cuckoo_cache_table(int64 capacity, int ntables, bool compact) {
+	HashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->type = CUCKOO ;
+	clear_op_counts(table) ;
+	table->table = new_cuckoo_cache_hash_table(capacity, ntables, compact) ;
+	table->ops = &cuckoo_ops ;
+	table->evicts = true ;
+	return table ;
+}
+
+// initialise a disk-resident extendible hash table with its pages in a new
+// file at path, buffered by a pool of nframes pages, and return its pointer
+HashTable *new_disk_hash_table(const char *path, int nframes) {
+	XtndblDHashTable *inner = new_xtndbld_hash_table(path, nframes) ;
+	if (!inner) {
+		return NULL ;
+	}
+
+	HashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->type = XTNDBLD ;
+	clear_op_counts(table) ;
+	table->table = inner ;
+	table->ops = &xtndbld_ops ;
+	return table ;
+}
+
+// initialise a hash table of the given type holding the nkeys given keys,
+// using the type's bulk construction where it has one, and otherwise
+// reserving space then inserting the keys one by one
+HashTable *new_hash_table_bulk(TableType type, int64 size, const Key *keys,
+  int64 nkeys) {
+
+	HashTable *table = new_hash_table(type, size) ;
+	if (!table) {
+		return NULL ;
+	}
+
+	switch (type) {
 		case XTNDBLN:
 			free_xtndbln_hash_table(table->table) ;
-			break ;
-		case XUCKOO:
-			free_xuckoo_hash_table(table->table) ;
+			table->table = new_xtndbln_hash_table_bulk(size, keys, nkeys) ;
 			break ;
 		default:
+			hash_table_reserve(table, nkeys) ;
+			int64 i ;
+			for (i=0; i<nkeys; i++) {
+				hash_table_insert(table, keys[i]) ;
+			}
 			break ;
 	}
 
-	// free the wrapper as well
+	return table ;
+}
+
+// take a read-only snapshot of a table, as it is now, which shares its
+// memory with the table until the table changes
+// returns NULL for a type which doesn't support snapshots
+HashTable *hash_table_snapshot(HashTable *table) {
+	assert(table != NULL) ;
+	if (table->type != XTNDBLN) {
+		return NULL ;
+	}
+
+	HashTable *snapshot = malloc(sizeof *snapshot) ;
+	assert(snapshot) ;
+	snapshot->type = XTNDBLN ;
+	clear_op_counts(snapshot) ;
+	snapshot->table = xtndbln_hash_table_snapshot(table->table) ;
+	snapshot->ops = &xtndbln_snapshot_ops ;
+	return snapshot ;
+}
+
+// initialise a hash table of the given type holding the nkeys given keys,
+// built by nthreads threads each inserting a share of the keys into a
+// private table, after which the tables are merged into one
+// returns NULL for a type with string keys, or if a table couldn't be created
+HashTable *new_hash_table_parallel(TableType type, int64 size,
+  const Key *keys, int64 nkeys, int nthreads) {
+	if (type == NOTYPE || has_string_keys(type)) {
+		return NULL ;
+	}
+
+	// use a power of two threads, to partition on low hash bits
+	int nworkers = 1 ;
+	while (nworkers * 2 <= nthreads && nworkers * 2 <= MAX_BUILD_THREADS) {
+		nworkers *= 2 ;
+	}
+
+	BuildWorker workers[MAX_BUILD_THREADS] ;
+	Key *partitioned = NULL ;
+	int w, p ;
+	for (w=0; w<nworkers; w++) {
+		workers[w].first = nkeys * w / nworkers ;
+		workers[w].last = nkeys * (w + 1) / nworkers ;
+		workers[w].input = keys ;
+		workers[w].type = type ;
+		workers[w].size = size ;
+	}
+
+	// a concurrent table needs no merging: every thread inserts its slice of
+	// the input into the same table
+	if (type == XTNDBLC) {
+		HashTable *table = new_hash_table(type, size) ;
+		xtndblc_hash_table_reserve(table->table, nkeys) ;
+		for (w=0; w<nworkers; w++) {
+			workers[w].table = table ;
+		}
+		run_workers(insert_share, workers, nworkers) ;
+		for (w=0; w<nworkers; w++) {
+			table->ninserted += workers[w].ninserted ;
+		}
+		table->ninserts = nkeys ;
+		return table ;
+	}
+
+	/* partition the keys for extendible tables, each thread taking an equal
+	   slice of the input */
+	if (type == XTNDBLN) {
+		unsigned char *parts = malloc(nkeys + 1) ;
+		assert(parts) ;
+		partitioned = malloc((sizeof *partitioned) * (nkeys + 1)) ;
+		assert(partitioned) ;
+		int64 *offsets = calloc(nworkers * nworkers, sizeof *offsets) ;
+		assert(offsets) ;
+
+		for (w=0; w<nworkers; w++) {
+			workers[w].keys = keys + workers[w].first ;
+			workers[w].nkeys = workers[w].last - workers[w].first ;
+			workers[w].parts = parts + workers[w].first ;
+			workers[w].offsets = offsets + w * nworkers ;
+			workers[w].partitioned = partitioned ;
+			workers[w].nparts = nworkers ;
+		}
+		run_workers(count_partitions, workers, nworkers) ;
+
+		// turn the counts into offsets, with each partition's keys together
+		// and each slice's keys in order within them
+		int64 next = 0 ;
+		for (p=0; p<nworkers; p++) {
+			workers[p].first = next ;
+			for (w=0; w<nworkers; w++) {
+				int64 count = workers[w].offsets[p] ;
+				workers[w].offsets[p] = next ;
+				next += count ;
+			}
+			workers[p].last = next ;
+			workers[p].input = partitioned ;
+		}
+		run_workers(scatter_partitions, workers, nworkers) ;
+		free(offsets) ;
+		free(parts) ;
+	}
+	/* ------------------------------------------------------------------ */
+
+	/* build a table from each share, then merge them */
+	run_workers(build_share, workers, nworkers) ;
+	free(partitioned) ;
+
+	for (w=0; w<nworkers; w++) {
+		if (!workers[w].table) {
+			for (w=0; w<nworkers; w++) {
+				if (workers[w].table) {
+					free_hash_table(workers[w].table) ;
+				}
+			}
+			return NULL ;
+		}
+	}
+	/* ---------------------------------------------- */
+
+	return merge_shares(workers, nworkers) ;
+}
+
+// free all memory associated with a given table
+void free_hash_table(HashTable *table) {
+	assert(table != NULL) ;
+
+	table->ops->free(table->table) ;
+
+	// free the wrapper and its cache as well
+	if (table->cache) {
+		free_front_cache(table->cache) ;
+	}
 	free(table) ;
 }
 
+// put a front cache of recent lookup results in front of a table
+void hash_table_enable_cache(HashTable *table, int nentries) {
+	assert(table != NULL) ;
+	assert(table->type != XTNDBLC &&
+	  "error: a front cache can't be shared between threads!") ;
+	assert(!table->evicts &&
+	  "error: a front cache can't be kept in front of a cache!") ;
+	if (table->cache) {
+		free_front_cache(table->cache) ;
+	}
+	table->cache = new_front_cache(nentries) ;
+}
+
+// get the type of a table
+TableType hash_table_type(HashTable *table) {
+	return table->type ;
+}
+
+// get the underlying table, for use with its type's inline fast paths
+void *hash_table_inner(HashTable *table) {
+	return table->table ;
+}
+
+// grow a table up front so that it can take expected_keys keys without
+// repeatedly growing and rehashing as they are inserted
+void hash_table_reserve(HashTable *table, int64 expected_keys) {
+	assert(table != NULL) ;
+	table->ops->reserve(table->table, expected_keys) ;
+}
+
 // insert a new key into a table
 // returns true if successful, false if the key was already present
-bool hash_table_insert(HashTable *table, int64 key) {
+bool hash_table_insert(HashTable *table, Key key) {
 	assert(table != NULL) ;
+	bool inserted = table->ops->insert(table->table, key) ;
+	count_ops(table, &table->ninserts, 1) ;
+	count_ops(table, &table->ninserted, inserted) ;
 
-	switch (table->type) {
-		case CUCKOO:
-			return cuckoo_hash_table_insert(table->table, key) ;
-		case XTNDBLN:
-			return xtndbln_hash_table_insert(table->table, key) ;
-		case XUCKOO:
-			return xuckoo_hash_table_insert(table->table, key) ;
-		default:
-			return false ;
+	// a new key invalidates any cached negative result for it
+	if (inserted && table->cache) {
+		CacheEntry *entry = cache_entry(table->cache, key) ;
+		if (entry->key == key) {
+			entry->state = CACHE_PRESENT ;
+		}
 	}
+	return inserted ;
 }
 
 // lookup whether a key is inside a table
 // returns true if found, false if not
-bool hash_table_lookup(HashTable *table, int64 key) {
+bool hash_table_lookup(HashTable *table, Key key) {
 	assert(table != NULL) ;
+	bool found = table->cache ? cached_lookup(table, key)
+	  : table->ops->lookup(table->table, key) ;
+	count_ops(table, &table->nlookups, 1) ;
+	count_ops(table, &table->nfound, found) ;
+	return found ;
+}
 
-	switch (table->type) {
-		case CUCKOO:
-			return cuckoo_hash_table_lookup(table->table, key) ;
-		case XTNDBLN:
-			return xtndbln_hash_table_lookup(table->table, key) ;
-		case XUCKOO:
-			return xuckoo_hash_table_lookup(table->table, key) ;
-		default:
-			return false ;
+// insert a new string key of len bytes into a string-keyed table
+// returns true if successful, false if the key was already present
+bool hash_table_insert_str(HashTable *table, const char *key, int len) {
+	assert(table != NULL) ;
+	bool inserted = table->ops->insert_str(table->table, key, len) ;
+	count_ops(table, &table->ninserts, 1) ;
+	count_ops(table, &table->ninserted, inserted) ;
+	return inserted ;
+}
+
+// lookup whether a string key of len bytes is inside a string-keyed table
+// returns true if found, false if not
+bool hash_table_lookup_str(HashTable *table, const char *key, int len) {
+	assert(table != NULL) ;
+	bool found = table->ops->lookup_str(table->table, key, len) ;
+	count_ops(table, &table->nlookups, 1) ;
+	count_ops(table, &table->nfound, found) ;
+	return found ;
+}
+
+// add delta to the count of a key in a table, inserting it with a count of
+// delta if it isn't there
+// returns true if the key was inserted, and stores its new count in *count
+bool hash_table_increment(HashTable *table, Key key, int64 delta,
+  int64 *count) {
+	assert(table != NULL) ;
+	bool inserted = table->ops->increment(table->table, key, delta, count) ;
+	count_ops(table, &table->nincrements, 1) ;
+
+	// a new key invalidates any cached negative result for it
+	if (inserted && table->cache) {
+		CacheEntry *entry = cache_entry(table->cache, key) ;
+		if (entry->key == key) {
+			entry->state = CACHE_PRESENT ;
+		}
 	}
+	return inserted ;
+}
+
+// add delta to the count of a key in a concurrent table from any thread
+// returns true if the key was inserted, and stores its new count in *count
+bool hash_table_increment_atomic(HashTable *table, Key key, int64 delta,
+  int64 *count) {
+	assert(table != NULL) ;
+	assert(table->type == XTNDBLC && !table->cache &&
+	  "error: only concurrent tables can be counted in from many threads!") ;
+	return xtndblc_hash_table_increment(table->table, key, delta, count) ;
+}
+
+// get the count of a key in a table
+int64 hash_table_count(HashTable *table, Key key) {
+	assert(table != NULL) ;
+	return table->ops->count(table->table, key) ;
+}
+
+// moves the key and count at position i of a min-heap of n counts down until
+// neither of its children has a smaller count
+static void sift_down(Key *keys, int64 *counts, int n, int i) {
+	while (true) {
+		int least = i ;
+		int child ;
+		for (child=2*i+1; child<=2*i+2 && child<n; child++) {
+			if (counts[child] < counts[least]) {
+				least = child ;
+			}
+		}
+		if (least == i) {
+			return ;
+		}
+		Key key = keys[i] ;
+		int64 count = counts[i] ;
+		keys[i] = keys[least] ;
+		counts[i] = counts[least] ;
+		keys[least] = key ;
+		counts[least] = count ;
+		i = least ;
+	}
+}
+
+// find the k keys with the largest counts in a table, by stepping through
+// its keys and keeping the largest k counts seen in a min-heap, whose root
+// is the count a key must beat to get in. the heap is then sorted by
+// repeatedly swapping its root to the end
+// returns the number of keys found, at most k
+int hash_table_top_k(HashTable *table, int k, Key *keys, int64 *counts) {
+	assert(table != NULL && k >= 0) ;
+
+	int n = 0 ;
+	int64 cursor = 0 ;
+	Key key ;
+	while (hash_table_next(table, &cursor, &key)) {
+		int64 count = table->ops->count(table->table, key) ;
+		if (n < k) {
+			// add the key at the end, and move it up past larger counts
+			int i = n++ ;
+			while (i > 0 && counts[(i-1)/2] > count) {
+				keys[i] = keys[(i-1)/2] ;
+				counts[i] = counts[(i-1)/2] ;
+				i = (i-1)/2 ;
+			}
+			keys[i] = key ;
+			counts[i] = count ;
+		} else if (k > 0 && count > counts[0]) {
+			keys[0] = key ;
+			counts[0] = count ;
+			sift_down(keys, counts, k, 0) ;
+		}
+	}
+
+	int m ;
+	for (m=n-1; m>0; m--) {
+		Key top = keys[0] ;
+		int64 count = counts[0] ;
+		keys[0] = keys[m] ;
+		counts[0] = counts[m] ;
+		keys[m] = top ;
+		counts[m] = count ;
+		sift_down(keys, counts, m, 0) ;
+	}
+	return n ;
+}
+
+// step through the keys of an integer-keyed table, one per call
+bool hash_table_next(HashTable *table, int64 *cursor, Key *key) {
+	assert(table != NULL) ;
+	return table->ops->next(table->table, cursor, key) ;
 }
 
 // print the contents of a table to stdout
 void hash_table_print(HashTable *table) {
 	assert(table != NULL) ;
+	table->ops->print(table->table) ;
+}
 
-	switch (table->type) {
-		case CUCKOO:
-			cuckoo_hash_table_print(table->table) ;
-			break ;
-		case XTNDBLN:
-			xtndbln_hash_table_print(table->table) ;
-			break ;
-		case XUCKOO:
-			xuckoo_hash_table_print(table->table) ;
-			break ;
-		default:
-			break ;
+// dump a table to out in the given format, range of addresses and view.
+// types without a dump of their own dump their keys in iteration order,
+// each at the address of its position in that order
+// returns false for a table of string keys, which can't be dumped
+bool hash_table_dump(HashTable *table, FILE *out, DumpOptions options) {
+	assert(table != NULL) ;
+	if (has_string_keys(table->type)) {
+		return false ;
 	}
-}
 
+	Dump *dump = new_dump(out, options) ;
+	if (table->ops->dump) {
+		table->ops->dump(table->table, dump) ;
+	} else {
+		int64 cursor = 0, position = 0 ;
+		Key key ;
+		while (position < options.last &&
+		  hash_table_next(table, &cursor, &key)) {
+			if (position >= options.first) {
+				dump_slot(dump, 0, position, true, key) ;
+			}
+			position++ ;
+		}
+	}
+	free_dump(dump) ;
+	return true ;
+}
 
 // print statistics about a table to stdout
 void hash_table_stats(HashTable *table) {
 	assert(table != NULL) ;
 
-	switch (table->type) {
-		case CUCKOO:
-			cuckoo_hash_table_stats(table->table) ;
-			break ;
-		case XTNDBLN:
-			xtndbln_hash_table_stats(table->table) ;
-			break ;
-		case XUCKOO:
-			xuckoo_hash_table_stats(table->table) ;
-			break ;
-		default:
-			break ;
+	if (table->cache) {
+		FrontCache *cache = table->cache ;
+		int64 nlookups = cache->nhits + cache->nmisses ;
+		printf("\n----- front cache -----\n") ;
+		printf("entries           :\t%d\n", 1 << cache->bits) ;
+		printf("lookups           :\t%llu\n", nlookups) ;
+		printf("hits              :\t%llu (%llu found, %llu not found)\n",
+		  cache->nhits, cache->npositive, cache->nhits - cache->npositive) ;
+		printf("hit rate          :\t%.3f%%\n",
+		  nlookups ? cache->nhits * 100.0 / nlookups : 0.0) ;
+		printf("   --- end cache ---\n") ;
 	}
-}
\ No newline at end of file
+
+	table->ops->stats(table->table) ;
+}
+
+// write metrics about a table to out as a single-line JSON object
+void hash_table_metrics(HashTable *table, FILE *out) {
+	assert(table != NULL) ;
+	fprintf(out, "{\"type\":\"%s\",\"ops\":{\"inserts\":%llu,"
+	  "\"inserted\":%llu,\"lookups\":%llu,\"found\":%llu,"
+	  "\"increments\":%llu},", typetostr(table->type), table->ninserts,
+	  table->ninserted, table->nlookups, table->nfound, table->nincrements) ;
+	if (table->cache) {
+		fprintf(out, "\"cache\":{\"entries\":%d,\"hits\":%llu,"
+		  "\"found\":%llu,\"misses\":%llu},", 1 << table->cache->bits,
+		  table->cache->nhits, table->cache->npositive,
+		  table->cache->nmisses) ;
+	}
+	fprintf(out, "\"table\":") ;
+	table->ops->metrics(table->table, out) ;
+	fprintf(out, "}") ;
+}
@@ -8,37 +8,175 @@
 #ifndef HASHTBL_H
 #define HASHTBL_H
 
+#include   <stdio.h>
 #include <stdbool.h>
 #include "inthash.h"
+#include "dump.h"
 
 // enum with the different types of hash table
 typedef enum type {
-	NOTYPE = -1, CUCKOO, XTNDBLN, XUCKOO
+	NOTYPE = -1, CUCKOO, XTNDBLN, XUCKOO, XTNDBLS, ADAPTIVE, XTNDBLD,
+	XTNDBLC
 } TableType ;
 
 // get a TableType constant from a string representation:
 TableType strtotype(char *str) ;
 
+// get the name of a TableType constant, as accepted by strtotype
+const char *typetostr(TableType type) ;
+
+// does a table of this type store string keys rather than integer keys?
+bool has_string_keys(TableType type) ;
+
+// can a table of this type keep a count of each of its keys? (all but
+// xtndbls and xtndbld tables)
+bool has_counts(TableType type) ;
+
 typedef struct table HashTable ;
 
 // initialise a hash table with the given paramaters and return its pointer
-HashTable *new_hash_table(TableType type, int size) ;
+HashTable *new_hash_table(TableType type, int64 size) ;
+
+// initialise a cuckoo hash table using ntables (2 to 4) inner tables and
+// hash functions rather than the usual two, and return its pointer
+HashTable *new_dary_cuckoo_table(int64 size, int ntables) ;
+
+// initialise a compact cuckoo hash table using ntables (2 to 4) inner tables,
+// whose slots each hold only the part of a key their address doesn't give,
+// and return its pointer
+HashTable *new_compact_cuckoo_table(int64 size, int ntables) ;
+
+// initialise a cuckoo hash table using ntables (2 to 4) inner tables as a
+// cache of at most capacity keys, with compact slots or not, and return its
+// pointer. it never grows: inserting into it when full evicts a key in CLOCK
+// order, passing over keys looked up since the CLOCK hand last reached them
+HashTable *new_cuckoo_cache_table(int64 capacity, int ntables, bool compact) ;
+
+// initialise a disk-resident extendible hash table with its pages in a new
+// file at path (or an anonymous temporary file if path is NULL), buffered by
+// a pool of nframes pages, and return its pointer
+// returns NULL if the file couldn't be created
+HashTable *new_disk_hash_table(const char *path, int nframes) ;
+
+// initialise a hash table of the given type holding the nkeys given keys,
+// using the type's bulk construction where it has one, and otherwise
+// reserving space then inserting the keys one by one
+HashTable *new_hash_table_bulk(TableType type, int64 size, const Key *keys,
+  int64 nkeys) ;
+
+// initialise a hash table of the given type holding the nkeys given keys,
+// built in parallel by up to nthreads threads (rounded down to a power of
+// two). each thread inserts a share of the keys into a private table with no
+// locking, and the tables are then merged: extendible tables, whose shares
+// are partitions of the keys on their low hash bits, by stitching their
+// buckets together, and other types by reinserting into a table sized for
+// all of the keys. concurrent extendible tables aren't merged: the threads
+// all insert into one table
+// returns NULL for a type with string keys, or if a table couldn't be created
+HashTable *new_hash_table_parallel(TableType type, int64 size,
+  const Key *keys, int64 nkeys, int nthreads) ;
+
+// take a read-only snapshot of a table: it keeps answering lookups, and
+// iterating, as the table was when the snapshot was taken, however the table
+// changes afterwards. inserts into the snapshot always fail. the snapshot
+// shares the table's memory, which the table copies a bucket at a time as it
+// changes it, so taking one is cheap. free it with free_hash_table, before
+// or after the table
+// returns NULL for a type which doesn't support snapshots (all but xtndbln)
+HashTable *hash_table_snapshot(HashTable *table) ;
 
 // free all memory associated with a given table
 void free_hash_table(HashTable *table) ;
 
+// put a small direct-mapped cache of the results of recent lookups, found or
+// not, in front of an integer-keyed table, with at least nentries entries
+// (rounded up to a power of two). for skewed lookups, frequent keys are then
+// answered without touching the table. its hit rate is shown in stats
+// not for concurrent extendible tables (xtndblc), as the cache isn't
+// synchronised between threads, nor for cuckoo caches, as it would go on
+// answering for keys they have evicted
+void hash_table_enable_cache(HashTable *table, int nentries) ;
+
+// get the type of a table
+TableType hash_table_type(HashTable *table) ;
+
+// get the underlying table, whose type depends on hash_table_type
+// for tight loops over a table of known type, pass it to that type's inline
+// fast paths (e.g. cuckoo_hash_table_lookup_fast in tables/cuckoo_fast.h)
+// to skip the dispatch, argument checks and time accounting of this interface
+void *hash_table_inner(HashTable *table) ;
+
+// grow a table up front so that it can take expected_keys keys without
+// repeatedly growing and rehashing as they are inserted
+void hash_table_reserve(HashTable *table, int64 expected_keys) ;
+
 // insert a new key into a table
 // returns true if successful, false if the key was already present
-bool hash_table_insert(HashTable *table, int64 key) ;
+bool hash_table_insert(HashTable *table, Key key) ;
 
 // lookup whether a key is inside a table
 // returns true if found, false if not
-bool hash_table_lookup(HashTable *table, int64 key) ;
+bool hash_table_lookup(HashTable *table, Key key) ;
+
+// insert a new string key of len bytes into a string-keyed table
+// returns true if successful, false if the key was already present
+bool hash_table_insert_str(HashTable *table, const char *key, int len) ;
+
+// lookup whether a string key of len bytes is inside a string-keyed table
+// returns true if found, false if not
+bool hash_table_lookup_str(HashTable *table, const char *key, int len) ;
+
+// add delta to the count of a key in a table which has counts, inserting it
+// with a count of delta if it isn't there, in the same probe of the table
+// that finds it. keys inserted by hash_table_insert have a count of 0. a
+// counting cuckoo cache forgets the counts of the keys it evicts. safe to
+// call from any number of threads at once on a concurrent table (xtndblc)
+// returns true if the key was inserted, and stores its new count in *count
+// (always false, with a count of 0, for a type without counts or a snapshot)
+bool hash_table_increment(HashTable *table, Key key, int64 delta,
+  int64 *count) ;
+
+// add delta to the count of a key in a concurrent extendible table (xtndblc)
+// without a front cache, as for hash_table_increment, but safe to call from
+// any number of threads at once. the first increment of a key locks its
+// bucket to give it a counter, and later ones add to that counter with an
+// atomic fetch-add, taking no lock. these increments aren't included in the
+// table's operation counts
+bool hash_table_increment_atomic(HashTable *table, Key key, int64 delta,
+  int64 *count) ;
+
+// get the count of a key in a table, or 0 if it isn't there
+int64 hash_table_count(HashTable *table, Key key) ;
+
+// find the (up to) k keys with the largest counts in an integer-keyed table,
+// storing them in keys and their counts in counts, largest first. ties are
+// broken arbitrarily. takes one pass over the table, keeping the k largest
+// in a heap. the table must not be changed meanwhile
+// returns the number of keys stored: k, or fewer if the table has fewer keys
+int hash_table_top_k(HashTable *table, int k, Key *keys, int64 *counts) ;
+
+// step through the keys of an integer-keyed table, one per call: set *cursor
+// to 0 to start from the first key, then pass it back unchanged for each next
+// key. the table must not be changed between calls
+// returns true and stores the next key in *key, or false once all are seen
+bool hash_table_next(HashTable *table, int64 *cursor, Key *key) ;
 
 // print the contents of a table to stdout
 void hash_table_print(HashTable *table) ;
 
+// dump a table to out, much faster than printing it: in a range of addresses
+// (options.first to options.last), as text, CSV or binary records, of all
+// slots or only occupied ones, and for extendible tables optionally as a
+// summary of the directory with one record per bucket (see dump.h). types
+// without a layout of their own to dump give their keys in iteration order
+// returns false for a table of string keys, which can't be dumped
+bool hash_table_dump(HashTable *table, FILE *out, DumpOptions options) ;
+
 // print statistics about a table to stdout
 void hash_table_stats(HashTable *table) ;
 
+// write metrics about a table to out as a single-line JSON object: counts of
+// the operations given to it, then its type's own metrics (see metrics.h)
+void hash_table_metrics(HashTable *table, FILE *out) ;
+
 #endif
\ No newline at end of file
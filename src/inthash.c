@@ -1,27 +1,62 @@
 /* * * * * * * * *
- * Hash functions for 64-bit unsigned integers
+ * Hash functions for fixed-width unsigned integer keys
  *
  * created by Maxim Kirkman <max.kirkman94@gmail.com>, following Matt Farrugia
  */
 
-#include <math.h>
+#include  <ctype.h>
+#include <stdlib.h>
 #include "inthash.h"
 
-// constants for respective hash function (arbitrary primes)
-#define A1 899808677
-#define B1 776533253
-#define p1 2147483563
+// writes the decimal representation of k into buf (of at least KEY_STR_LEN
+// characters) and returns buf
+char *keytostr(Key k, char *buf) {
+	// collect digits least significant first, then reverse them into buf
+	char digits[KEY_STR_LEN] ;
+	int n = 0 ;
+	do {
+		digits[n++] = '0' + (int)(k % 10) ;
+		k /= 10 ;
+	} while (k > 0) ;
 
-#define A2 879191233
-#define B2 796929241
-#define p2 2147483629
-
-// first hash function
-int h1(int64 k) {
-	return (k * A1 + B1) % p1 ;
+	int i ;
+	for (i=0; i<n; i++) {
+		buf[i] = digits[n-1-i] ;
+	}
+	buf[n] = '\0' ;
+	return buf ;
 }
 
-// second hash function
-int h2(int64 k) {
-	return (k * A2 + B2) % p2 ;
-}
\ No newline at end of file
+// parses a decimal key from str into *k, wrapping negative and overlong
+// numbers around the key width like strtoull does for 64 bits
+// returns true if at least one digit was read
+bool strtokey(const char *str, Key *k) {
+#if KEY_BITS == 128
+	while (isspace((unsigned char)*str)) {
+		str++ ;
+	}
+	bool negative = *str == '-' ;
+	if (*str == '-' || *str == '+') {
+		str++ ;
+	}
+	if (!isdigit((unsigned char)*str)) {
+		return false ;
+	}
+
+	Key value = 0 ;
+	while (isdigit((unsigned char)*str)) {
+		value = value * 10 + (*str - '0') ;
+		str++ ;
+	}
+	*k = negative ? -value : value ;
+	return true ;
+#else
+	char *end ;
+	unsigned long long value = strtoull(str, &end, 10) ;
+	if (end == str) {
+		return false ;
+	}
+	*k = (Key)value ;
+	return true ;
+#endif
+}
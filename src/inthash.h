@@ -1,5 +1,9 @@
 /* * * * * * * * *
- * Hash functions for 64-bit unsigned integers
+ * Hash functions for fixed-width unsigned integer keys
+ *
+ * the key width is chosen at compile time with -DKEY_BITS=32, 64 (default)
+ * or 128, so that key comparisons and slot strides in every table are
+ * compile-time constants
  *
  * created by Maxim Kirkman <max.kirkman94@gmail.com>, following Matt Farrugia
  */
@@ -8,19 +12,126 @@
 #define INTHASH_H
 
 #include <stdint.h>
-
-// the maximum allowable table size: 2^27
-// a table of 64-bit integers (8 bytes) with this many entries
-// would take up 2^27 * 8 bytes = 2^30 bytes = 1GB of memory
-#define MAX_TABLE_SIZE 134217728
+#include <stdbool.h>
 
 // unsigned 64-bit integer type
 typedef uint64_t int64 ;
 
+// key type stored by the tables, selected by KEY_BITS
+#ifndef KEY_BITS
+#define KEY_BITS 64
+#endif
+
+#if KEY_BITS == 32
+typedef uint32_t Key ;
+#elif KEY_BITS == 64
+typedef uint64_t Key ;
+#elif KEY_BITS == 128
+__extension__ typedef unsigned __int128 Key ;
+#else
+#error "KEY_BITS must be 32, 64 or 128"
+#endif
+
+// macro to calculate the rightmost n bits (0 to 63) of a number x
+#define rightmostnbits(n, x) ((x) & (((int64)1 << (n)) - 1))
+
+// longest decimal representation of a key, including the terminating '\0'
+#define KEY_STR_LEN 40
+
+// constants for respective hash function (arbitrary odd numbers): the key
+// is multiplied by A and offset by B, then mixed so that every bit of the
+// hash value depends on every bit of the key
+#define H1_A 0x9E3779B97F4A7C15ULL
+#define H1_B 0x2545F4914F6CDD1DULL
+
+#define H2_A 0xC2B2AE3D27D4EB4FULL
+#define H2_B 0x165667B19E3779F9ULL
+
+#define H3_A 0xD6E8FEB86659FD93ULL
+#define H3_B 0x27D4EB2F165667C5ULL
+
+#define H4_A 0x94D049BB133111EBULL
+#define H4_B 0x85EBCA77C2B2AE63ULL
+
+// multipliers for the high half of a 128-bit key (arbitrary odd numbers)
+#define H1_C 0xFF51AFD7ED558CCDULL
+#define H2_C 0xC4CEB9FE1A85EC53ULL
+#define H3_C 0xBF58476D1CE4E5B9ULL
+#define H4_C 0x9FB21C651E98DF25ULL
+
+// the hash functions are defined inline so that every table probe, including
+// the header-inline fast paths, compiles without a call. their values use all
+// 64 bits, so tables can address more than 2^32 slots
+
+// mixes the bits of x so that each affects all of the result (the finaliser
+// of MurmurHash3). it is invertible, so distinct 64-bit keys never collide
+static inline int64 mix64(int64 x) {
+	x ^= x >> 33 ;
+	x *= 0xFF51AFD7ED558CCDULL ;
+	x ^= x >> 33 ;
+	x *= 0xC4CEB9FE1A85EC53ULL ;
+	x ^= x >> 33 ;
+	return x ;
+}
+
+#if KEY_BITS == 128
+
+// 128-bit keys mix their high half into the offset for their low half, so
+// that no 128-bit arithmetic is needed on the hot path
+#define lo64(k) ((int64)(k))
+#define hi64(k) ((int64)((k) >> 64))
+
 // first hash function
-int h1(int64 k) ;
+static inline int64 h1(Key k) {
+	return mix64(lo64(k) * H1_A + mix64(hi64(k) * H1_C + H1_B)) ;
+}
 
 // second hash function
-int h2(int64 k) ;
+static inline int64 h2(Key k) {
+	return mix64(lo64(k) * H2_A + mix64(hi64(k) * H2_C + H2_B)) ;
+}
+
+// third hash function
+static inline int64 h3(Key k) {
+	return mix64(lo64(k) * H3_A + mix64(hi64(k) * H3_C + H3_B)) ;
+}
+
+// fourth hash function
+static inline int64 h4(Key k) {
+	return mix64(lo64(k) * H4_A + mix64(hi64(k) * H4_C + H4_B)) ;
+}
+
+#else
+
+// first hash function
+static inline int64 h1(Key k) {
+	return mix64((int64)k * H1_A + H1_B) ;
+}
+
+// second hash function
+static inline int64 h2(Key k) {
+	return mix64((int64)k * H2_A + H2_B) ;
+}
+
+// third hash function
+static inline int64 h3(Key k) {
+	return mix64((int64)k * H3_A + H3_B) ;
+}
+
+// fourth hash function
+static inline int64 h4(Key k) {
+	return mix64((int64)k * H4_A + H4_B) ;
+}
+
+#endif
+
+// writes the decimal representation of k into buf (of at least KEY_STR_LEN
+// characters) and returns buf
+char *keytostr(Key k, char *buf) ;
+
+// parses a decimal key from str into *k, wrapping negative and overlong
+// numbers around the key width like strtoull does for 64 bits
+// returns true if at least one digit was read
+bool strtokey(const char *str, Key *k) ;
 
-#endif
\ No newline at end of file
+#endif
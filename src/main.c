@@ -9,16 +9,37 @@
 #include  <stdlib.h>
 #include <stdbool.h>
 #include  <string.h>
+#include  <assert.h>
 #include  <getopt.h>
+#include   <ctype.h>
+#include  <limits.h>
 
 #include "inthash.h"
 #include "hashtbl.h"
+#include "trace.h"
+#include "metrics.h"
+#include "server.h"
+#include "budget.h"
 
 /* cli options */
 #define DEFAULT_SIZE 4
 typedef struct options {
 	TableType type ;
-	int initial_size ;
+	int64 initial_size ;
+	int64 expected_keys ; // number of keys to reserve space for, or 0
+	int64 budget ;      // most megabytes a table may take, or 0 for the
+                        // default (physical memory)
+	int ntables ;       // number of inner tables for cuckoo tables
+	bool compact ;      // whether cuckoo tables store compact slots
+	int64 capacity ;    // most keys a cuckoo cache holds, or 0 for a table
+                        // which grows
+	int cache_size ;    // number of front cache entries, or 0 for none
+	char *trace_path ;  // file to record operations to, or NULL
+	char *page_file ;   // file to store disk-resident tables in, or NULL
+	char *metrics_dest ; // file or socket to dump metrics to, or NULL
+	int metrics_interval ; // minimum seconds between metrics dumps
+	char *socket_path ; // Unix socket to serve the table on, or NULL
+	bool binary ;       // read binary records rather than text commands
 } Options ;
 
 Options get_options(int argc, char** argv) ;
@@ -27,28 +48,116 @@ Options get_options(int argc, char** argv) ;
 /* interpreter commands */
 #define INSERT 'i'
 #define LOOKUP 'l'
+#define ADD    'a'
+#define TOP    't'
 #define PRINT  'p'
 #define STATS  's'
+#define METRICS 'm'
+#define DUMP   'd'
 #define HELP   'h'
 #define QUIT   'q'
 #define MAX_LINE_LEN 80
+// number of keys listed by a top command without an argument
+#define DEFAULT_TOP_K 10
+// most keys a top command lists, bounding the memory it takes
+#define MAX_TOP_K (1 << 20)
 
-int get_command(char *operation, int64 *key) ;
+int get_command(char *operation, Key *key, char *arg) ;
+bool get_dump_options(char *arg, DumpOptions *options) ;
 /* -------------------- */
 
-void run_interpreter(HashTable *table) ;
+/* binary input */
+// a record is an operation character then a key in KEY_BITS/8 bytes
+#define RECORD_SIZE (1 + sizeof(Key))
+// number of records read and dispatched at a time (a multiple of 8)
+#define BINARY_BLOCK 4096
+/* ------------ */
+
+void run_interpreter(HashTable *table, Options options, TraceWriter *trace,
+  MetricsSink *metrics) ;
+bool run_binary(HashTable *table, TraceWriter *trace, MetricsSink *metrics) ;
 
 int main(int argc, char **argv) {
 	// get command line options and create table with specified parameters
 	Options options = get_options(argc, argv) ;
-	HashTable *table = new_hash_table(options.type, options.initial_size) ;
+	set_memory_budget(options.budget << 20) ;
+	HashTable *table ;
+	if (options.type == CUCKOO && options.capacity > 0) {
+		table = new_cuckoo_cache_table(options.capacity, options.ntables,
+		  options.compact) ;
+	} else if (options.type == CUCKOO && options.compact) {
+		table = new_compact_cuckoo_table(options.initial_size,
+		  options.ntables) ;
+	} else if (options.type == CUCKOO) {
+		table = new_dary_cuckoo_table(options.initial_size, options.ntables) ;
+	} else if (options.type == XTNDBLD) {
+		table = new_disk_hash_table(options.page_file, options.initial_size) ;
+	} else {
+		table = new_hash_table(options.type, options.initial_size) ;
+	}
+	if (!table) {
+		fprintf(stderr, "could not create page file '%s'\n",
+		  options.page_file ? options.page_file : "(temporary)") ;
+		exit(EXIT_FAILURE) ;
+	}
+	if (options.expected_keys > 0) {
+		hash_table_reserve(table, options.expected_keys) ;
+	}
+	if (options.cache_size > 0) {
+		hash_table_enable_cache(table, options.cache_size) ;
+	}
 
-	// start the interpreter loop
-	run_interpreter(table) ;
+	// start recording operations if asked to
+	TraceWriter *trace = NULL ;
+	if (options.trace_path) {
+		trace = new_trace_writer(options.trace_path) ;
+		if (!trace) {
+			fprintf(stderr, "could not create trace file '%s'\n",
+			  options.trace_path) ;
+			exit(EXIT_FAILURE) ;
+		}
+	}
+
+	// start dumping metrics if asked to
+	MetricsSink *metrics = NULL ;
+	if (options.metrics_dest) {
+		metrics = new_metrics_sink(options.metrics_dest,
+		  options.metrics_interval) ;
+		if (!metrics) {
+			fprintf(stderr, "could not open metrics destination '%s'\n",
+			  options.metrics_dest) ;
+			exit(EXIT_FAILURE) ;
+		}
+	}
+
+	// serve the table to clients if asked to, or start the interpreter loop
+	int status = EXIT_SUCCESS ;
+	if (options.socket_path) {
+		if (!run_server(table, options.socket_path, trace, metrics)) {
+			fprintf(stderr, "could not listen on socket '%s'\n",
+			  options.socket_path) ;
+			exit(EXIT_FAILURE) ;
+		}
+	} else if (options.binary) {
+		if (!run_binary(table, trace, metrics)) {
+			status = EXIT_FAILURE ;
+		}
+	} else {
+		run_interpreter(table, options, trace, metrics) ;
+	}
 
 	// quit
+	if (trace) {
+		free_trace_writer(trace) ;
+	}
+	if (metrics) {
+		// dump final metrics
+		hash_table_metrics(table, metrics_sink_file(metrics)) ;
+		metrics_sink_end(metrics) ;
+		free_metrics_sink(metrics) ;
+	}
 	free_hash_table(table) ;
-	return 0 ;
+	return status ;
 }
 
 
@@ -56,29 +165,53 @@ int main(int argc, char **argv) {
 void print_operations() {
 	printf(" %c number: insert 'number' into table\n",  INSERT) ;
 	printf(" %c number: lookup is 'number' in table\n", LOOKUP) ;
+	printf(" %c number [delta]: add 'delta' (default 1) to the count of "
+	  "'number'\n", ADD) ;
+	printf(" %c [k]: list the k (default %d) keys with the largest counts\n",
+	  TOP, DEFAULT_TOP_K) ;
 	printf(" %c: print table\n", PRINT) ;
 	printf(" %c: print stats\n", STATS) ;
+	printf(" %c: print metrics as JSON\n", METRICS) ;
+	printf(" %c [text|csv|binary] [all] [dir] [first [last]]: dump table\n",
+	  DUMP) ;
 	printf(" %c: quit\n", QUIT) ;
 }
 
 
 // run the interpreter
-void run_interpreter(HashTable *table) {
+// if trace is not NULL, every insert and lookup is recorded to it, and if
+// metrics is not NULL, the table's metrics are dumped to it when due
+void run_interpreter(HashTable *table, Options options, TraceWriter *trace,
+  MetricsSink *metrics) {
 	
 	printf("enter a command (h for help):\n") ;
 	
 	char op ;
-	int64 key ;
+	Key key ;
+	char keystr[KEY_STR_LEN] ;
+	char arg[MAX_LINE_LEN] ;
+
+	// string-keyed tables take the whole argument as their key
+	bool string_keys = has_string_keys(options.type) ;
 	
 	// get and execute commands until 'quit'
 	while (true) {
 
+		// dump metrics when due
+		if (metrics && metrics_sink_due(metrics)) {
+			hash_table_metrics(table, metrics_sink_file(metrics)) ;
+			metrics_sink_end(metrics) ;
+		}
+
 		// read a command, store results in op and key variables
-		int argc = get_command(&op, &key) ;
+		int argc = get_command(&op, &key, arg) ;
 		// no valid command entered, ignore
 		if (argc < 1) {
 			continue ; 
 		}
+		if (string_keys) {
+			argc = (arg[0] != '\0') ? 2 : 1 ;
+		}
 
 		// execute the command
 		switch (op) {
@@ -87,11 +220,20 @@ void run_interpreter(HashTable *table) {
 				if (argc < 2) {
 					printf("syntax: %c number\n", INSERT) ;
 				// perform the insertion
+				} else if (string_keys) {
+					if (hash_table_insert_str(table, arg, strlen(arg))) {
+						printf("%s inserted\n", arg) ;
+					} else {
+						printf("%s already in table\n", arg) ;
+					}
 				} else {
+					if (trace) {
+						trace_record(trace, INSERT, key) ;
+					}
 					if (hash_table_insert(table, key)) {
-						printf("%llu inserted\n", key) ;
+						printf("%s inserted\n", keytostr(key, keystr)) ;
 					} else {
-						printf("%llu already in table\n", key) ;
+						printf("%s already in table\n", keytostr(key, keystr)) ;
 					}
 				}
 				break ;
@@ -100,15 +242,76 @@ void run_interpreter(HashTable *table) {
 				// lookup commands must have an argument
 				if (argc < 2) {
 					printf("syntax: %c number\n", LOOKUP) ;
+				} else if (string_keys) {
+					// perform the lookup
+					if (hash_table_lookup_str(table, arg, strlen(arg))) {
+						printf("%s found\n", arg) ;
+					} else {
+						printf("%s not found\n", arg) ;
+					}
 				} else {
+					if (trace) {
+						trace_record(trace, LOOKUP, key) ;
+					}
 					// perform the lookup
 					if (hash_table_lookup(table, key)) {
-						printf("%llu found\n", key) ;
+						printf("%s found\n", keytostr(key, keystr)) ;
 					} else {
-						printf("%llu not found\n", key) ;
+						printf("%s not found\n", keytostr(key, keystr)) ;
+					}
+				}
+				break ;
+
+			case ADD: {
+				// add commands must have a key, then an optional delta, which
+				// can't be negative as counts are unsigned
+				long long delta = 1 ;
+				if (!has_counts(options.type)) {
+					printf("%s tables don't keep counts\n",
+					  typetostr(options.type)) ;
+				} else if (argc < 2 ||
+				  sscanf(arg, "%*s %lld", &delta) == 0 || delta < 0) {
+					printf("syntax: %c number [delta]\n", ADD) ;
+				} else {
+					int64 count ;
+					bool inserted = hash_table_increment(table, key, delta,
+					  &count) ;
+					printf("%s %s, count %llu\n", keytostr(key, keystr),
+					  inserted ? "inserted" : "counted", count) ;
+				}
+				break ;
+			}
+
+			case TOP: {
+				// the number of keys to list is optional, and is clamped to
+				// MAX_TOP_K before space is taken for that many
+				Key k = argc < 2 ? DEFAULT_TOP_K : key ;
+				if (!has_counts(options.type)) {
+					printf("%s tables don't keep counts\n",
+					  typetostr(options.type)) ;
+				} else if (k == 0) {
+					printf("syntax: %c [k]\n", TOP) ;
+				} else if (k > INT_MAX) {
+					printf("%c: k must be at most %d\n", TOP, INT_MAX) ;
+				} else {
+					if (k > MAX_TOP_K) {
+						k = MAX_TOP_K ;
 					}
+					Key *keys = malloc((sizeof *keys) * k) ;
+					assert(keys) ;
+					int64 *counts = malloc((sizeof *counts) * k) ;
+					assert(counts) ;
+					int n = hash_table_top_k(table, (int)k, keys, counts) ;
+					int i ;
+					for (i=0; i<n; i++) {
+						printf("%s %llu\n", keytostr(keys[i], keystr),
+						  counts[i]) ;
+					}
+					free(keys) ;
+					free(counts) ;
 				}
 				break ;
+			}
 
 			case PRINT:
 				hash_table_print(table) ;
@@ -118,6 +321,22 @@ void run_interpreter(HashTable *table) {
 				hash_table_stats(table) ;
 				break ;
 
+			case METRICS:
+				hash_table_metrics(table, stdout) ;
+				printf("\n") ;
+				break ;
+
+			case DUMP: {
+				DumpOptions dump ;
+				if (!get_dump_options(arg, &dump)) {
+					printf("syntax: %c [text|csv|binary] [all] [dir] "
+					  "[first [last]]\n", DUMP) ;
+				} else if (!hash_table_dump(table, stdout, dump)) {
+					printf("string tables can't be dumped\n") ;
+				}
+				break ;
+			}
+
 			default:
 				printf("unknown operation '%c'\n", op) ;
 				// fall through
@@ -135,13 +354,84 @@ void run_interpreter(HashTable *table) {
 }
 
 
+// run the binary input mode, reading fixed-width records from stdin in
+// blocks until the end of input. for each block, writes a bitmap to stdout
+// with a bit per record (the lowest bit of each byte first), set if the
+// record's key was inserted or found. records with other operations are
+// ignored and get a clear bit. each block's bitmap is flushed as soon as it
+// is written, so a producer may wait for it before sending the next block
+// if trace is not NULL, every insert and lookup is recorded to it, and if
+// metrics is not NULL, the table's metrics are dumped to it when due
+// returns false if the input ended partway through a record or couldn't be
+// read, once every whole record before that has been run
+bool run_binary(HashTable *table, TraceWriter *trace, MetricsSink *metrics) {
+	static unsigned char records[BINARY_BLOCK * RECORD_SIZE] ;
+	char ops[BINARY_BLOCK] ;
+	Key keys[BINARY_BLOCK] ;
+	unsigned char bitmap[BINARY_BLOCK / 8] ;
+
+	// read whole blocks of bytes, as a block read in records would quietly
+	// drop the bytes of a partial record at the end of the input
+	size_t nbytes, nrecords ;
+	while ((nbytes = fread(records, 1, sizeof records, stdin)) > 0) {
+		nrecords = nbytes / RECORD_SIZE ;
+
+		// split the block into operations and keys
+		size_t i ;
+		for (i=0; i<nrecords; i++) {
+			ops[i] = records[i * RECORD_SIZE] ;
+			memcpy(&keys[i], records + i * RECORD_SIZE + 1, sizeof(Key)) ;
+		}
+
+		// dispatch the block to the table
+		memset(bitmap, 0, (nrecords + 7) / 8) ;
+		for (i=0; i<nrecords; i++) {
+			bool result ;
+			if (ops[i] == INSERT) {
+				result = hash_table_insert(table, keys[i]) ;
+			} else if (ops[i] == LOOKUP) {
+				result = hash_table_lookup(table, keys[i]) ;
+			} else {
+				continue ;
+			}
+			if (trace) {
+				trace_record(trace, ops[i], keys[i]) ;
+			}
+			bitmap[i / 8] |= result << (i % 8) ;
+		}
+		fwrite(bitmap, 1, (nrecords + 7) / 8, stdout) ;
+		fflush(stdout) ;
+
+		// dump metrics when due
+		if (metrics && metrics_sink_due(metrics)) {
+			hash_table_metrics(table, metrics_sink_file(metrics)) ;
+			metrics_sink_end(metrics) ;
+		}
+
+		// a short read only happens at the end of the input
+		if (nbytes % RECORD_SIZE) {
+			fprintf(stderr, "input ends with a partial record of %d bytes\n",
+			  (int)(nbytes % RECORD_SIZE)) ;
+			return false ;
+		}
+	}
+	if (ferror(stdin)) {
+		fprintf(stderr, "could not read records from stdin\n") ;
+		return false ;
+	}
+	return true ;
+}
+
+
 // reads a line from stdin, parses it into an operation character and possibly
-// a long long uinteger argument. store results in *operation and *key, resp.
+// an unsigned integer key argument. store results in *operation and *key, resp.
+// the raw argument text, without surrounding whitespace, is copied into arg
+// (of at least MAX_LINE_LEN characters) for string-keyed tables
 //
 // returns the number of tokens successfully read (e.g. 0 for none,
 // 1 for operation only, 2 for both operation and integer)
 // written by Matt Farrugia
-int get_command(char *operation, int64 *key) {
+int get_command(char *operation, Key *key, char *arg) {
 	
 	// read a line from stdin, up to MAX_LINE_LENGTH, into character buffer
 	char line[MAX_LINE_LEN] ;
@@ -149,10 +439,29 @@ int get_command(char *operation, int64 *key) {
 	// strip trailing newline
 	line[strlen(line)-1] = '\0' ;
 
+	// copy out the argument text following the operation character
+	arg[0] = '\0' ;
+	if (line[0] != '\0') {
+		char *start = line + 1 ;
+		while (isspace((unsigned char)*start)) {
+			start++ ;
+		}
+		char *end = start + strlen(start) ;
+		while (end > start && isspace((unsigned char)end[-1])) {
+			end-- ;
+		}
+		memcpy(arg, start, end - start) ;
+		arg[end - start] = '\0' ;
+	}
+
 	// attempt to parse the line string into *operation and *key
-	int argc = sscanf(line, "%c %llu", operation, key) ;
-	// note: since llu is unsigned, a command like 'i -1' will overflow,
-	// resulting in *key = 18446744073709551615 (2^64-1). this is a feature.
+	int argc = sscanf(line, "%c", operation) ;
+	if (argc == 1 && strtokey(line + 1, key)) {
+		argc++ ;
+	}
+	// note: since keys are unsigned, a command like 'i -1' will overflow,
+	// resulting in *key = 2^KEY_BITS-1 (e.g. 18446744073709551615). this is a
+	// feature.
 	
 	// return the number of variables successfully read, as required
 	return argc ;
@@ -160,17 +469,60 @@ int get_command(char *operation, int64 *key) {
 
 
 
+// parses the arguments of a dump command into *options: a format (text by
+// default), 'all' to include empty slots, 'dir' to summarise extendible
+// tables' directories, and the first and last addresses to dump
+// returns false if an argument wasn't recognised
+bool get_dump_options(char *arg, DumpOptions *options) {
+	options->format = DUMP_TEXT ;
+	options->first = 0 ;
+	options->last = (int64)-1 ;
+	options->occupied = true ;
+	options->directory = false ;
+
+	int naddresses = 0 ;
+	char *word ;
+	for (word=strtok(arg, " \t"); word; word=strtok(NULL, " \t")) {
+		if (strcmp(word, "text") == 0) {
+			options->format = DUMP_TEXT ;
+		} else if (strcmp(word, "csv") == 0) {
+			options->format = DUMP_CSV ;
+		} else if (strcmp(word, "binary") == 0) {
+			options->format = DUMP_BINARY ;
+		} else if (strcmp(word, "all") == 0) {
+			options->occupied = false ;
+		} else if (strcmp(word, "dir") == 0) {
+			options->directory = true ;
+		} else if (isdigit((unsigned char)word[0]) && naddresses < 2) {
+			int64 address = strtoull(word, NULL, 10) ;
+			if (naddresses++ == 0) {
+				options->first = address ;
+			} else {
+				options->last = address + 1 ;
+			}
+		} else {
+			return false ;
+		}
+	}
+	return true ;
+}
+
+
 // scans command line arguments for program options,
 // prints usage info and exits if commands are missing or otherwise invalid
 // written by Matt Farrugia
 Options get_options(int argc, char** argv) {
 	
 	// create the Options structure with defaults
-	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE } ;
+	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE,
+		.expected_keys = 0, .budget = 0, .ntables = 2, .compact = false,
+		.capacity = 0, .cache_size = 0, .trace_path = NULL, .page_file = NULL,
+		.metrics_dest = NULL, .metrics_interval = 1, .socket_path = NULL,
+		.binary = false } ;
 
 	// scan inputs by flag
 	char option ;
-	while ((option = getopt(argc, argv, "t:s:")) != EOF) {
+	while ((option = getopt(argc, argv, "t:s:r:n:B:d:qC:m:M:c:f:l:b")) != EOF) {
 		switch (option) {
 			// set hash table type
 			case 't':
@@ -178,7 +530,55 @@ Options get_options(int argc, char** argv) {
 				break ;
 			// set hash table size
 			case 's':
-				options.initial_size = atoi(optarg) ;
+				options.initial_size = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set number of keys to reserve space for
+			case 'n':
+				options.expected_keys = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set the memory budget of the table, in megabytes
+			case 'B':
+				options.budget = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set number of inner tables for cuckoo tables
+			case 'd':
+				options.ntables = atoi(optarg) ;
+				break ;
+			// store compact slots in cuckoo tables
+			case 'q':
+				options.compact = true ;
+				break ;
+			// make cuckoo tables caches of a fixed capacity
+			case 'C':
+				options.capacity = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set number of front cache entries
+			case 'c':
+				options.cache_size = atoi(optarg) ;
+				break ;
+			// record operations to a trace file
+			case 'r':
+				options.trace_path = optarg ;
+				break ;
+			// store a disk-resident table's pages in a file
+			case 'f':
+				options.page_file = optarg ;
+				break ;
+			// dump metrics to a file or socket
+			case 'm':
+				options.metrics_dest = optarg ;
+				break ;
+			// set seconds between metrics dumps
+			case 'M':
+				options.metrics_interval = atoi(optarg) ;
+				break ;
+			// serve the table on a Unix socket
+			case 'l':
+				options.socket_path = optarg ;
+				break ;
+			// read binary records from stdin
+			case 'b':
+				options.binary = true ;
 				break ;
 			default:
 				break ;
@@ -195,16 +595,94 @@ Options get_options(int argc, char** argv) {
 		fprintf(stderr,
 			" -t 1 or xtnbdln: n-key extendible hash table\n") ;
 		fprintf(stderr, " -t 2 or xuckoo:  extendible cuckoo table\n") ;
+		fprintf(stderr,
+			" -t 3 or xtndbls: n-key extendible table of string keys\n") ;
+		fprintf(stderr, " -t 4 or adaptive: table which migrates between types "
+			"to suit the workload\n") ;
+		fprintf(stderr,
+			" -t 5 or xtndbld: disk-resident extendible hash table\n") ;
+		fprintf(stderr,
+			" -t 6 or xtndblc: concurrent extendible hash table\n") ;
 		valid = false ;
 	}
 
 	// validate table size
-	if(options.initial_size <= 0) {
+	if(options.initial_size == 0) {
 		fprintf(stderr,
 			"please specify initial table size (>0) using the -s flag\n") ;
 		valid = false ;
 	}
 
+	// validate number of cuckoo tables
+	if(options.ntables < 2 || options.ntables > 4) {
+		fprintf(stderr,
+			"please specify 2 to 4 cuckoo tables using the -d flag\n") ;
+		valid = false ;
+	}
+	if(options.compact && options.type != CUCKOO) {
+		fprintf(stderr, "-q can only be given for cuckoo tables\n") ;
+		valid = false ;
+	}
+	if(options.capacity > 0 && options.type != CUCKOO) {
+		fprintf(stderr, "-C can only be given for cuckoo tables\n") ;
+		valid = false ;
+	}
+
+	// the front cache isn't shared safely between threads
+	if(options.cache_size > 0 && options.type == XTNDBLC) {
+		fprintf(stderr, "-c can't be given for concurrent tables\n") ;
+		valid = false ;
+	}
+
+	// a cuckoo cache evicts keys the front cache would still report found
+	if(options.cache_size > 0 && options.capacity > 0) {
+		fprintf(stderr, "-c can't be given with -C\n") ;
+		valid = false ;
+	}
+
+	// validate metrics interval
+	if(options.metrics_interval < 0) {
+		fprintf(stderr,
+			"please specify seconds between metrics dumps (>=0) using -M\n") ;
+		valid = false ;
+	}
+
+	// traces only hold integer keys
+	if(options.trace_path && has_string_keys(options.type)) {
+		fprintf(stderr, "-r can only record tables of integer keys\n") ;
+		valid = false ;
+	}
+
+	// only disk-resident tables have a page file
+	if(options.page_file && options.type != XTNDBLD) {
+		fprintf(stderr, "-f can only be given for disk-resident tables\n") ;
+		valid = false ;
+	}
+
+	// the front cache only holds integer keys
+	if(options.cache_size > 0 && has_string_keys(options.type)) {
+		fprintf(stderr, "-c can only cache tables of integer keys\n") ;
+		valid = false ;
+	}
+
+	// the server protocol only carries integer keys
+	if(options.socket_path && has_string_keys(options.type)) {
+		fprintf(stderr, "-l can only serve tables of integer keys\n") ;
+		valid = false ;
+	}
+
+	// binary records only hold integer keys
+	if(options.binary && has_string_keys(options.type)) {
+		fprintf(stderr, "-b can only read tables of integer keys\n") ;
+		valid = false ;
+	}
+
+	// the server takes its commands from its clients instead
+	if(options.binary && options.socket_path) {
+		fprintf(stderr, "-b and -l can't be given together\n") ;
+		valid = false ;
+	}
+
 	if(!valid) {
 		exit(EXIT_FAILURE) ;
 	}
@@ -0,0 +1,193 @@
+/* * * * * * * * *
+ * Machine-readable table metrics: the histograms and resize logs kept by
+ * tables, written out as JSON, and sinks which the metrics of a table are
+ * dumped to periodically
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include     <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <assert.h>
+#include      <time.h>
+#include    <unistd.h>
+#include    <signal.h>
+#include <sys/socket.h>
+#include    <sys/un.h>
+
+#include "metrics.h"
+
+// prefix of a sink destination naming a Unix socket rather than a file
+#define UNIX_PREFIX "unix:"
+
+struct metrics_sink {
+	FILE *file ;        // stream dumps are written to
+	int interval ;      // minimum number of seconds between dumps
+	time_t last ;       // when the last dump was due, or 0 before the first
+} ;
+
+/* * * *
+ * helper functions
+ */
+
+// connects to the Unix stream socket at path
+// returns a stream writing to it, or NULL if it couldn't be connected to
+static FILE *connect_unix_socket(const char *path) {
+	struct sockaddr_un address ;
+	if (strlen(path) >= sizeof address.sun_path) {
+		return NULL ;
+	}
+	memset(&address, 0, sizeof address) ;
+	address.sun_family = AF_UNIX ;
+	strcpy(address.sun_path, path) ;
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0) ;
+	if (fd < 0) {
+		return NULL ;
+	}
+	if (connect(fd, (struct sockaddr *)&address, sizeof address) < 0) {
+		close(fd) ;
+		return NULL ;
+	}
+	return fdopen(fd, "w") ;
+}
+
+/* * * *
+ * histograms
+ */
+
+// empties a histogram
+void clear_log2_histogram(Log2Histogram *histogram) {
+	memset(histogram->counts, 0, sizeof histogram->counts) ;
+}
+
+// counts a value in a histogram, by its number of significant bits
+void log2_histogram_add(Log2Histogram *histogram, int64 value) {
+	int bucket = 0 ;
+	while (bucket < HISTOGRAM_SIZE - 1 && (value >> bucket) > 0) {
+		bucket++ ;
+	}
+	histogram->counts[bucket]++ ;
+}
+
+// writes a histogram to out as a JSON array
+void log2_histogram_json(Log2Histogram *histogram, FILE *out) {
+	int n = HISTOGRAM_SIZE ;
+	while (n > 0 && histogram->counts[n-1] == 0) {
+		n-- ;
+	}
+	counts_json(histogram->counts, n, out) ;
+}
+
+// writes the n counts of a distribution to out as a JSON array
+void counts_json(const int64 *counts, int n, FILE *out) {
+	fprintf(out, "[") ;
+	int i ;
+	for (i=0; i<n; i++) {
+		fprintf(out, i ? ",%llu" : "%llu", counts[i]) ;
+	}
+	fprintf(out, "]") ;
+}
+
+/* * * *
+ * resize logs
+ */
+
+// empties a resize log
+void clear_resize_log(ResizeLog *log) {
+	log->nresizes = 0 ;
+	log->total_usecs = 0 ;
+	clear_log2_histogram(&log->usecs) ;
+}
+
+// records a resize to the given size which started at CPU time start
+void resize_log_add(ResizeLog *log, int64 size, clock_t start) {
+	int64 usecs = (clock() - start) * 1000000 / CLOCKS_PER_SEC ;
+
+	ResizeEvent *event = &log->recent[log->nresizes % RESIZE_LOG_SIZE] ;
+	event->size = size ;
+	event->usecs = usecs ;
+
+	log->nresizes++ ;
+	log->total_usecs += usecs ;
+	log2_histogram_add(&log->usecs, usecs) ;
+}
+
+// writes a resize log to out as a JSON object, listing recent resizes
+// oldest first
+void resize_log_json(ResizeLog *log, FILE *out) {
+	fprintf(out, "{\"count\":%llu,\"total_usecs\":%llu,\"usecs\":",
+	  log->nresizes, log->total_usecs) ;
+	log2_histogram_json(&log->usecs, out) ;
+
+	fprintf(out, ",\"recent\":[") ;
+	int64 first = log->nresizes > RESIZE_LOG_SIZE
+	  ? log->nresizes - RESIZE_LOG_SIZE : 0 ;
+	int64 i ;
+	for (i=first; i<log->nresizes; i++) {
+		ResizeEvent *event = &log->recent[i % RESIZE_LOG_SIZE] ;
+		fprintf(out, "%s{\"size\":%llu,\"usecs\":%llu}", i > first ? "," : "",
+		  event->size, event->usecs) ;
+	}
+	fprintf(out, "]}") ;
+}
+
+/* * * *
+ * sinks
+ */
+
+// opens a sink which metrics are dumped to at most once every interval
+// seconds, appending to a file or writing to a Unix socket
+// returns NULL if the file couldn't be opened or the socket connected to
+MetricsSink *new_metrics_sink(const char *dest, int interval) {
+	FILE *file ;
+	if (strncmp(dest, UNIX_PREFIX, strlen(UNIX_PREFIX)) == 0) {
+		file = connect_unix_socket(dest + strlen(UNIX_PREFIX)) ;
+		// a collector going away shouldn't take the table down with it
+		signal(SIGPIPE, SIG_IGN) ;
+	} else {
+		file = fopen(dest, "a") ;
+	}
+	if (!file) {
+		return NULL ;
+	}
+
+	MetricsSink *sink = malloc(sizeof *sink) ;
+	assert(sink) ;
+	sink->file = file ;
+	sink->interval = interval ;
+	sink->last = 0 ;
+	return sink ;
+}
+
+// the stream to write a dump to
+FILE *metrics_sink_file(MetricsSink *sink) {
+	return sink->file ;
+}
+
+// is a dump due? true at most once every interval seconds
+bool metrics_sink_due(MetricsSink *sink) {
+	struct timespec now ;
+	clock_gettime(CLOCK_MONOTONIC, &now) ;
+	if (sink->last != 0 && now.tv_sec - sink->last < sink->interval) {
+		return false ;
+	}
+	sink->last = now.tv_sec ;
+	return true ;
+}
+
+// ends a dump written to a sink, flushing it out
+void metrics_sink_end(MetricsSink *sink) {
+	fputc('\n', sink->file) ;
+	fflush(sink->file) ;
+}
+
+// closes a sink and frees it
+void free_metrics_sink(MetricsSink *sink) {
+	assert(sink) ;
+	fclose(sink->file) ;
+	free(sink) ;
+}
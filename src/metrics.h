@@ -0,0 +1,89 @@
+/* * * * * * * * *
+ * Machine-readable table metrics: the histograms and resize logs kept by
+ * tables, written out as JSON, and sinks which the metrics of a table are
+ * dumped to periodically
+ *
+ * a histogram is written as an array of counts, where index 0 counts zeros
+ * and index b counts values in [2^(b-1), 2^b), up to the last non-zero count
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include   <stdio.h>
+#include <stdbool.h>
+#include    <time.h>
+#include "inthash.h"
+
+/* histograms */
+#define HISTOGRAM_SIZE 32
+typedef struct log2_histogram {
+	int64 counts[HISTOGRAM_SIZE] ;
+} Log2Histogram ;
+
+// empties a histogram
+void clear_log2_histogram(Log2Histogram *histogram) ;
+
+// counts a value in a histogram, by its number of significant bits
+void log2_histogram_add(Log2Histogram *histogram, int64 value) ;
+
+// writes a histogram to out as a JSON array
+void log2_histogram_json(Log2Histogram *histogram, FILE *out) ;
+
+// writes the n counts of a distribution (e.g. of bucket depths, indexed by
+// depth) to out as a JSON array
+void counts_json(const int64 *counts, int n, FILE *out) ;
+/* ---------- */
+
+/* resize logs */
+#define RESIZE_LOG_SIZE 8
+typedef struct resize_event {
+	int64 size ;        // size of the table after the resize
+	int64 usecs ;       // how long the resize took, in microseconds of CPU
+} ResizeEvent ;
+
+// a record of every time a table grew: totals, the distribution of their
+// durations, and the details of the most recent few
+typedef struct resize_log {
+	int64 nresizes ;    // number of resizes
+	int64 total_usecs ; // CPU time spent resizing, in microseconds
+	Log2Histogram usecs ; // durations of every resize
+	ResizeEvent recent[RESIZE_LOG_SIZE] ; // latest resizes, as a ring
+} ResizeLog ;
+
+// empties a resize log
+void clear_resize_log(ResizeLog *log) ;
+
+// records a resize to the given size which started at CPU time start
+void resize_log_add(ResizeLog *log, int64 size, clock_t start) ;
+
+// writes a resize log to out as a JSON object, listing recent resizes
+// oldest first
+void resize_log_json(ResizeLog *log, FILE *out) ;
+/* ----------- */
+
+/* sinks */
+typedef struct metrics_sink MetricsSink ;
+
+// opens a sink which metrics are dumped to, one JSON object per line, at most
+// once every interval seconds. dest is a file to append to, or 'unix:' then
+// the path of a listening Unix stream socket to connect to
+// returns NULL if the file couldn't be opened or the socket connected to
+MetricsSink *new_metrics_sink(const char *dest, int interval) ;
+
+// the stream to write a dump to
+FILE *metrics_sink_file(MetricsSink *sink) ;
+
+// is a dump due? true at most once every interval seconds
+bool metrics_sink_due(MetricsSink *sink) ;
+
+// ends a dump written to a sink, flushing it out
+void metrics_sink_end(MetricsSink *sink) ;
+
+// closes a sink and frees it
+void free_metrics_sink(MetricsSink *sink) ;
+/* ----- */
+
+#endif
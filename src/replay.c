@@ -0,0 +1,316 @@
+/* * * * * * * * *
+ * Trace replay program:
+ * replays a binary operation trace recorded by 'ht -r' against any type of
+ * hash table, and reports throughput, latency distribution and table stats
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include   <stdio.h>
+#include  <stdlib.h>
+#include <stdbool.h>
+#include  <unistd.h>
+#include    <time.h>
+
+#include "inthash.h"
+#include "hashtbl.h"
+#include "trace.h"
+#include "budget.h"
+
+/* cli options */
+#define DEFAULT_SIZE 4
+typedef struct options {
+	TableType type ;
+	int64 initial_size ;
+	int64 expected_keys ; // number of keys to reserve space for, or 0
+	int64 budget ;      // most megabytes a table may take, or 0 for the
+                        // default (physical memory)
+	int ntables ;       // number of inner tables for cuckoo tables
+	bool compact ;      // whether cuckoo tables store compact slots
+	int64 capacity ;    // most keys a cuckoo cache holds, or 0 for a table
+                        // which grows
+	int cache_size ;    // number of front cache entries, or 0 for none
+	bool paced ;        // replay at the recorded pacing rather than flat out
+	char *trace_path ;
+} Options ;
+
+Options get_options(int argc, char** argv) ;
+/* ------------ */
+
+/* latency histogram */
+// latencies are counted in buckets by their number of significant bits,
+// so bucket b holds latencies in [2^(b-1), 2^b) nanoseconds
+#define NUM_BUCKETS 64
+typedef struct histogram {
+	int64 counts[NUM_BUCKETS] ;
+	int64 total ;
+	int64 min ;
+	int64 max ;
+} Histogram ;
+
+void add_latency(Histogram *histogram, int64 latency) ;
+void print_histogram(Histogram *histogram) ;
+/* ----------------- */
+
+// sleeps until the given time from a monotonic clock, in nanoseconds
+void sleep_until(int64 time) ;
+
+int main(int argc, char **argv) {
+	Options options = get_options(argc, argv) ;
+
+	TraceReader *trace = new_trace_reader(options.trace_path) ;
+	if (!trace) {
+		fprintf(stderr, "could not read trace file '%s' (or it was recorded "
+		  "with a different KEY_BITS)\n", options.trace_path) ;
+		exit(EXIT_FAILURE) ;
+	}
+	set_memory_budget(options.budget << 20) ;
+	HashTable *table ;
+	if (options.type == CUCKOO && options.capacity > 0) {
+		table = new_cuckoo_cache_table(options.capacity, options.ntables,
+		  options.compact) ;
+	} else if (options.type == CUCKOO && options.compact) {
+		table = new_compact_cuckoo_table(options.initial_size,
+		  options.ntables) ;
+	} else if (options.type == CUCKOO) {
+		table = new_dary_cuckoo_table(options.initial_size, options.ntables) ;
+	} else {
+		table = new_hash_table(options.type, options.initial_size) ;
+	}
+	if (!table) {
+		fprintf(stderr, "could not create table\n") ;
+		exit(EXIT_FAILURE) ;
+	}
+	if (options.expected_keys > 0) {
+		hash_table_reserve(table, options.expected_keys) ;
+	}
+	if (options.cache_size > 0) {
+		hash_table_enable_cache(table, options.cache_size) ;
+	}
+
+	Histogram insert_latency = { .min = INT64_MAX } ;
+	Histogram lookup_latency = { .min = INT64_MAX } ;
+	int64 nfound = 0, ninserted = 0 ;
+
+	// replay every operation, timing each one
+	char op ;
+	Key key ;
+	int64 time ;
+	int64 start = trace_now() ;
+	while (trace_next(trace, &op, &key, &time)) {
+		if (options.paced) {
+			sleep_until(start + time) ;
+		}
+
+		int64 before = trace_now() ;
+		switch (op) {
+			case 'i':
+				ninserted += hash_table_insert(table, key) ;
+				add_latency(&insert_latency, trace_now() - before) ;
+				break ;
+			case 'l':
+				nfound += hash_table_lookup(table, key) ;
+				add_latency(&lookup_latency, trace_now() - before) ;
+				break ;
+			default:
+				break ;
+		}
+	}
+	double seconds = (trace_now() - start) * 1.0e-9 ;
+	int64 nops = insert_latency.total + lookup_latency.total ;
+
+	// print the results
+	printf("----- replay -----\n") ;
+	printf("operations        :\t%llu\n", nops) ;
+	printf("  inserts         :\t%llu (%llu new)\n", insert_latency.total,
+	  ninserted) ;
+	printf("  lookups         :\t%llu (%llu found)\n", lookup_latency.total,
+	  nfound) ;
+	printf("wall time         :\t%.6f sec\n", seconds) ;
+	printf("throughput        :\t%.0f ops/sec\n", nops / seconds) ;
+
+	printf("\ninsert latency:\n") ;
+	print_histogram(&insert_latency) ;
+	printf("\nlookup latency:\n") ;
+	print_histogram(&lookup_latency) ;
+	printf("--- end replay ---\n") ;
+
+	hash_table_stats(table) ;
+
+	free_hash_table(table) ;
+	free_trace_reader(trace) ;
+	return 0 ;
+}
+
+// counts one operation's latency, in nanoseconds, in a histogram
+void add_latency(Histogram *histogram, int64 latency) {
+	int bucket = 0 ;
+	while (bucket < NUM_BUCKETS - 1 && (latency >> bucket) > 0) {
+		bucket++ ;
+	}
+	histogram->counts[bucket]++ ;
+	histogram->total++ ;
+	if (latency < histogram->min) {
+		histogram->min = latency ;
+	}
+	if (latency > histogram->max) {
+		histogram->max = latency ;
+	}
+}
+
+// prints percentiles and the non-empty buckets of a latency histogram
+// percentiles are given as the upper bound of the bucket they fall in
+void print_histogram(Histogram *histogram) {
+	if (histogram->total == 0) {
+		printf("  (none)\n") ;
+		return ;
+	}
+	printf("  min: %llu ns, max: %llu ns\n", histogram->min, histogram->max) ;
+
+	double percentiles[] = { 50, 90, 99, 99.9 } ;
+	int npercentiles = sizeof percentiles / sizeof *percentiles ;
+	int p = 0 ;
+	int64 seen = 0 ;
+	int b ;
+	for (b=0; b<NUM_BUCKETS; b++) {
+		seen += histogram->counts[b] ;
+		while (p < npercentiles &&
+		  seen >= histogram->total * percentiles[p] / 100) {
+			printf("  p%-5g <= %llu ns\n", percentiles[p], (int64)1 << b) ;
+			p++ ;
+		}
+	}
+
+	for (b=0; b<NUM_BUCKETS; b++) {
+		if (histogram->counts[b] > 0) {
+			printf("  %10llu - %-10llu ns: %llu\n",
+			  b ? (int64)1 << (b-1) : 0, ((int64)1 << b) - 1,
+			  histogram->counts[b]) ;
+		}
+	}
+}
+
+// sleeps until the given time from a monotonic clock, in nanoseconds
+void sleep_until(int64 time) {
+	int64 now = trace_now() ;
+	if (time <= now) {
+		return ;
+	}
+	struct timespec wait = {
+		.tv_sec = (time - now) / 1000000000,
+		.tv_nsec = (time - now) % 1000000000
+	} ;
+	nanosleep(&wait, NULL) ;
+}
+
+// scans command line arguments for program options,
+// prints usage info and exits if commands are missing or otherwise invalid
+Options get_options(int argc, char** argv) {
+
+	// create the Options structure with defaults
+	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE,
+		.expected_keys = 0, .budget = 0, .ntables = 2, .compact = false,
+		.capacity = 0, .cache_size = 0, .paced = false, .trace_path = NULL } ;
+
+	// scan inputs by flag
+	int option ;
+	while ((option = getopt(argc, argv, "t:s:n:B:d:qC:c:p")) != -1) {
+		switch (option) {
+			// set hash table type
+			case 't':
+				options.type = strtotype(optarg) ;
+				break ;
+			// set hash table size
+			case 's':
+				options.initial_size = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set number of keys to reserve space for
+			case 'n':
+				options.expected_keys = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set the memory budget of the table, in megabytes
+			case 'B':
+				options.budget = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set number of inner tables for cuckoo tables
+			case 'd':
+				options.ntables = atoi(optarg) ;
+				break ;
+			// store compact slots in cuckoo tables
+			case 'q':
+				options.compact = true ;
+				break ;
+			// make cuckoo tables caches of a fixed capacity
+			case 'C':
+				options.capacity = strtoull(optarg, NULL, 10) ;
+				break ;
+			// set number of front cache entries
+			case 'c':
+				options.cache_size = atoi(optarg) ;
+				break ;
+			// replay at the recorded pacing
+			case 'p':
+				options.paced = true ;
+				break ;
+			default:
+				break ;
+		}
+	}
+	if (optind < argc) {
+		options.trace_path = argv[optind] ;
+	}
+
+	bool valid = true ;
+
+	if(options.type == NOTYPE || has_string_keys(options.type)) {
+		fprintf(stderr,
+			"please specify an integer table type using the -t flag\n") ;
+		valid = false ;
+	}
+	if(options.initial_size == 0) {
+		fprintf(stderr,
+			"please specify initial table size (>0) using the -s flag\n") ;
+		valid = false ;
+	}
+	if(options.ntables < 2 || options.ntables > 4) {
+		fprintf(stderr,
+			"please specify 2 to 4 cuckoo tables using the -d flag\n") ;
+		valid = false ;
+	}
+	if(options.compact && options.type != CUCKOO) {
+		fprintf(stderr, "-q can only be given for cuckoo tables\n") ;
+		valid = false ;
+	}
+	if(options.capacity > 0 && options.type != CUCKOO) {
+		fprintf(stderr, "-C can only be given for cuckoo tables\n") ;
+		valid = false ;
+	}
+
+	// the front cache isn't shared safely between threads
+	if(options.cache_size > 0 && options.type == XTNDBLC) {
+		fprintf(stderr, "-c can't be given for concurrent tables\n") ;
+		valid = false ;
+	}
+
+	// a cuckoo cache evicts keys the front cache would still report found
+	if(options.cache_size > 0 && options.capacity > 0) {
+		fprintf(stderr, "-c can't be given with -C\n") ;
+		valid = false ;
+	}
+	if(!options.trace_path) {
+		fprintf(stderr, "please give a trace file to replay\n") ;
+		valid = false ;
+	}
+
+	if(!valid) {
+		fprintf(stderr,
+		  "usage: %s -t type [-s size] [-n keys] [-B megabytes] [-d tables] "
+		  "[-q] [-C capacity] [-c entries] [-p] trace\n",
+		  argv[0]) ;
+		exit(EXIT_FAILURE) ;
+	}
+
+	return options ;
+}
@@ -0,0 +1,349 @@
+/* * * * * * * * *
+ * Table server: serves one integer-keyed table to any number of local
+ * clients over a Unix domain stream socket, from a single-threaded epoll
+ * event loop, so that several processes can share one copy of a key set
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include      <stdio.h>
+#include     <stdlib.h>
+#include     <string.h>
+#include     <assert.h>
+#include     <stdint.h>
+#include     <unistd.h>
+#include      <fcntl.h>
+#include      <errno.h>
+#include     <signal.h>
+#include  <sys/epoll.h>
+#include <sys/socket.h>
+#include     <sys/un.h>
+
+#include "server.h"
+
+// each request and response starts with an operation byte and a key count
+#define HEADER_SIZE (1 + sizeof(uint32_t))
+#define KEY_SIZE (KEY_BITS / 8)
+
+// most bytes read from a client at once
+#define READ_CHUNK 65536
+
+// a client with this many bytes of responses unsent isn't read from until
+// it catches up, so a client which never reads can't grow them unbounded
+#define MAX_PENDING_OUTPUT (1 << 20)
+
+// most events handled per wait
+#define MAX_EVENTS 64
+
+// a growable byte buffer
+typedef struct buffer {
+	char *data ;
+	int len ;           // number of bytes in use
+	int cap ;           // number of bytes allocated
+} Buffer ;
+
+typedef struct client {
+	int fd ;
+	int index ;         // position in the server's list of clients
+	Buffer in ;         // bytes received, not yet processed
+	Buffer out ;        // responses not yet fully sent
+	int sent ;          // bytes of out already sent
+	bool closing ;      // has the client finished sending?
+	uint32_t events ;   // events being watched for
+} Client ;
+
+typedef struct server {
+	HashTable *table ;
+	TraceWriter *trace ;
+	int epoll ;         // epoll instance watching the listener and clients
+	int listener ;      // listening socket
+	Client **clients ;  // connected clients
+	int nclients ;
+	int capacity ;      // number of clients there is room for
+	int64 naccepted ;   // number of clients ever connected
+	int64 nrequests ;   // number of requests served
+	int64 nkeys ;       // number of keys inserted or looked up
+} Server ;
+
+// set when the server is asked to stop
+static volatile sig_atomic_t stopping = 0 ;
+
+/* * * *
+ * helper functions
+ */
+
+static void stop_server(int signal) {
+	stopping = 1 ;
+}
+
+// makes room in a buffer for extra more bytes
+static void buffer_reserve(Buffer *buffer, int extra) {
+	if (buffer->len + extra <= buffer->cap) {
+		return ;
+	}
+	int cap = buffer->cap ? buffer->cap : READ_CHUNK ;
+	while (cap < buffer->len + extra) {
+		cap *= 2 ;
+	}
+	buffer->data = realloc(buffer->data, cap) ;
+	assert(buffer->data) ;
+	buffer->cap = cap ;
+}
+
+// number of response bytes a client has not been sent yet
+static int pending_output(Client *client) {
+	return client->out.len - client->sent ;
+}
+
+// opens a non-blocking listening socket at path
+// returns its descriptor, or -1 if it couldn't be opened
+static int listen_unix_socket(const char *path) {
+	struct sockaddr_un address ;
+	if (strlen(path) >= sizeof address.sun_path) {
+		return -1 ;
+	}
+	memset(&address, 0, sizeof address) ;
+	address.sun_family = AF_UNIX ;
+	strcpy(address.sun_path, path) ;
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0) ;
+	if (fd < 0) {
+		return -1 ;
+	}
+	unlink(path) ;
+	if (bind(fd, (struct sockaddr *)&address, sizeof address) < 0 ||
+	  listen(fd, SOMAXCONN) < 0) {
+		close(fd) ;
+		return -1 ;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) ;
+	return fd ;
+}
+
+// watches a client for input while it is still sending and isn't too far
+// behind on its responses, and for output while it has responses unsent
+static void watch_client(Server *server, Client *client) {
+	uint32_t events = 0 ;
+	if (!client->closing && pending_output(client) < MAX_PENDING_OUTPUT) {
+		events |= EPOLLIN ;
+	}
+	if (pending_output(client) > 0) {
+		events |= EPOLLOUT ;
+	}
+	if (events != client->events) {
+		struct epoll_event event = { .events = events,
+		  .data.ptr = client } ;
+		epoll_ctl(server->epoll, EPOLL_CTL_MOD, client->fd, &event) ;
+		client->events = events ;
+	}
+}
+
+// accepts every waiting connection
+static void accept_clients(Server *server) {
+	int fd ;
+	while ((fd = accept(server->listener, NULL, NULL)) >= 0) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) ;
+
+		Client *client = calloc(1, sizeof *client) ;
+		assert(client) ;
+		client->fd = fd ;
+		client->events = EPOLLIN ;
+		struct epoll_event event = { .events = EPOLLIN, .data.ptr = client } ;
+		epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) ;
+
+		if (server->nclients == server->capacity) {
+			server->capacity *= 2 ;
+			server->clients = realloc(server->clients,
+			  (sizeof *server->clients) * server->capacity) ;
+			assert(server->clients) ;
+		}
+		client->index = server->nclients ;
+		server->clients[server->nclients++] = client ;
+		server->naccepted++ ;
+	}
+}
+
+// disconnects a client and frees it
+static void close_client(Server *server, Client *client) {
+	epoll_ctl(server->epoll, EPOLL_CTL_DEL, client->fd, NULL) ;
+	close(client->fd) ;
+
+	// move the last client into its place in the list
+	Client *last = server->clients[--server->nclients] ;
+	last->index = client->index ;
+	server->clients[client->index] = last ;
+
+	free(client->in.data) ;
+	free(client->out.data) ;
+	free(client) ;
+}
+
+// serves each complete request a client has sent, in order, until its
+// responses are too far behind
+// returns the number of requests served, or -1 if one was malformed
+static int serve_requests(Server *server, Client *client) {
+	int served = 0 ;
+	int pos = 0 ;
+	while (client->in.len - pos >= HEADER_SIZE &&
+	  pending_output(client) < MAX_PENDING_OUTPUT) {
+		char *request = client->in.data + pos ;
+		char op = request[0] ;
+		uint32_t count ;
+		memcpy(&count, request + 1, sizeof count) ;
+		if ((op != 'i' && op != 'l') || count > MAX_BATCH_KEYS) {
+			return -1 ;
+		}
+		int size = HEADER_SIZE + count * KEY_SIZE ;
+		if (client->in.len - pos < size) {
+			break ;
+		}
+
+		// the response echoes the header, then gives a byte per key
+		buffer_reserve(&client->out, HEADER_SIZE + count) ;
+		char *response = client->out.data + client->out.len ;
+		memcpy(response, request, HEADER_SIZE) ;
+		uint32_t i ;
+		for (i=0; i<count; i++) {
+			Key key ;
+			memcpy(&key, request + HEADER_SIZE + i * KEY_SIZE, KEY_SIZE) ;
+			if (server->trace) {
+				trace_record(server->trace, op, key) ;
+			}
+			response[HEADER_SIZE + i] = op == 'i'
+			  ? hash_table_insert(server->table, key)
+			  : hash_table_lookup(server->table, key) ;
+		}
+		client->out.len += HEADER_SIZE + count ;
+
+		pos += size ;
+		served++ ;
+		server->nrequests++ ;
+		server->nkeys += count ;
+	}
+
+	// keep any partial request for when the rest of it arrives
+	memmove(client->in.data, client->in.data + pos, client->in.len - pos) ;
+	client->in.len -= pos ;
+	return served ;
+}
+
+// sends as much of a client's unsent responses as it will take
+// returns false if the client has gone away
+static bool send_responses(Client *client) {
+	while (pending_output(client) > 0) {
+		ssize_t n = send(client->fd, client->out.data + client->sent,
+		  pending_output(client), MSG_NOSIGNAL) ;
+		if (n < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ;
+		}
+		client->sent += n ;
+	}
+	client->out.len = 0 ;
+	client->sent = 0 ;
+	return true ;
+}
+
+// handles the events on a client's connection: reading what it has sent,
+// serving its requests, and sending their responses
+static void handle_client(Server *server, Client *client, uint32_t events) {
+	if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+		buffer_reserve(&client->in, READ_CHUNK) ;
+		ssize_t n = read(client->fd, client->in.data + client->in.len,
+		  READ_CHUNK) ;
+		if (n > 0) {
+			client->in.len += n ;
+		} else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+			client->closing = true ;
+		}
+	}
+
+	// serve requests until caught up, as sending responses can make room to
+	// serve more of those already received
+	int served ;
+	do {
+		served = serve_requests(server, client) ;
+		if (served < 0 || !send_responses(client)) {
+			close_client(server, client) ;
+			return ;
+		}
+	} while (served > 0 && pending_output(client) == 0) ;
+
+	if (client->closing && pending_output(client) == 0) {
+		close_client(server, client) ;
+		return ;
+	}
+	watch_client(server, client) ;
+}
+
+/* * * *
+ * main functions
+ */
+
+// serves table on a Unix socket at path until interrupted
+// returns false if the socket couldn't be listened on
+bool run_server(HashTable *table, const char *path, TraceWriter *trace,
+  MetricsSink *metrics) {
+	Server server ;
+	server.table = table ;
+	server.trace = trace ;
+	server.listener = listen_unix_socket(path) ;
+	if (server.listener < 0) {
+		return false ;
+	}
+	server.epoll = epoll_create1(0) ;
+	assert(server.epoll >= 0) ;
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL } ;
+	epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.listener, &event) ;
+
+	server.capacity = 16 ;
+	server.clients = malloc((sizeof *server.clients) * server.capacity) ;
+	assert(server.clients) ;
+	server.nclients = 0 ;
+	server.naccepted = 0 ;
+	server.nrequests = 0 ;
+	server.nkeys = 0 ;
+
+	// stop on an interrupt, interrupting the wait for events
+	struct sigaction action ;
+	memset(&action, 0, sizeof action) ;
+	action.sa_handler = stop_server ;
+	sigaction(SIGINT, &action, NULL) ;
+	sigaction(SIGTERM, &action, NULL) ;
+
+	printf("serving on %s\n", path) ;
+	fflush(stdout) ;
+
+	struct epoll_event events[MAX_EVENTS] ;
+	while (!stopping) {
+		// wake at least once a second to dump metrics when due
+		int n = epoll_wait(server.epoll, events, MAX_EVENTS,
+		  metrics ? 1000 : -1) ;
+		int i ;
+		for (i=0; i<n; i++) {
+			if (events[i].data.ptr == NULL) {
+				accept_clients(&server) ;
+			} else {
+				handle_client(&server, events[i].data.ptr, events[i].events) ;
+			}
+		}
+
+		if (metrics && metrics_sink_due(metrics)) {
+			hash_table_metrics(table, metrics_sink_file(metrics)) ;
+			metrics_sink_end(metrics) ;
+		}
+	}
+
+	printf("served %llu requests (%llu keys) from %llu clients\n",
+	  server.nrequests, server.nkeys, server.naccepted) ;
+
+	while (server.nclients > 0) {
+		close_client(&server, server.clients[0]) ;
+	}
+	free(server.clients) ;
+	close(server.epoll) ;
+	close(server.listener) ;
+	unlink(path) ;
+	return true ;
+}
@@ -0,0 +1,38 @@
+/* * * * * * * * *
+ * Table server: serves one integer-keyed table to any number of local
+ * clients over a Unix domain stream socket, from a single-threaded epoll
+ * event loop, so that several processes can share one copy of a key set
+ *
+ * the protocol is binary and pipelined: a client may send any number of
+ * requests without waiting, and gets one response per request, in order.
+ * a request is an operation byte ('i' to insert, 'l' to look up), a count
+ * of keys as a 4-byte unsigned integer, then that many keys of KEY_BITS/8
+ * bytes each. its response is the same operation byte and count, then one
+ * byte per key: 1 if it was inserted (or found), 0 if it was already
+ * present (or not found). integers are in the host's byte order. a
+ * malformed request, or one with more than MAX_BATCH_KEYS keys, closes the
+ * connection
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include "hashtbl.h"
+#include "trace.h"
+#include "metrics.h"
+
+// the most keys a single request may carry
+#define MAX_BATCH_KEYS 65536
+
+// serves table on a Unix socket at path (replacing any socket file there)
+// until interrupted (SIGINT or SIGTERM), then removes the socket file.
+// if trace is not NULL, every insert and lookup is recorded to it, and if
+// metrics is not NULL, the table's metrics are dumped to it when due
+// returns false if the socket couldn't be listened on
+bool run_server(HashTable *table, const char *path, TraceWriter *trace,
+  MetricsSink *metrics) ;
+
+#endif
@@ -0,0 +1,181 @@
+/* * * * * * * * *
+ * Concurrency stress program:
+ * has many threads insert into and look up in one shared concurrent
+ * extendible table through the public interface at once, then has them
+ * increment overlapping keys at once, and checks that every key went in
+ * exactly once, can be found and has the count it was given, and that the
+ * table's operation counts add up. built with ThreadSanitizer by
+ * `make stress`, which reports any data race
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#include   <stdio.h>
+#include  <stdlib.h>
+#include <stdbool.h>
+#include  <string.h>
+#include <pthread.h>
+#include  <assert.h>
+
+#include "inthash.h"
+#include "hashtbl.h"
+
+#define NTHREADS 8
+#define BUCKET_SIZE 4
+#ifndef PER
+#define PER 20000   // keys inserted, and keys incremented, by each thread
+#endif
+
+// each thread inserts PER keys starting halfway through the previous
+// thread's keys, so that every key is raced for by two threads
+#define FIRST_KEY(t) ((int64)(t) * PER / 2)
+#define NKEYS (FIRST_KEY(NTHREADS - 1) + PER)
+
+// the keys incremented start halfway through the inserted keys, so that half
+// of them are already in the table and half are inserted by an increment
+#define FIRST_COUNTED (NKEYS / 2)
+
+typedef struct worker {
+	HashTable *table ;
+	int t ;
+	int64 ninserted ; // number of inserts or increments that returned true
+} Worker ;
+
+static void *insert_work(void *arg) {
+	Worker *worker = arg ;
+	int64 first = FIRST_KEY(worker->t) ;
+
+	for (int64 i = 0; i < PER; i++) {
+		Key key = first + i ;
+		worker->ninserted += hash_table_insert(worker->table, key) ;
+		assert(hash_table_lookup(worker->table, key) &&
+		  "error: a key was lost just after its insert!") ;
+
+		// also look up keys that other threads may be inserting right now
+		hash_table_lookup(worker->table, (key * 7) % NKEYS) ;
+	}
+	return NULL ;
+}
+
+// thread t adds t+1 to each of its keys. even threads go through
+// hash_table_increment, and odd ones through hash_table_increment_atomic
+static void *increment_work(void *arg) {
+	Worker *worker = arg ;
+	int64 first = FIRST_COUNTED + FIRST_KEY(worker->t) ;
+	int64 delta = worker->t + 1 ;
+
+	for (int64 i = 0; i < PER; i++) {
+		int64 count ;
+		worker->ninserted += worker->t % 2
+		  ? hash_table_increment_atomic(worker->table, first + i, delta, &count)
+		  : hash_table_increment(worker->table, first + i, delta, &count) ;
+		assert(count >= delta && "error: an increment was lost!") ;
+	}
+	return NULL ;
+}
+
+// runs NTHREADS threads of work on a table at once
+// returns the total of their workers' ninserted
+static int64 run_threads(HashTable *table, void *(*work)(void *)) {
+	pthread_t threads[NTHREADS] ;
+	Worker workers[NTHREADS] ;
+	for (int t = 0; t < NTHREADS; t++) {
+		workers[t] = (Worker){ .table = table, .t = t, .ninserted = 0 } ;
+		int err = pthread_create(&threads[t], NULL, work, &workers[t]) ;
+		assert(!err) ;
+	}
+
+	int64 ninserted = 0 ;
+	for (int t = 0; t < NTHREADS; t++) {
+		pthread_join(threads[t], NULL) ;
+		ninserted += workers[t].ninserted ;
+	}
+	return ninserted ;
+}
+
+// the count of the key at offset j of the incremented keys: the total of
+// the deltas of the threads whose keys cover it
+static int64 expected_count(int64 j) {
+	int64 count = 0 ;
+	for (int t = 0; t < NTHREADS; t++) {
+		if (j >= FIRST_KEY(t) && j < FIRST_KEY(t) + PER) {
+			count += t + 1 ;
+		}
+	}
+	return count ;
+}
+
+// checks that a table's operation counts, read from its metrics, are those
+// given. lookups which found their key depend on timing, so aren't checked
+static bool check_op_counts(HashTable *table, int64 ninserts,
+  int64 ninserted, int64 nlookups, int64 nincrements) {
+	FILE *out = tmpfile() ;
+	assert(out) ;
+	hash_table_metrics(table, out) ;
+	rewind(out) ;
+	char line[256] ;
+	bool read = fgets(line, sizeof line, out) != NULL ;
+	fclose(out) ;
+
+	unsigned long long inserts, inserted, lookups, found, increments ;
+	char *ops = read ? strstr(line, "\"ops\":") : NULL ;
+	if (!ops || sscanf(ops, "\"ops\":{\"inserts\":%llu,\"inserted\":%llu,"
+	  "\"lookups\":%llu,\"found\":%llu,\"increments\":%llu}", &inserts,
+	  &inserted, &lookups, &found, &increments) != 5) {
+		printf("could not read the table's operation counts\n") ;
+		return false ;
+	}
+	if (inserts != ninserts || inserted != ninserted ||
+	  lookups != nlookups || increments != nincrements) {
+		printf("operation counts %llu/%llu/%llu/%llu, expected "
+		  "%llu/%llu/%llu/%llu\n", inserts, inserted, lookups, increments,
+		  ninserts, ninserted, nlookups, nincrements) ;
+		return false ;
+	}
+	return true ;
+}
+
+int main(int argc, char **argv) {
+	HashTable *table = new_hash_table(XTNDBLC, BUCKET_SIZE) ;
+	bool ok = true ;
+
+	// insert and look up at once
+	int64 ninserted = run_threads(table, insert_work) ;
+	if (ninserted != NKEYS) {
+		printf("%llu inserts succeeded for %llu keys\n", ninserted, NKEYS) ;
+		ok = false ;
+	}
+	for (int64 k = 0; k < NKEYS; k++) {
+		if (!hash_table_lookup(table, k)) {
+			printf("%llu not found\n", k) ;
+			ok = false ;
+		}
+	}
+
+	// increment overlapping keys at once
+	int64 nnew = run_threads(table, increment_work) ;
+	if (nnew != FIRST_COUNTED) {
+		printf("%llu increments inserted a key, expected %llu\n", nnew,
+		  (int64)FIRST_COUNTED) ;
+		ok = false ;
+	}
+	for (int64 j = 0; j < NKEYS; j++) {
+		int64 count = hash_table_count(table, FIRST_COUNTED + j) ;
+		if (count != expected_count(j)) {
+			printf("%llu has count %llu, expected %llu\n", FIRST_COUNTED + j,
+			  count, expected_count(j)) ;
+			ok = false ;
+		}
+	}
+
+	// every thread made PER inserts and two lookups per insert, and then the
+	// even threads made PER increments counted by the table
+	ok &= check_op_counts(table, NTHREADS * PER, NKEYS,
+	  2 * NTHREADS * PER + NKEYS, (NTHREADS + 1) / 2 * PER) ;
+
+	hash_table_stats(table) ;
+	free_hash_table(table) ;
+
+	printf(ok ? "stress ok\n" : "stress FAILED\n") ;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
@@ -0,0 +1,31 @@
+/* * * * * * * * *
+ * Hash function for variable-length string keys
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#include "strhash.h"
+
+// FNV-1a constants for 64-bit hashes
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+// 64-bit hash of the len bytes starting at str
+// all 64 bits are well mixed, so any subset of them can be used as an address
+int64 strhash(const char *str, int len) {
+	// FNV-1a over the bytes of the string
+	int64 hash = FNV_OFFSET ;
+	int i ;
+	for (i=0; i<len; i++) {
+		hash ^= (unsigned char)str[i] ;
+		hash *= FNV_PRIME ;
+	}
+
+	// finalise so that the low bits depend on every input byte
+	hash ^= hash >> 33 ;
+	hash *= 0xff51afd7ed558ccdULL ;
+	hash ^= hash >> 33 ;
+	hash *= 0xc4ceb9fe1a85ec53ULL ;
+	hash ^= hash >> 33 ;
+	return hash ;
+}
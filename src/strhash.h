@@ -0,0 +1,16 @@
+/* * * * * * * * *
+ * Hash function for variable-length string keys
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef STRHASH_H
+#define STRHASH_H
+
+#include "inthash.h"
+
+// 64-bit hash of the len bytes starting at str
+// all 64 bits are well mixed, so any subset of them can be used as an address
+int64 strhash(const char *str, int len) ;
+
+#endif
@@ -1,268 +1,881 @@
 /* * * * * * * * *
  * Dynamic hash table using cuckoo hashing, resolving collisions by switching
- * keys between two tables with two separate hash functions
+ * keys between two (or up to four) tables with separate hash functions
  *
  * created by Maxim Kirkman <max.kirkman94@gmail.com>
  */
 
 #include  <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include   <time.h>
 
 #include "cuckoo.h"
+#include "cuckoo_fast.h"
+#include "../budget.h"
 
-// an inner table represents one of the two internal tables for a cuckoo
-// hash table. it stores two parallel arrays: 'slots' stores the keys and
-// 'inuse' is a boolean indicating if a slot is filled
-typedef struct inner_table {
-	int64 *slots ;  // array of slots holding keys
-	bool  *inuse ;  // array indicating if a slot is in use or not
-	int    load  ;  // total number of inuse slots
-	int    id    ;  // this table's id number (1 or 2)
-} InnerTable ;
-
-// a hash table which stores its keys in two inner tables
-struct cuckoo_table {
-	InnerTable *table1 ; // first table
-	InnerTable *table2 ; // second table
-	int			size   ; // size of each table
-	int			time   ; // CPU time elapsed
+// the table layout is defined in cuckoo_fast.h, for the inline fast paths
+typedef struct cuckoo_inner_table InnerTable ;
+
+// the most displacements made inserting one key before giving up on it. with
+// two tables a cycle is detected exactly, so this only bounds the random
+// walks taken with more tables
+#define MAX_WALK_STEPS 500
+
+// the most displacements made when trying to move a stashed key back into
+// the tables, so that draining stays cheap even when it fails
+#define MAX_DRAIN_STEPS 16
+
+// the total load factor each number of tables can comfortably reach,
+// used to size tables up front
+static const double max_load_factor[MAX_CUCKOO_TABLES + 1] = {
+	0, 0, 0.50, 0.85, 0.92
 } ;
 
 /* * * *
  * helper functions
  */
 
-// initialise the internal arrays of a single cuckoo inner table
-static void initialise_in_table(InnerTable *table, int size) {
-	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!") ;
+// the number of bytes in a compact slot of a table of the given size (at
+// least 2): enough for any quotient of a key by the size, which has a bit
+// fewer than a key for each doubling of the size, and a bit to mark it in use
+static int packed_width(int64 size) {
+	int bits = KEY_BITS ;
+	while (size >= 2) {
+		size /= 2 ;
+		bits-- ;
+	}
+	return (bits + 1 + 7) / 8 ;
+}
 
-	table->slots = malloc((sizeof *table->slots) * size) ;
-	assert(table->slots) ;
-	table->inuse = malloc((sizeof *table->inuse) * size) ;
-	assert(table->inuse) ;
+// the memory taken by the slots of ntables inner tables of the given size,
+// compact or not, with reference bits if they make up a cache and counts if
+// they are counting keys
+static int64 table_bytes(int ntables, int64 size, bool compact, bool cache,
+  bool counting) {
+	int64 bytes = ntables * size * ((cache ? sizeof(bool) : 0) +
+	  (counting ? sizeof(int64) : 0)) ;
+	if (compact) {
+		return bytes + ntables * size * packed_width(size) ;
+	}
+	return bytes + ntables * size * (sizeof(Key) + sizeof(bool)) ;
+}
 
-	table->load = 0 ;
+// sets the size of each of a cuckoo hash table's inner tables, and for a
+// compact table the width of its slots at that size
+static void set_size(CuckooHashTable *hash_table, int64 size) {
+	hash_table->size = size ;
+	hash_table->width = packed_width(size) ;
+}
+
+// the multiplicative inverse of an odd number at the key width, by Newton's
+// method: each step doubles the number of correct low bits, from 3
+static Key odd_inverse(Key a) {
+	Key y = a ;
 	int i ;
-	for (i=0; i<size; i++) {
-		table->inuse[i] = false ;
+	for (i=0; i<6; i++) {
+		y *= 2 - a * y ;
+	}
+	return y ;
+}
+
+// the key whose permutation for the compact inner table with the given id
+// is x, undoing each step of cuckoo_permute in reverse
+static Key unpermute(int id, Key x) {
+	static const int64 a[MAX_CUCKOO_TABLES] = { H1_A, H2_A, H3_A, H4_A } ;
+	static const int64 b[MAX_CUCKOO_TABLES] = { H1_B, H2_B, H3_B, H4_B } ;
+	x ^= x >> CUCKOO_HALF_BITS ;
+	x *= odd_inverse(CUCKOO_MIX_B) ;
+	x ^= x >> CUCKOO_HALF_BITS ;
+	x *= odd_inverse(CUCKOO_MIX_A) ;
+	x ^= x >> CUCKOO_HALF_BITS ;
+	return (x - (Key)b[id-1]) * odd_inverse((Key)a[id-1]) ;
+}
+
+// reads the slot at address in one of a cuckoo hash table's inner tables
+// returns true and stores its key in *key if the slot is in use
+static bool get_slot(CuckooHashTable *hash_table, InnerTable *table,
+  int64 address, Key *key) {
+	if (!hash_table->compact) {
+		*key = table->slots[address] ;
+		return table->inuse[address] ;
 	}
 
+	// a compact slot's key is rebuilt from its quotient and its address
+	Key value = cuckoo_packed_get(table->packed + address * hash_table->width,
+	  hash_table->width) ;
+	if (!value) {
+		return false ;
+	}
+	*key = unpermute(table->id, (value >> 1) * hash_table->size + address) ;
+	return true ;
 }
 
-// doubles cuckoo hash table size & rehashes its contents
-static void double_cuckoo_table(CuckooHashTable *hash_table) {
+// stores a key in the slot at its address in one of a cuckoo hash table's
+// inner tables, replacing any key there
+static void set_slot(CuckooHashTable *hash_table, InnerTable *table,
+  int64 address, Key key) {
+	if (!hash_table->compact) {
+		table->slots[address] = key ;
+		table->inuse[address] = true ;
+		return ;
+	}
+
+	Key value = cuckoo_packed_value(hash_table,
+	  cuckoo_permute(table->id, key)) ;
+	unsigned char *slot = table->packed + address * hash_table->width ;
+	int i ;
+	for (i=0; i<hash_table->width; i++) {
+		slot[i] = (unsigned char)(value >> (8 * i)) ;
+	}
+}
+
+// empties the slot at address in one of a cuckoo hash table's inner tables
+static void clear_slot(CuckooHashTable *hash_table, InnerTable *table,
+  int64 address) {
+	if (!hash_table->compact) {
+		table->inuse[address] = false ;
+		return ;
+	}
+	memset(table->packed + address * hash_table->width, 0, hash_table->width) ;
+}
+
+// what moves with a key from slot to slot besides the key itself: its
+// reference bit, if the table is a cache, and its count, if the table is
+// counting keys
+typedef struct slot_extras {
+	bool  referenced ;
+	int64 count ;
+} Extras ;
+
+// reads the extras kept alongside the slot at address in an inner table
+// (clear, for those the table doesn't keep)
+static Extras get_extras(InnerTable *table, int64 address) {
+	Extras extras ;
+	extras.referenced = table->referenced && table->referenced[address] ;
+	extras.count = table->counts ? table->counts[address] : 0 ;
+	return extras ;
+}
+
+// sets the extras kept alongside the slot at address in an inner table,
+// ignoring those the table doesn't keep
+static void set_extras(InnerTable *table, int64 address, Extras extras) {
+	if (table->referenced) {
+		table->referenced[address] = extras.referenced ;
+	}
+	if (table->counts) {
+		table->counts[address] = extras.count ;
+	}
+}
+
+// sets the reference bit of the slot at address in an inner table of a
+// cache (ignored for other tables)
+static void set_referenced(InnerTable *table, int64 address,
+  bool referenced) {
+	if (table->referenced) {
+		table->referenced[address] = referenced ;
+	}
+}
+
+// the number of keys in a cuckoo hash table, in its slots and its stash
+static int64 total_load(CuckooHashTable *hash_table) {
+	int64 load = hash_table->nstash ;
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		load += hash_table->tables[t]->load ;
+	}
+	return load ;
+}
+
+// the bytes taken by each slot of a cuckoo hash table, with its flag and
+// any count
+static int slot_bytes(CuckooHashTable *hash_table) {
+	int counts = hash_table->counting ? sizeof(int64) : 0 ;
+	return counts + (hash_table->compact ? hash_table->width
+	  : (int)(sizeof(Key) + sizeof(bool))) ;
+}
+
+// initialise the internal arrays of a single cuckoo inner table
+// the inuse array (or a compact table's slots) is zeroed by calloc, so that
+// the pages of a very large table are only touched as keys are placed in them
+static void initialise_in_table(CuckooHashTable *hash_table,
+  InnerTable *table) {
+	if (hash_table->compact) {
+		table->slots = NULL ;
+		table->inuse = NULL ;
+		// with padding for cuckoo_packed_get to read a word past the end
+		table->packed = calloc(hash_table->size * hash_table->width +
+		  sizeof(int64), 1) ;
+		assert(table->packed) ;
+	} else {
+		table->slots = malloc((sizeof *table->slots) * hash_table->size) ;
+		assert(table->slots) ;
+		table->inuse = calloc(hash_table->size, sizeof *table->inuse) ;
+		assert(table->inuse) ;
+		table->packed = NULL ;
+	}
+	if (hash_table->capacity) {
+		table->referenced = calloc(hash_table->size,
+		  sizeof *table->referenced) ;
+		assert(table->referenced) ;
+	} else {
+		table->referenced = NULL ;
+	}
+	if (hash_table->counting) {
+		table->counts = calloc(hash_table->size, sizeof *table->counts) ;
+		assert(table->counts) ;
+	} else {
+		table->counts = NULL ;
+	}
 
-	int o_size = hash_table->size ;
-	int n_size = o_size * 2 ;
+	table->load = 0 ;
+}
 
-	// save the details of the old tables
-	int64 *old_slots_table1 = hash_table->table1->slots ;
-	bool  *old_inuse_table1 = hash_table->table1->inuse ;
+// frees the internal arrays of a single cuckoo inner table
+static void free_in_table(InnerTable *table) {
+	free(table->slots) ;
+	free(table->inuse) ;
+	free(table->packed) ;
+	free(table->referenced) ;
+	free(table->counts) ;
+}
 
-	int64 *old_slots_table2 = hash_table->table2->slots ;
-	bool  *old_inuse_table2 = hash_table->table2->inuse ;
+// starts keeping a count of each key of a cuckoo hash table, all 0 so far
+static void start_counting(CuckooHashTable *hash_table) {
+	assert(within_memory_budget(table_bytes(hash_table->ntables,
+	  hash_table->size, hash_table->compact, hash_table->capacity > 0, true))
+	  && "error: table has grown too large!") ;
+	hash_table->counting = true ;
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		InnerTable *table = hash_table->tables[t] ;
+		table->counts = calloc(hash_table->size, sizeof *table->counts) ;
+		assert(table->counts) ;
+	}
+	memset(hash_table->stash_counts, 0, sizeof hash_table->stash_counts) ;
+}
+
+// resizing rehashes keys through insert_key, which may resize in turn
+static void insert_key(CuckooHashTable *hash_table, Key key, Extras extras) ;
+
+// resizes each of a cuckoo hash table's inner tables to n_size slots &
+//  rehashes its contents
+static void resize_cuckoo_table(CuckooHashTable *hash_table, int64 n_size) {
+
+	clock_t start = clock() ;
+	int64 o_size = hash_table->size ;
+	int ntables = hash_table->ntables ;
+	assert(within_memory_budget(table_bytes(ntables, n_size,
+	  hash_table->compact, false, hash_table->counting))
+	  && "error: table has grown too large!") ;
+	int64 i ;
+	int t ;
+	Key key ;
+
+	// save the details of the old tables, with the layout to read them by
+	CuckooHashTable old = *hash_table ;
+	InnerTable old_tables[MAX_CUCKOO_TABLES] ;
+	for (t=0; t<ntables; t++) {
+		old_tables[t] = *hash_table->tables[t] ;
+		old.tables[t] = &old_tables[t] ;
+	}
+
+	// take out the stashed keys too
+	Key old_stash[STASH_SIZE] ;
+	int64 old_stash_counts[STASH_SIZE] ;
+	int old_nstash = hash_table->nstash ;
+	for (i=0; i<old_nstash; i++) {
+		old_stash[i] = hash_table->stash[i] ;
+		old_stash_counts[i] = hash_table->stash_counts[i] ;
+	}
+	hash_table->nstash = 0 ;
 
 	// resize each table
-	initialise_in_table(hash_table->table1, n_size) ;
-	initialise_in_table(hash_table->table2, n_size) ;
-	hash_table->size = n_size ;
+	set_size(hash_table, n_size) ;
+	for (t=0; t<ntables; t++) {
+		initialise_in_table(hash_table, hash_table->tables[t]) ;
+	}
 
-	// rehash old contents
-	int i ;
+	// rehash old contents, with their counts
+	Extras extras ;
 	for (i = 0; i<o_size; i++) {
-		if (old_inuse_table1[i]) {
-			cuckoo_hash_table_insert(hash_table, old_slots_table1[i]) ;
-		}
-		if (old_inuse_table2[i]) {
-			cuckoo_hash_table_insert(hash_table, old_slots_table2[i]) ;
+		for (t=0; t<ntables; t++) {
+			if (get_slot(&old, old.tables[t], i, &key)) {
+				insert_key(hash_table, key, get_extras(old.tables[t], i)) ;
+			}
 		}
 	}
+	extras.referenced = false ;
+	for (i = 0; i<old_nstash; i++) {
+		extras.count = old_stash_counts[i] ;
+		insert_key(hash_table, old_stash[i], extras) ;
+	}
 
-	free(old_slots_table1) ;
-	free(old_inuse_table1) ;
-	free(old_slots_table2) ;
-	free(old_inuse_table2) ;
+	for (t=0; t<ntables; t++) {
+		free_in_table(&old_tables[t]) ;
+	}
+
+	resize_log_add(&hash_table->resizes, n_size * ntables, start) ;
 }
 
-// inserts a given key into a table & displaces the old key into the other table
-//  if the current key has been tried before, doubles & rehashes both tables
-static void in_table_insert(CuckooHashTable *hash_table, InnerTable *table,
-  InnerTable *other_table, int64 cur_key, int64 init_key) {
+// doubles cuckoo hash table size & rehashes its contents
+static void double_cuckoo_table(CuckooHashTable *hash_table) {
+	resize_cuckoo_table(hash_table, hash_table->size * 2) ;
+}
 
-	// double hash table & insert key if loop detected
-	if (cur_key == init_key) {
-		double_cuckoo_table(hash_table) ;
-		cuckoo_hash_table_insert(hash_table, cur_key) ;
-		return ;
+// chooses the inner table (by index) to displace a key from, given the index
+// of the table the key was itself just displaced from (or -1 for a new key).
+// with two tables keys simply alternate, starting with the first table;
+// with more, one of the other tables is picked at random
+static int choose_victim_table(CuckooHashTable *hash_table, int from) {
+	if (hash_table->ntables == 2) {
+		return from == 0 ? 1 : 0 ;
+	}
+
+	// xorshift step
+	hash_table->random ^= hash_table->random << 13 ;
+	hash_table->random ^= hash_table->random >> 7 ;
+	hash_table->random ^= hash_table->random << 17 ;
+
+	if (from < 0) {
+		return hash_table->random % hash_table->ntables ;
+	}
+	int t = hash_table->random % (hash_table->ntables - 1) ;
+	return t >= from ? t + 1 : t ;
+}
+
+// tries to place a key in a free slot at one of its addresses, along with
+// its extras
+// returns true if it was placed
+static bool place_in_free_slot(CuckooHashTable *hash_table, Key key,
+  Extras extras) {
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		InnerTable *table = hash_table->tables[t] ;
+		int64 address = cuckoo_address(hash_table, table->id, key) ;
+		Key old_key ;
+		if (!get_slot(hash_table, table, address, &old_key)) {
+			set_slot(hash_table, table, address, key) ;
+			set_extras(table, address, extras) ;
+			table->load++ ;
+			return true ;
+		}
 	}
+	return false ;
+}
+
+// walks a chain of displacements starting from key: each key without a free
+// slot displaces the key at one of its addresses, which then looks for a
+// slot in turn. gives up after max_steps displacements, or with two tables,
+// once the starting key is displaced again (a cycle). each key's extras move
+// with it, the starting key's being given in *extras
+// returns the key left without a slot, with its extras in *extras and with
+// *placed false, or sets *placed true once every key has a slot. the number
+// of displacements made is stored in *nsteps
+static Key displace(CuckooHashTable *hash_table, Key key, Extras *extras,
+  int max_steps, bool *placed, int *nsteps) {
+
+	Key init_key = key ;
+	int from = -1 ;
+	int step ;
+	for (step=0; step<max_steps; step++) {
+		if (step > 0 && hash_table->ntables == 2 && key == init_key) {
+			break ;
+		}
+		if (place_in_free_slot(hash_table, key, *extras)) {
+			*placed = true ;
+			*nsteps = step ;
+			return key ;
+		}
 
-	/* table size is fine, perform insertion */
-	int address ;
-	if (table->id == 1) {
-		address = h1(cur_key) % hash_table->size ;
+		// swap the key with the key at its address in the chosen table
+		int t = choose_victim_table(hash_table, from) ;
+		InnerTable *table = hash_table->tables[t] ;
+		int64 address = cuckoo_address(hash_table, table->id, key) ;
+		Key old_key ;
+		get_slot(hash_table, table, address, &old_key) ;
+		Extras old_extras = get_extras(table, address) ;
+		set_slot(hash_table, table, address, key) ;
+		set_extras(table, address, *extras) ;
+		key = old_key ;
+		*extras = old_extras ;
+		from = t ;
+	}
+
+	*placed = false ;
+	*nsteps = step ;
+	return key ;
+}
+
+// tries to move the most recently stashed key back into the tables, with a
+// displacement chain of bounded length. if the chain runs out, whichever key
+// is left without a slot takes the stashed key's place in the stash
+static void drain_stash(CuckooHashTable *hash_table) {
+	int i = hash_table->nstash - 1 ;
+	bool placed ;
+	int nsteps ;
+	Extras extras ;
+	extras.referenced = false ;
+	extras.count = hash_table->stash_counts[i] ;
+	Key key = displace(hash_table, hash_table->stash[i], &extras,
+	  MAX_DRAIN_STEPS, &placed, &nsteps) ;
+
+	if (placed) {
+		hash_table->nstash-- ;
+		hash_table->stash_stats.ndrained++ ;
 	} else {
-		address = h2(cur_key) % hash_table->size ;
+		hash_table->stash[i] = key ;
+		hash_table->stash_counts[i] = extras.count ;
 	}
+}
 
-	// insert key and return if slot is empty
-	if (!table->inuse[address]) {
-		table->slots[address] = cur_key ;
-		table->inuse[address] = true ;
-		table->load++ ;
+// evicts a key from a full cache to make room for another, by sweeping the
+// CLOCK hand over the slots of each inner table in turn: a key which has
+// been looked up since the hand last passed it gets a second chance, and has
+// its bit cleared, and the first key which hasn't is evicted. if the hand
+// finds no key in two full sweeps, the most recently stashed key is evicted
+static void evict(CuckooHashTable *hash_table) {
+	int64 nslots = hash_table->size * hash_table->ntables ;
+	int64 step ;
+	for (step=0; step<2*nslots; step++) {
+		int64 slot = hash_table->hand ;
+		hash_table->hand = (slot + 1) % nslots ;
+		InnerTable *table = hash_table->tables[slot / hash_table->size] ;
+		int64 address = slot % hash_table->size ;
+
+		Key key ;
+		if (!get_slot(hash_table, table, address, &key)) {
+			continue ;
+		}
+		if (table->referenced[address]) {
+			table->referenced[address] = false ;
+			hash_table->cache_stats.nchances++ ;
+			continue ;
+		}
+		clear_slot(hash_table, table, address) ;
+		table->load-- ;
+		hash_table->cache_stats.nevictions++ ;
 		return ;
 	}
 
-	// try to re-insert the old key in the other table
-	int64 old_key = table->slots[address] ;
-	table->slots[address] = cur_key ;
+	assert(hash_table->nstash > 0 && "error: no key in a full cache!") ;
+	hash_table->nstash-- ;
+	hash_table->cache_stats.nevictions++ ;
+}
 
-	in_table_insert(hash_table, other_table, table, old_key, init_key) ;
-	/* ------------------------------------- */
+// looks for a key in each table's slot, then in the stash
+// returns true if found, storing the inner table it was found in in *table
+// and its address there in *address, or NULL and its index in the stash
+static bool locate_key(CuckooHashTable *hash_table, Key key,
+  InnerTable **table, int64 *address) {
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		*table = hash_table->tables[t] ;
+		*address = cuckoo_address(hash_table, (*table)->id, key) ;
+		Key slot_key ;
+		if (get_slot(hash_table, *table, *address, &slot_key) &&
+		  slot_key == key) {
+			return true ;
+		}
+	}
+
+	*table = NULL ;
+	for (*address=0; *address<hash_table->nstash; (*address)++) {
+		if (hash_table->stash[*address] == key) {
+			return true ;
+		}
+	}
+	return false ;
 }
 
-/* * * *
- * main functions
- */
+// looks for a key in a cuckoo hash table, marking the slot it is found in as
+// referenced if the table is a cache. only caches look keys up this way, one
+// table after another, as they need to know which slot held the key
+// returns true if found, storing whether it was in the stash in *stashed
+static bool find_key(CuckooHashTable *hash_table, Key key, bool *stashed) {
+	InnerTable *table ;
+	int64 address ;
+	bool found = locate_key(hash_table, key, &table, &address) ;
+	if (found && table) {
+		set_referenced(table, address, true) ;
+	}
+	*stashed = found && !table ;
+	return found ;
+}
 
-// initialises a cuckoo hash table with the given size
-CuckooHashTable *new_cuckoo_hash_table(int size) {
+// places a key known not to be in a cuckoo hash table, with its extras,
+// first making room if the table is a full cache
+static void insert_key(CuckooHashTable *hash_table, Key key, Extras extras) {
+
+	// make room in a full cache
+	if (hash_table->capacity && total_load(hash_table) >=
+	  hash_table->capacity) {
+		evict(hash_table) ;
+	}
 
-	CuckooHashTable *hash_table = malloc((sizeof *hash_table) * size) ;
+	/* place key, displacing others as needed */
+	bool placed ;
+	int nsteps ;
+	Key homeless = displace(hash_table, key, &extras, MAX_WALK_STEPS,
+	  &placed, &nsteps) ;
+	log2_histogram_add(&hash_table->chain_lengths, nsteps) ;
+
+	// stash the key left without a slot, or double hash table & insert it.
+	// a cache never doubles, and drops the key instead
+	if (!placed) {
+		if (hash_table->nstash < STASH_SIZE) {
+			hash_table->stash_counts[hash_table->nstash] = extras.count ;
+			hash_table->stash[hash_table->nstash++] = homeless ;
+			hash_table->stash_stats.nstashed++ ;
+		} else if (hash_table->capacity) {
+			hash_table->cache_stats.ndropped++ ;
+		} else {
+			hash_table->stash_stats.ndoublings++ ;
+			double_cuckoo_table(hash_table) ;
+			insert_key(hash_table, homeless, extras) ;
+		}
+	} else if (hash_table->nstash > 0) {
+		drain_stash(hash_table) ;
+	}
+	/* -------------------------------------- */
+}
+
+// initialises a cuckoo hash table with the given size of each of ntables
+// (2 to MAX_CUCKOO_TABLES) inner tables, compact or not, and if capacity
+// isn't 0, as a cache of at most capacity keys
+static CuckooHashTable *new_table(int64 size, int ntables, bool compact,
+  int64 capacity) {
+	assert(ntables >= 2 && ntables <= MAX_CUCKOO_TABLES) ;
+	assert(within_memory_budget(table_bytes(ntables, size, compact,
+	  capacity > 0, false)) && "error: table has grown too large!") ;
+
+	CuckooHashTable *hash_table = malloc(sizeof *hash_table) ;
 	assert(hash_table) ;
+	hash_table->compact = compact ;
+	hash_table->capacity = capacity ;
+	hash_table->hand = 0 ;
+	hash_table->counting = false ;
+	set_size(hash_table, size) ;
 
 	/* initialise each inner table & their contents */
-	hash_table->table1 = malloc((sizeof *hash_table->table1) * size) ;
-	hash_table->table2 = malloc((sizeof *hash_table->table2) * size) ;
-	initialise_in_table(hash_table->table1, size) ;
-	initialise_in_table(hash_table->table2, size) ;
-	hash_table->table1->id = 1 ;
-	hash_table->table2->id = 2 ;
+	int t ;
+	for (t=0; t<ntables; t++) {
+		hash_table->tables[t] = malloc(sizeof *hash_table->tables[t]) ;
+		assert(hash_table->tables[t]) ;
+		initialise_in_table(hash_table, hash_table->tables[t]) ;
+		hash_table->tables[t]->id = t+1 ;
+	}
+	hash_table->ntables = ntables ;
 	/* -------------------------------------------- */
 
 	// prepare high level details
-	hash_table->size = size ;
 	hash_table->time = 0 ;
+	hash_table->random = 88172645463325252ULL ;
+	hash_table->nstash = 0 ;
+	hash_table->stash_stats.nstashed = 0 ;
+	hash_table->stash_stats.ndrained = 0 ;
+	hash_table->stash_stats.nhits = 0 ;
+	hash_table->stash_stats.ndoublings = 0 ;
+	hash_table->cache_stats.nlookups = 0 ;
+	hash_table->cache_stats.nhits = 0 ;
+	hash_table->cache_stats.nevictions = 0 ;
+	hash_table->cache_stats.nchances = 0 ;
+	hash_table->cache_stats.ndropped = 0 ;
+	clear_log2_histogram(&hash_table->chain_lengths) ;
+	clear_resize_log(&hash_table->resizes) ;
 	return hash_table ;
 }
 
+/* * * *
+ * main functions
+ */
+
+// initialises a cuckoo hash table with the given size
+CuckooHashTable *new_cuckoo_hash_table(int64 size) {
+	return new_dary_cuckoo_hash_table(size, 2) ;
+}
+
+// initialises a cuckoo hash table with the given size of each of ntables
+// (2 to MAX_CUCKOO_TABLES) inner tables, each with its own hash function
+CuckooHashTable *new_dary_cuckoo_hash_table(int64 size, int ntables) {
+	return new_table(size, ntables, false, 0) ;
+}
+
+// initialises a compact cuckoo hash table with ntables inner tables of at
+// least the given size, and of at least 2 slots, so that every slot holds
+// fewer bits than a key along with its in-use bit
+CuckooHashTable *new_compact_cuckoo_hash_table(int64 size, int ntables) {
+	return new_table(size > 2 ? size : 2, ntables, true, 0) ;
+}
+
+// initialises a cuckoo hash table of ntables inner tables as a cache of at
+// most capacity keys, with compact slots or not. its inner tables are sized
+// so that it is full at the load factor their number can comfortably reach
+CuckooHashTable *new_cuckoo_cache_hash_table(int64 capacity, int ntables,
+  bool compact) {
+	assert(capacity > 0) ;
+	int64 size = capacity / (ntables * max_load_factor[ntables]) + 1 ;
+	if (compact && size < 2) {
+		size = 2 ;
+	}
+	return new_table(size, ntables, compact, capacity) ;
+}
+
 
 // frees all memory associated with a given cuckoo hash table
 void free_cuckoo_hash_table(CuckooHashTable *hash_table) {
 	assert(hash_table != NULL) ;
 
-	free(hash_table->table1->slots) ;
-	free(hash_table->table1->inuse) ;
-	free(hash_table->table2->slots) ;
-	free(hash_table->table2->inuse) ;
-
-	free(hash_table->table1) ;
-	free(hash_table->table2) ;
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		free_in_table(hash_table->tables[t]) ;
+		free(hash_table->tables[t]) ;
+	}
 
 	free(hash_table) ;
 }
 
-// inserts a new key into a cuckoo hash table
-// returns true if successful, false if the key was already present
-bool cuckoo_hash_table_insert(CuckooHashTable *hash_table, int64 key) {
+// grows a cuckoo hash table so it can hold expected_keys keys without
+// doubling, by sizing its inner tables to hold them all at the load factor
+// its number of tables can comfortably reach
+void cuckoo_hash_table_reserve(CuckooHashTable *hash_table,
+  int64 expected_keys) {
 	assert(hash_table != NULL) ;
-	int start_time = clock() ;
-
-	int v = h1(key) % hash_table->size ;
-	int w = h2(key) % hash_table->size ;
 
-	/* insert key in table1 slot if empty */
-	if (!hash_table->table1->inuse[v]) {
-		hash_table->table1->slots[v] = key ;
-		hash_table->table1->inuse[v] = true ;
-		hash_table->table1->load++ ;
+	// a cache never grows
+	if (hash_table->capacity) {
+		return ;
+	}
 
-		hash_table->time += clock() - start_time ;
-		return true ;
+	int64 size = expected_keys / (hash_table->ntables *
+	  max_load_factor[hash_table->ntables]) + 1 ;
+	if (size > hash_table->size) {
+		resize_cuckoo_table(hash_table, size) ;
 	}
-	/* ---------------------------------- */
+}
+
+// inserts a new key into a cuckoo hash table
+// returns true if successful, false if the key was already present
+bool cuckoo_hash_table_insert(CuckooHashTable *hash_table, Key key) {
+	assert(hash_table != NULL) ;
+	clock_t start_time = clock() ;
 
-			   // 1st slot is taken
-	/* check if key is already in either table */
-	if (hash_table->table1->slots[v] == key) {
+	/* check if key is already in any table, or the stash */
+	bool stashed ;
+	if (hash_table->capacity ? find_key(hash_table, key, &stashed)
+	  : cuckoo_hash_table_lookup_fast(hash_table, key)) {
 		hash_table->time += clock() - start_time ;
 		return false ;
 	}
-	else if (hash_table->table2->inuse[w] &&
-	  (hash_table->table2->slots[w] == key)) {
+	/* -------------------------------------------------- */
+
+	Extras extras ;
+	extras.referenced = false ;
+	extras.count = 0 ;
+	insert_key(hash_table, key, extras) ;
+
+	hash_table->time += clock() - start_time ;
+	return true ;
+}
+
+// adds delta to the count of a key in a cuckoo hash table, inserting it with
+// a count of delta if it isn't there. keys are only given counts from the
+// first increment on, when the table starts keeping a count for every slot
+// returns true if the key was inserted, and stores its new count in *count
+bool cuckoo_hash_table_increment(CuckooHashTable *hash_table, Key key,
+  int64 delta, int64 *count) {
+	assert(hash_table != NULL) ;
+	clock_t start_time = clock() ;
+
+	if (!hash_table->counting && delta != 0) {
+		start_counting(hash_table) ;
+	}
+
+	// the key's count is updated where the lookup finds it
+	InnerTable *table ;
+	int64 address ;
+	if (locate_key(hash_table, key, &table, &address)) {
+		int64 *counter = NULL ;
+		if (hash_table->counting) {
+			counter = table ? &table->counts[address]
+			  : &hash_table->stash_counts[address] ;
+			*counter += delta ;
+		}
+		if (table) {
+			set_referenced(table, address, true) ;
+		}
+		*count = counter ? *counter : 0 ;
 		hash_table->time += clock() - start_time ;
 		return false ;
 	}
-	/* --------------------------------------- */
 
-	/* if not, place key in table1 and move old key to table2 */
-	int64 old_key = hash_table->table1->slots[v] ;
-	hash_table->table1->slots[v] = key ;
-	in_table_insert(hash_table, hash_table->table2,
-		hash_table->table1, old_key, key) ;
+	Extras extras ;
+	extras.referenced = false ;
+	extras.count = delta ;
+	insert_key(hash_table, key, extras) ;
+	*count = delta ;
 
 	hash_table->time += clock() - start_time ;
 	return true ;
-	/* ------------------------------------------------------ */
+}
+
+// the count of a key in a cuckoo hash table, or 0 if it isn't there
+int64 cuckoo_hash_table_count(CuckooHashTable *hash_table, Key key) {
+	assert(hash_table != NULL) ;
+
+	InnerTable *table ;
+	int64 address ;
+	if (!hash_table->counting ||
+	  !locate_key(hash_table, key, &table, &address)) {
+		return 0 ;
+	}
+	return table ? table->counts[address] : hash_table->stash_counts[address] ;
 }
 
 // looks up whether a key is inside a cuckoo hash table
 // returns true if found, false if not
-bool cuckoo_hash_table_lookup(CuckooHashTable *hash_table, int64 key) {
+bool cuckoo_hash_table_lookup(CuckooHashTable *hash_table, Key key) {
 	assert (hash_table != NULL) ;
-	int start_time = clock() ;
+	clock_t start_time = clock() ;
 
-	int v = h1(key) % hash_table->size ;
-	int w = h2(key) % hash_table->size ;
+	// a cache marks the slot it finds the key in, any other table has every
+	// inner table's slot probed at once before the stash
+	bool found, stashed ;
+	if (hash_table->capacity) {
+		found = find_key(hash_table, key, &stashed) ;
+	} else {
+		found = cuckoo_slots_contain(hash_table, key) ;
+		stashed = !found && hash_table->nstash > 0 &&
+		  cuckoo_stash_contains(hash_table, key) ;
+		found |= stashed ;
+	}
+	hash_table->stash_stats.nhits += stashed ;
+	hash_table->cache_stats.nlookups++ ;
+	hash_table->cache_stats.nhits += found ;
 
-	// look for the key in each slot
-	if (hash_table->table1->inuse[v] &&
-	  (hash_table->table1->slots[v] == key)) {
-		hash_table->time += clock() - start_time ;
-		return true ;
+	hash_table->time += clock() - start_time ;
+	return found ;
+}
+
+// steps through the keys of a cuckoo hash table, one per call
+// the cursor counts through each inner table's slots in turn, then the stash
+bool cuckoo_hash_table_next(CuckooHashTable *hash_table, int64 *cursor,
+  Key *key) {
+	assert(hash_table) ;
+
+	int64 nslots = hash_table->size * hash_table->ntables ;
+	while (*cursor < nslots) {
+		InnerTable *table = hash_table->tables[*cursor / hash_table->size] ;
+		int64 address = *cursor % hash_table->size ;
+		(*cursor)++ ;
+		if (get_slot(hash_table, table, address, key)) {
+			return true ;
+		}
 	}
-	if (hash_table->table2->inuse[w] &&
-	  (hash_table->table2->slots[w] == key)) {
-		hash_table->time += clock() - start_time ;
+
+	if (*cursor < nslots + hash_table->nstash) {
+		*key = hash_table->stash[*cursor - nslots] ;
+		(*cursor)++ ;
 		return true ;
 	}
-	else {
-		hash_table->time += clock() - start_time ;
-		return false ;
-	}
+	return false ;
 }
 
-// prints the contents of a cuckoo hash table to stdout
-void cuckoo_hash_table_print(CuckooHashTable *hash_table) {
+// dumps the slots of a cuckoo hash table in the dump's range of addresses,
+// from each inner table in turn, then the stash
+void cuckoo_hash_table_dump(CuckooHashTable *hash_table, Dump *dump) {
 	assert(hash_table) ;
-	printf("--- table size: %d\n", hash_table->size) ;
-
-	// print header
-	printf("                    table one         table two\n") ;
-	printf("                  key | address     address | key\n") ;
-
-	// print rows of each table
-	int i ;
-	for (i = 0; i < hash_table->size; i++) {
 
-		// table 1 key
-		if (hash_table->table1->inuse[i]) {
-			printf(" %20llu ", hash_table->table1->slots[i]) ;
-		} else {
-			printf(" %20s ", "-") ;
+	int64 first, last, address ;
+	dump_range(dump, hash_table->size, &first, &last) ;
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		InnerTable *table = hash_table->tables[t] ;
+		char title[16] ;
+		sprintf(title, "table %d", table->id) ;
+		dump_section(dump, title) ;
+		for (address=first; address<last; address++) {
+			Key key = 0 ;
+			bool inuse = get_slot(hash_table, table, address, &key) ;
+			dump_slot(dump, table->id, address, inuse, key) ;
 		}
+	}
 
-		// addresses
-		printf("| %-9d %9d |", i, i) ;
+	dump_section(dump, "stash") ;
+	dump_range(dump, STASH_SIZE, &first, &last) ;
+	for (address=first; address<last; address++) {
+		dump_slot(dump, 0, address, address < hash_table->nstash,
+		  hash_table->stash[address]) ;
+	}
+}
 
-		// table 2 key
-		if (hash_table->table2->inuse[i]) {
-			printf(" %llu\n", hash_table->table2->slots[i]) ;
-		} else {
-			printf(" %s\n",  "-") ;
+// prints the contents of a cuckoo hash table to stdout
+void cuckoo_hash_table_print(CuckooHashTable *hash_table) {
+	assert(hash_table) ;
+	printf("--- table size: %llu\n", hash_table->size) ;
+
+	char keystr[KEY_STR_LEN] ;
+	Key key ;
+	int64 i ;
+	int t ;
+
+	if (hash_table->ntables == 2) {
+		InnerTable *table1 = hash_table->tables[0] ;
+		InnerTable *table2 = hash_table->tables[1] ;
+
+		// print header
+		printf("                    table one         table two\n") ;
+		printf("                  key | address     address | key\n") ;
+
+		// print rows of each table
+		for (i = 0; i < hash_table->size; i++) {
+
+			// table 1 key
+			if (get_slot(hash_table, table1, i, &key)) {
+				printf(" %20s ", keytostr(key, keystr)) ;
+			} else {
+				printf(" %20s ", "-") ;
+			}
+
+			// addresses
+			printf("| %-9llu %9llu |", i, i) ;
+
+			// table 2 key
+			if (get_slot(hash_table, table2, i, &key)) {
+				printf(" %s\n", keytostr(key, keystr)) ;
+			} else {
+				printf(" %s\n",  "-") ;
+			}
 		}
+	} else {
+		// print header
+		printf("  address |") ;
+		for (t = 0; t < hash_table->ntables; t++) {
+			printf(" %15s%d key", "table ", t+1) ;
+		}
+		printf("\n") ;
+
+		// print one row per address, with each table's key
+		for (i = 0; i < hash_table->size; i++) {
+			printf("%9llu |", i) ;
+			for (t = 0; t < hash_table->ntables; t++) {
+				if (get_slot(hash_table, hash_table->tables[t], i, &key)) {
+					printf(" %20s", keytostr(key, keystr)) ;
+				} else {
+					printf(" %20s", "-") ;
+				}
+			}
+			printf("\n") ;
+		}
+	}
+
+	// print stashed keys
+	printf(" stash:") ;
+	for (i = 0; i < hash_table->nstash; i++) {
+		printf(" %s", keytostr(hash_table->stash[i], keystr)) ;
 	}
+	printf("\n") ;
 
 	printf("--- end table ---\n") ;
 }
@@ -271,7 +884,12 @@ void cuckoo_hash_table_print(CuckooHashTable *hash_table) {
 void cuckoo_hash_table_stats(CuckooHashTable *hash_table) {
 
 	assert(hash_table != NULL) ;
-	int total_load = hash_table->table1->load + hash_table->table2->load ;
+	int ntables = hash_table->ntables ;
+	int64 total_load = hash_table->nstash ;
+	int t ;
+	for (t=0; t<ntables; t++) {
+		total_load += hash_table->tables[t]->load ;
+	}
 	float seconds = hash_table->time * 1.0 / CLOCKS_PER_SEC ;
 
 	printf("\n----- table stats -----\n") ;
@@ -279,24 +897,93 @@ void cuckoo_hash_table_stats(CuckooHashTable *hash_table) {
 	// print high level cuckoo table info
 	printf("\n    --- overall ---\n") ;
 	printf("CPU time spent:\t\t%.6f sec\n", seconds) ;
-	printf("total size:\t\t%d slots\n", hash_table->size * 2) ;
-	printf("    (%d slots in 2 tables)\n", hash_table->size) ;
-	printf("total load:\t\t%d items\n", total_load) ;
+	printf("total size:\t\t%llu slots\n", hash_table->size * ntables) ;
+	printf("    (%llu slots in %d tables)\n", hash_table->size, ntables) ;
+	printf("slot size:\t\t%d bytes%s%s\n", slot_bytes(hash_table),
+	  hash_table->compact ? " (compact)" : "",
+	  hash_table->counting ? " (counting)" : "") ;
+	printf("total load:\t\t%llu items\n", total_load) ;
 	printf("total load factor:\t%.3f%%\n",
-	  total_load * 100.0 / (hash_table->size * 2)) ;
+	  total_load * 100.0 / (hash_table->size * ntables)) ;
 	printf("    ---------------\n") ;
 
 	// print internal table info
 	printf("\n    ---  inner  ---\n") ;
-	printf("table 1:\n") ;
-	printf("  load:\t\t%d items\n", hash_table->table1->load) ;
-	printf("  load factor:\t%.3f%%\n",
-	  hash_table->table1->load * 100.0 / hash_table->size) ;
-
-	printf("table 2:\n") ;
-	printf("  load:\t\t%d items\n", hash_table->table2->load) ;
-	printf("  load factor:\t%.3f%%\n",
-	  hash_table->table2->load * 100.0 / hash_table->size) ;
+	for (t=0; t<ntables; t++) {
+		printf("table %d:\n", t+1) ;
+		printf("  load:\t\t%llu items\n", hash_table->tables[t]->load) ;
+		printf("  load factor:\t%.3f%%\n",
+		  hash_table->tables[t]->load * 100.0 / hash_table->size) ;
+	}
 	printf("    ---------------\n") ;
+
+	// print stash info
+	printf("\n    ---  stash  ---\n") ;
+	printf("stashed now:\t\t%d of %d keys\n", hash_table->nstash, STASH_SIZE) ;
+	printf("keys stashed:\t\t%llu\n", hash_table->stash_stats.nstashed) ;
+	printf("keys drained:\t\t%llu\n", hash_table->stash_stats.ndrained) ;
+	printf("stash lookup hits:\t%llu\n", hash_table->stash_stats.nhits) ;
+	printf("doublings (full):\t%llu\n", hash_table->stash_stats.ndoublings) ;
+	printf("    ---------------\n") ;
+
+	// print cache info
+	if (hash_table->capacity) {
+		struct cuckoo_cache_stats *cache = &hash_table->cache_stats ;
+		printf("\n    ---  cache  ---\n") ;
+		printf("capacity:\t\t%llu keys\n", hash_table->capacity) ;
+		printf("lookups:\t\t%llu\n", cache->nlookups) ;
+		printf("hit rate:\t\t%.3f%%\n",
+		  cache->nlookups ? cache->nhits * 100.0 / cache->nlookups : 0.0) ;
+		printf("evictions:\t\t%llu\n", cache->nevictions) ;
+		printf("second chances:\t\t%llu\n", cache->nchances) ;
+		printf("dropped (stash full):\t%llu\n", cache->ndropped) ;
+		printf("    ---------------\n") ;
+	}
 	printf("\n   --- end stats ---\n") ;
 }
+
+// writes metrics about a cuckoo hash table to out as a JSON object
+void cuckoo_hash_table_metrics(CuckooHashTable *hash_table, FILE *out) {
+	assert(hash_table != NULL) ;
+
+	int64 total_load = hash_table->nstash ;
+	int t ;
+	for (t=0; t<hash_table->ntables; t++) {
+		total_load += hash_table->tables[t]->load ;
+	}
+	int64 nslots = hash_table->size * hash_table->ntables ;
+
+	fprintf(out, "{\"size\":%llu,\"ntables\":%d,\"load\":%llu,"
+	  "\"load_factor\":%.4f,\"cpu_secs\":%.6f,", hash_table->size,
+	  hash_table->ntables, total_load, total_load * 1.0 / nslots,
+	  hash_table->time * 1.0 / CLOCKS_PER_SEC) ;
+	fprintf(out, "\"compact\":%s,\"counting\":%s,\"slot_bytes\":%d,",
+	  hash_table->compact ? "true" : "false",
+	  hash_table->counting ? "true" : "false", slot_bytes(hash_table)) ;
+
+	// each inner table's load
+	fprintf(out, "\"table_loads\":[") ;
+	for (t=0; t<hash_table->ntables; t++) {
+		fprintf(out, t ? ",%llu" : "%llu", hash_table->tables[t]->load) ;
+	}
+	fprintf(out, "],") ;
+
+	struct cuckoo_stash_stats *stash = &hash_table->stash_stats ;
+	fprintf(out, "\"stash\":{\"now\":%d,\"stashed\":%llu,\"drained\":%llu,"
+	  "\"hits\":%llu,\"full_doublings\":%llu},", hash_table->nstash,
+	  stash->nstashed, stash->ndrained, stash->nhits, stash->ndoublings) ;
+
+	if (hash_table->capacity) {
+		struct cuckoo_cache_stats *cache = &hash_table->cache_stats ;
+		fprintf(out, "\"cache\":{\"capacity\":%llu,\"lookups\":%llu,"
+		  "\"hits\":%llu,\"evictions\":%llu,\"second_chances\":%llu,"
+		  "\"dropped\":%llu},", hash_table->capacity, cache->nlookups,
+		  cache->nhits, cache->nevictions, cache->nchances, cache->ndropped) ;
+	}
+
+	fprintf(out, "\"chain_lengths\":") ;
+	log2_histogram_json(&hash_table->chain_lengths, out) ;
+	fprintf(out, ",\"resizes\":") ;
+	resize_log_json(&hash_table->resizes, out) ;
+	fprintf(out, "}") ;
+}
@@ -1,6 +1,6 @@
 /* * * * * * * * *
  * Dynamic hash table using cuckoo hashing, resolving collisions by switching
- * keys between two tables with two separate hash functions
+ * keys between two (or up to four) tables with separate hash functions
  *
  * created by Maxim Kirkman <max.kirkman94@gmail.com>
  */
@@ -8,29 +8,91 @@
 #ifndef CUCKOO_H
 #define CUCKOO_H
 
+#include   <stdio.h>
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../dump.h"
 
 typedef struct cuckoo_table CuckooHashTable ;
 
-// initialises a cuckoo hash table with the given size
-CuckooHashTable *new_cuckoo_hash_table(int size) ;
+// the most inner tables (and hash functions) a cuckoo hash table can use
+#define MAX_CUCKOO_TABLES 4
+
+// initialises a cuckoo hash table with the given size, using two tables
+CuckooHashTable *new_cuckoo_hash_table(int64 size) ;
+
+// initialises a cuckoo hash table with the given size of each of ntables
+// (2 to MAX_CUCKOO_TABLES) inner tables, each with its own hash function.
+// more tables take more probes per lookup but stay cheap to insert into at
+// much higher load factors
+CuckooHashTable *new_dary_cuckoo_hash_table(int64 size, int ntables) ;
+
+// initialises a compact cuckoo hash table with ntables inner tables of the
+// given size (at least 2). rather than a whole key and an in-use flag, each
+// slot stores only the part of the key its address doesn't already give,
+// packed into as few bytes as that takes: 5 rather than 9 for 64-bit keys in
+// tables of 2^27 slots. lookups stay exact, but each one decodes its slots,
+// and inserts are never inlined
+CuckooHashTable *new_compact_cuckoo_hash_table(int64 size, int ntables) ;
+
+// initialises a cuckoo hash table of ntables inner tables as a cache of at
+// most capacity keys, with compact slots or not. a cache never grows: an
+// insert into a full cache first evicts a key chosen in CLOCK order, sweeping
+// the slots of each inner table in turn and passing over (once) any key
+// looked up since the sweep last reached it. each slot's reference bit moves
+// with its key when the key is displaced. a new key starts unreferenced
+CuckooHashTable *new_cuckoo_cache_hash_table(int64 capacity, int ntables,
+  bool compact) ;
 
 // frees all memory associated with a given cuckoo hash table
 void free_cuckoo_hash_table(CuckooHashTable *hash_table) ;
 
+// grows a cuckoo hash table so it can hold expected_keys keys without
+// doubling, by sizing its inner tables to the load factor their number
+// can comfortably reach (50% for two tables, up to 92% for four)
+void cuckoo_hash_table_reserve(CuckooHashTable *hash_table,
+  int64 expected_keys) ;
+
 // inserts a new key into a cuckoo hash table
 // returns true if successful, false if the key was already present
-bool cuckoo_hash_table_insert(CuckooHashTable *hash_table, int64 key) ;
+bool cuckoo_hash_table_insert(CuckooHashTable *hash_table, Key key) ;
 
-// looks up whether a key is inside a cuckoo hash table
+// looks up whether a key is inside a cuckoo hash table, reading the key's
+// slot in every inner table at once unless the table is a cache
 // returns true if found, false if not
-bool cuckoo_hash_table_lookup(CuckooHashTable *hash_table, int64 key) ;
+bool cuckoo_hash_table_lookup(CuckooHashTable *hash_table, Key key) ;
+
+// adds delta to the count of a key in a cuckoo hash table, inserting it with
+// a count of delta if it isn't there. a key inserted without a count has a
+// count of 0
+// returns true if the key was inserted, and stores its new count in *count
+bool cuckoo_hash_table_increment(CuckooHashTable *hash_table, Key key,
+  int64 delta, int64 *count) ;
+
+// the count of a key in a cuckoo hash table, or 0 if it isn't there
+int64 cuckoo_hash_table_count(CuckooHashTable *hash_table, Key key) ;
+
+// steps through the keys of a cuckoo hash table, one per call: set *cursor to 0
+// to start from the first key, then pass it back unchanged for each next key.
+// the table must not be changed between calls
+// returns true and stores the next key in *key, or false once all are seen
+bool cuckoo_hash_table_next(CuckooHashTable *hash_table, int64 *cursor,
+  Key *key) ;
 
 // prints the contents of a cuckoo hash table to stdout
 void cuckoo_hash_table_print(CuckooHashTable *hash_table) ;
 
+// dumps the slots of a cuckoo hash table in the dump's range of addresses,
+// from each inner table in turn, then the stash
+void cuckoo_hash_table_dump(CuckooHashTable *hash_table, Dump *dump) ;
+
 // prints statistics about a cuckoo hash table to stdout
 void cuckoo_hash_table_stats(CuckooHashTable *hash_table) ;
 
+// writes metrics about a cuckoo hash table to out as a JSON object: loads,
+// the size of its slots, stash use, a cache's hits and evictions, a
+// histogram of the displacements made by each insertion (including
+// reinsertions while growing), and a log of each time the tables grew
+void cuckoo_hash_table_metrics(CuckooHashTable *hash_table, FILE *out) ;
+
 #endif
@@ -0,0 +1,238 @@
+/* * * * * * * * *
+ * Header-inline fast paths for cuckoo hash tables, for tight loops over a
+ * table whose type is known at compile time. also defines the table layout
+ * shared with cuckoo.c
+ *
+ * the fast paths skip the argument checks and CPU time accounting done by
+ * cuckoo_hash_table_insert and cuckoo_hash_table_lookup
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef CUCKOO_FAST_H
+#define CUCKOO_FAST_H
+
+#include <string.h>
+#include "cuckoo.h"
+#include "../metrics.h"
+
+// an inner table represents one of the internal tables for a cuckoo
+// hash table. it stores two parallel arrays: 'slots' stores the keys and
+// 'inuse' is a boolean indicating if a slot is filled. a compact table
+// instead stores one array, 'packed', of slots of the table's width in bytes.
+// a cache also keeps a reference bit alongside each slot, in 'referenced',
+// and a counting table keeps each slot's key's count, in 'counts'
+struct cuckoo_inner_table {
+	Key   *slots ;  // array of slots holding keys
+	bool  *inuse ;  // array indicating if a slot is in use or not
+	unsigned char *packed ; // array of compact slots (NULL if not compact)
+	bool  *referenced ; // array indicating if a slot's key has been looked
+	                // up since the CLOCK hand last passed (NULL if no cache)
+	int64 *counts ; // array of each slot's key's count (NULL until the
+	                // table is first incremented)
+	int64  load  ;  // total number of inuse slots
+	int    id    ;  // this table's id number (1 to ntables), which is also
+	                // the number of the hash function addressing it
+} ;
+
+// number of keys the stash can hold before the table must double
+#define STASH_SIZE 4
+
+// counters describing the use of a cuckoo hash table's stash
+struct cuckoo_stash_stats {
+	int64 nstashed ;    // keys placed in the stash after an insertion cycled
+	int64 ndrained ;    // keys moved from the stash back into a table
+	int64 nhits ;       // lookups answered from the stash
+	int64 ndoublings ;  // times the table doubled because the stash was full
+} ;
+
+// counters describing the use of a cuckoo hash table as a cache
+struct cuckoo_cache_stats {
+	int64 nlookups ;    // lookups made
+	int64 nhits ;       // lookups which found their key
+	int64 nevictions ;  // keys evicted by the CLOCK hand to make room
+	int64 nchances ;    // referenced keys the hand passed over
+	int64 ndropped ;    // keys left without a slot with the stash full
+} ;
+
+// a hash table which stores its keys in 2 to MAX_CUCKOO_TABLES inner tables,
+// each with its own hash function, plus a small stash for the rare keys
+// whose insertion cycled
+struct cuckoo_table {
+	struct cuckoo_inner_table *tables[MAX_CUCKOO_TABLES] ;
+	int			ntables ; // number of inner tables in use
+	int64		size   ; // size of each table
+	int64		time   ; // CPU time elapsed
+	int64		random ; // state for choosing which key to displace
+	bool		compact ; // whether slots hold quotients, not whole keys
+	int			width  ; // bytes per slot, for a compact table
+	int64		capacity ; // most keys a cache holds, or 0 if the table grows
+	int64		hand   ; // next slot of a cache the CLOCK hand considers,
+	                     // counting through each inner table in turn
+	struct cuckoo_cache_stats cache_stats ;
+	bool		counting ; // whether keys have counts, once incremented
+	Key			stash[STASH_SIZE] ; // keys that could not be placed
+	int64		stash_counts[STASH_SIZE] ; // the stashed keys' counts
+	int			nstash ; // number of keys in the stash
+	struct cuckoo_stash_stats stash_stats ;
+	Log2Histogram chain_lengths ; // displacements made by each insertion
+	ResizeLog	resizes ; // each time the tables grew
+} ;
+
+// a compact table addresses a key in each of its inner tables by the
+// remainder of an invertible permutation of the key, different for each
+// table, divided by the table's size. as the address holds the remainder,
+// the slot need only hold the quotient to know the key exactly: about
+// log2(size) fewer bits than a key, and one more to mark the slot in use
+
+// multipliers of the permutations' mixing steps (those of the MurmurHash3
+// finaliser, cut to the key width), which each mix half of the key's bits
+// into the other half
+#define CUCKOO_MIX_A ((Key)0xFF51AFD7ED558CCDULL)
+#define CUCKOO_MIX_B ((Key)0xC4CEB9FE1A85EC53ULL)
+#define CUCKOO_HALF_BITS (KEY_BITS / 2)
+
+// the permutation of keys for the compact inner table with the given id:
+// the key is multiplied by an odd number and offset (as in the table's hash
+// function), then mixed. every step is invertible at the key width
+static inline Key cuckoo_permute(int id, Key key) {
+	static const int64 a[MAX_CUCKOO_TABLES] = { H1_A, H2_A, H3_A, H4_A } ;
+	static const int64 b[MAX_CUCKOO_TABLES] = { H1_B, H2_B, H3_B, H4_B } ;
+	Key x = key * (Key)a[id-1] + (Key)b[id-1] ;
+	x ^= x >> CUCKOO_HALF_BITS ;
+	x *= CUCKOO_MIX_A ;
+	x ^= x >> CUCKOO_HALF_BITS ;
+	x *= CUCKOO_MIX_B ;
+	x ^= x >> CUCKOO_HALF_BITS ;
+	return x ;
+}
+
+// the value of a compact slot of the given width, whose first byte is lowest
+// on a little-endian machine, a slot of at most 8 bytes is read with one
+// unaligned load of the 8 bytes from its start (the slots are followed by 8
+// bytes of padding so that this stays in bounds), then masked to its width
+static inline Key cuckoo_packed_get(const unsigned char *slot, int width) {
+#if KEY_BITS <= 64 && defined(__BYTE_ORDER__) && \
+  __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	int64 word ;
+	memcpy(&word, slot, sizeof word) ;
+	return word & (~(int64)0 >> (64 - 8 * width)) ;
+#else
+	Key value = 0 ;
+	int i ;
+	for (i=width; i-- > 0; ) {
+		value = (value << 8) | slot[i] ;
+	}
+	return value ;
+#endif
+}
+
+// the value of a compact slot holding a key whose permutation is x: its
+// quotient, shifted up to set the lowest bit, which marks the slot in use
+static inline Key cuckoo_packed_value(CuckooHashTable *hash_table, Key x) {
+	return ((x / hash_table->size) << 1) | 1 ;
+}
+
+// the address of a key in the inner table with the given id
+static inline int64 cuckoo_address(CuckooHashTable *hash_table, int id,
+  Key key) {
+	if (hash_table->compact) {
+		return cuckoo_permute(id, key) % hash_table->size ;
+	}
+	switch (id) {
+		case 1:
+			return h1(key) % hash_table->size ;
+		case 2:
+			return h2(key) % hash_table->size ;
+		case 3:
+			return h3(key) % hash_table->size ;
+		default:
+			return h4(key) % hash_table->size ;
+	}
+}
+
+// looks for a key in the stash of a cuckoo hash table
+static inline bool cuckoo_stash_contains(CuckooHashTable *hash_table,
+  Key key) {
+	int i ;
+	for (i=0; i<hash_table->nstash; i++) {
+		if (hash_table->stash[i] == key) {
+			return true ;
+		}
+	}
+	return false ;
+}
+
+// looks for a key in its slot of each inner table of a cuckoo hash table
+// (but not in the stash), reading every slot whether or not an earlier one
+// held the key, so that the loads are independent and can be in flight
+// together. doesn't mark a cache's slots as referenced
+// returns true if found, false if not
+static inline bool cuckoo_slots_contain(CuckooHashTable *hash_table,
+  Key key) {
+	bool found = false ;
+	int t ;
+	if (hash_table->compact) {
+		// the key is in a slot if that slot holds its quotient
+		for (t=0; t<hash_table->ntables; t++) {
+			Key x = cuckoo_permute(t+1, key) ;
+			int64 address = x % hash_table->size ;
+			found |= cuckoo_packed_get(hash_table->tables[t]->packed +
+			  address * hash_table->width, hash_table->width) ==
+			  cuckoo_packed_value(hash_table, x) ;
+		}
+		return found ;
+	}
+
+	// compute every address before reading any slot
+	int64 addresses[MAX_CUCKOO_TABLES] ;
+	for (t=0; t<hash_table->ntables; t++) {
+		addresses[t] = cuckoo_address(hash_table, t+1, key) ;
+	}
+	for (t=0; t<hash_table->ntables; t++) {
+		struct cuckoo_inner_table *table = hash_table->tables[t] ;
+		found |= table->inuse[addresses[t]] &&
+		  table->slots[addresses[t]] == key ;
+	}
+	return found ;
+}
+
+// looks up whether a key is inside a cuckoo hash table
+// returns true if found, false if not
+static inline bool cuckoo_hash_table_lookup_fast(CuckooHashTable *hash_table,
+  Key key) {
+	if (hash_table->capacity) {
+		// a cache marks the slot it finds the key in
+		return cuckoo_hash_table_lookup(hash_table, key) ;
+	}
+	return cuckoo_slots_contain(hash_table, key) ||
+	  (hash_table->nstash > 0 && cuckoo_stash_contains(hash_table, key)) ;
+}
+
+// inserts a new key into a cuckoo hash table
+// returns true if successful, false if the key was already present
+// only the common case of an empty first slot is handled inline, anything
+// needing displacement (or any insert into a compact table, a cache or a
+// counting table) goes through cuckoo_hash_table_insert
+static inline bool cuckoo_hash_table_insert_fast(CuckooHashTable *hash_table,
+  Key key) {
+	if (hash_table->compact || hash_table->capacity || hash_table->counting) {
+		return cuckoo_hash_table_insert(hash_table, key) ;
+	}
+	struct cuckoo_inner_table *t1 = hash_table->tables[0] ;
+	int64 v = h1(key) % hash_table->size ;
+
+	if (!t1->inuse[v] && hash_table->nstash == 0) {
+		// the key may still be sitting in another of its slots
+		if (cuckoo_hash_table_lookup_fast(hash_table, key)) {
+			return false ;
+		}
+		t1->slots[v] = key ;
+		t1->inuse[v] = true ;
+		t1->load++ ;
+		return true ;
+	}
+	return cuckoo_hash_table_insert(hash_table, key) ;
+}
+
+#endif
@@ -0,0 +1,863 @@
+/* * * * * * * * *
+ * Concurrent dynamic hash table using extendible hashing with multiple keys
+ * per bucket, which any number of threads may insert into and look up in at
+ * once
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include  <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include   <time.h>
+#include <pthread.h>
+
+#include "xtndblc.h"
+#include "../metrics.h"
+#include "../budget.h"
+
+// a bucket stores an array of keys, which only grows while the bucket is in
+// the table of pointers. it is replaced, never emptied, once it is full
+typedef struct bucket {
+	pthread_mutex_t lock ; // held by a writer adding a key to the bucket, or
+                        // replacing it
+	int64 id ;          // the first address in the table which points to it
+	int depth ;         // number of hash value bits being used by this bucket
+	int capacity ;      // most keys it can hold: bucketsize, unless it grew
+	int nkeys ;         // number of keys in the bucket. read without the
+                        // lock, so a key is in place before it is counted
+	bool retired ;      // has it been replaced in the table of pointers?
+	Key *keys ;         // the keys stored in this bucket
+	int64 **counters ;  // the counter of each key, or NULL while no key has
+                        // one. set under the lock, read without it
+	struct bucket *next_retired ; // next bucket waiting to be freed
+} Bucket ;
+
+// the number of counters in each chunk of them
+#define COUNTER_CHUNK 4096
+
+// counters are handed out from chunks which are only freed with the table,
+// so that a key's counter stays put while its key moves between buckets,
+// and can be added to without a lock
+typedef struct counter_chunk {
+	struct counter_chunk *next ;   // the chunk handed out from before this
+	int64 counters[COUNTER_CHUNK] ;
+} CounterChunk ;
+
+// a table of pointers to buckets, which only ever changes its pointers:
+// doubling it replaces it with a copy of twice the size
+typedef struct pointer_table {
+	int depth ;         // how many bits of the hash value to use
+	int64 size ;        // number of pointers (2^depth)
+	struct pointer_table *next_retired ; // next table waiting to be freed
+	Bucket *buckets[] ; // the pointers themselves
+} PointerTable ;
+
+// counters of the running operations of the threads assigned to it, by the
+// parity of the epoch each started in, along with the number of keys they
+// have inserted. each slot is a cache line of its own
+typedef struct reader_slot {
+	int64 active[2] ;
+	int64 nkeys ;
+	char padding[64 - 3 * sizeof(int64)] ;
+} ReaderSlot ;
+
+// a replaced bucket or table of pointers is retired, in a list for the
+// parity of the epoch at the time, rather than freed straight away. the
+// epoch only advances once no operation started two epochs ago is running,
+// at which point nothing retired two epochs ago can still be being read
+struct xtndblc_table {
+	PointerTable *pointers ; // the current table of pointers
+	pthread_mutex_t pointers_lock ; // held while changing pointers, or
+                        // replacing the table of them
+	int bucketsize ;    // keys per bucket (before any growth)
+
+	ReaderSlot slots[XTNDBLC_READER_SLOTS] ;
+	int64 epoch ;       // advanced by reclamation
+	pthread_mutex_t reclaim_lock ; // held while retiring or freeing
+	Bucket *retired_buckets[2] ;
+	PointerTable *retired_pointers[2] ;
+	int64 nretired_buckets ; // number waiting to be freed, in both lists
+	int64 nretired_pointers ;
+
+	pthread_mutex_t counters_lock ; // held while handing out a counter
+	CounterChunk *chunks ; // chunks of counters, newest first
+	int64 ncounters ;   // number of counters handed out
+
+	// statistics, changed under pointers_lock
+	int64 nbuckets ;    // number of buckets the table points to
+	int64 nsplits ;     // number of buckets split
+	int64 ngrown ;      // number of buckets grown rather than split
+	ResizeLog resizes ; // each time the table of pointers doubled
+} ;
+
+// the next reader slot to assign to a thread using any table
+static int next_slot = 0 ;
+
+/* * * *
+ * helper functions
+ */
+
+// creates a new empty bucket with first_address as its id, with room for
+// capacity keys
+static Bucket *new_bucket(int64 first_address, int depth, int capacity) {
+	Bucket *bucket = malloc(sizeof *bucket) ;
+	assert(bucket) ;
+	pthread_mutex_init(&bucket->lock, NULL) ;
+
+	bucket->id = first_address ;
+	bucket->depth = depth ;
+	bucket->capacity = capacity ;
+	bucket->nkeys = 0 ;
+	bucket->retired = false ;
+	bucket->keys = malloc((sizeof *bucket->keys) * capacity) ;
+	assert(bucket->keys) ;
+	bucket->counters = NULL ;
+	bucket->next_retired = NULL ;
+
+	return bucket ;
+}
+
+// frees a bucket
+static void free_bucket(Bucket *bucket) {
+	pthread_mutex_destroy(&bucket->lock) ;
+	free(bucket->keys) ;
+	free(bucket->counters) ;
+	free(bucket) ;
+}
+
+// adds the ith key of a bucket, with its counter if it has one, to another
+// bucket which no other thread can see yet
+static void move_key(Bucket *from, int i, Bucket *to) {
+	if (from->counters) {
+		if (!to->counters) {
+			to->counters = calloc(to->capacity, sizeof *to->counters) ;
+			assert(to->counters) ;
+		}
+		to->counters[to->nkeys] = from->counters[i] ;
+	}
+	to->keys[to->nkeys++] = from->keys[i] ;
+}
+
+// frees every bucket a table of pointers points to, from the last address
+// pointing to it, as the earlier ones have to read it to know it isn't theirs
+static void free_buckets(PointerTable *pointers) {
+	int64 i ;
+	for (i=0; i<pointers->size; i++) {
+		Bucket *bucket = pointers->buckets[i] ;
+		if (i + ((int64)1 << bucket->depth) >= pointers->size) {
+			free_bucket(bucket) ;
+		}
+	}
+}
+
+// creates a table of 2^depth pointers, which are all to be set before they
+// are read
+static PointerTable *new_pointer_table(int depth) {
+	int64 size = (int64)1 << depth ;
+	PointerTable *pointers = malloc(sizeof *pointers +
+	  (sizeof *pointers->buckets) * size) ;
+	assert(pointers) ;
+	pointers->depth = depth ;
+	pointers->size = size ;
+	pointers->next_retired = NULL ;
+	return pointers ;
+}
+
+// the memory taken by a table with a table of pointers of the given size and
+// the given number of buckets of bucketsize keys
+static int64 table_bytes(int bucketsize, int64 size, int64 nbuckets) {
+	return size * sizeof(Bucket *) +
+	  nbuckets * (sizeof(Bucket) + bucketsize * sizeof(Key)) ;
+}
+
+// finds a key in a bucket. the bucket's keys may be being added to, but
+// those it counts are in place
+// returns the key's position in the bucket, or -1 if it isn't there
+static int key_index(Bucket *bucket, Key key) {
+	int nkeys = __atomic_load_n(&bucket->nkeys, __ATOMIC_ACQUIRE) ;
+	int i ;
+	for (i=0; i<nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			return i ;
+		}
+	}
+	return -1 ;
+}
+
+// checks whether a bucket holds a key, as for key_index
+static bool bucket_contains(Bucket *bucket, Key key) {
+	return key_index(bucket, key) >= 0 ;
+}
+
+// the counter of the ith key of a bucket, which may be being given one
+// returns NULL if the key has no counter yet
+static int64 *find_counter(Bucket *bucket, int i) {
+	int64 **counters = __atomic_load_n(&bucket->counters, __ATOMIC_ACQUIRE) ;
+	return counters ? __atomic_load_n(&counters[i], __ATOMIC_ACQUIRE) : NULL ;
+}
+
+// hands out a new counter, at 0, from the table's newest chunk of counters
+static int64 *new_counter(XtndblCHashTable *table) {
+	pthread_mutex_lock(&table->counters_lock) ;
+	int used = table->ncounters % COUNTER_CHUNK ;
+	if (used == 0) {
+		CounterChunk *chunk = calloc(1, sizeof *chunk) ;
+		assert(chunk) ;
+		chunk->next = table->chunks ;
+		table->chunks = chunk ;
+	}
+	int64 *counter = &table->chunks->counters[used] ;
+	table->ncounters++ ;
+	pthread_mutex_unlock(&table->counters_lock) ;
+	return counter ;
+}
+
+// the counter of the ith key of a bucket, locked by the caller, giving the
+// key a new one if it has none. the counter is published with release
+// stores, for find_counter to see without the lock
+static int64 *own_counter(XtndblCHashTable *table, Bucket *bucket, int i) {
+	if (!bucket->counters) {
+		int64 **counters = calloc(bucket->capacity, sizeof *counters) ;
+		assert(counters) ;
+		__atomic_store_n(&bucket->counters, counters, __ATOMIC_RELEASE) ;
+	}
+	if (!bucket->counters[i]) {
+		__atomic_store_n(&bucket->counters[i], new_counter(table),
+		  __ATOMIC_RELEASE) ;
+	}
+	return bucket->counters[i] ;
+}
+
+// the bucket a key with the given hash is in, in the current table of
+// pointers
+static Bucket *current_bucket(XtndblCHashTable *table, int64 hash) {
+	PointerTable *pointers = __atomic_load_n(&table->pointers,
+	  __ATOMIC_ACQUIRE) ;
+	return __atomic_load_n(
+	  &pointers->buckets[rightmostnbits(pointers->depth, hash)],
+	  __ATOMIC_ACQUIRE) ;
+}
+
+/* * * *
+ * epoch-based reclamation
+ */
+
+// the reader slot of the calling thread, assigned on its first operation on
+// any table
+static ReaderSlot *thread_slot(XtndblCHashTable *table) {
+	static __thread int slot = -1 ;
+	if (slot < 0) {
+		slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED)
+		  % XTNDBLC_READER_SLOTS ;
+	}
+	return &table->slots[slot] ;
+}
+
+// counts an operation as running in the current epoch, until it leaves,
+// so that nothing it may read is freed before then
+// returns the parity of the epoch to leave
+static int enter(XtndblCHashTable *table, ReaderSlot *slot) {
+	while (true) {
+		int64 epoch = __atomic_load_n(&table->epoch, __ATOMIC_SEQ_CST) ;
+		int parity = epoch & 1 ;
+		__atomic_fetch_add(&slot->active[parity], 1, __ATOMIC_SEQ_CST) ;
+
+		// if the epoch advanced meanwhile, this parity may already have
+		// been checked, so count the operation in the new epoch instead
+		if (__atomic_load_n(&table->epoch, __ATOMIC_SEQ_CST) == epoch) {
+			return parity ;
+		}
+		__atomic_fetch_sub(&slot->active[parity], 1, __ATOMIC_SEQ_CST) ;
+	}
+}
+
+// marks an operation counted by enter as finished
+static void leave(ReaderSlot *slot, int parity) {
+	__atomic_fetch_sub(&slot->active[parity], 1, __ATOMIC_RELEASE) ;
+}
+
+// retires a bucket which has been replaced in the table of pointers
+static void retire_bucket(XtndblCHashTable *table, Bucket *bucket) {
+	pthread_mutex_lock(&table->reclaim_lock) ;
+	int parity = table->epoch & 1 ;
+	bucket->next_retired = table->retired_buckets[parity] ;
+	table->retired_buckets[parity] = bucket ;
+	table->nretired_buckets++ ;
+	pthread_mutex_unlock(&table->reclaim_lock) ;
+}
+
+// retires a table of pointers which has been replaced by a larger one
+static void retire_pointers(XtndblCHashTable *table,
+  PointerTable *pointers) {
+	pthread_mutex_lock(&table->reclaim_lock) ;
+	int parity = table->epoch & 1 ;
+	pointers->next_retired = table->retired_pointers[parity] ;
+	table->retired_pointers[parity] = pointers ;
+	table->nretired_pointers++ ;
+	pthread_mutex_unlock(&table->reclaim_lock) ;
+}
+
+// frees everything retired in the previous epoch and advances the epoch, if
+// no operation started in the previous epoch is still running. gives up
+// straight away if another thread is reclaiming
+static void try_reclaim(XtndblCHashTable *table) {
+	if (pthread_mutex_trylock(&table->reclaim_lock) != 0) {
+		return ;
+	}
+
+	int64 epoch = table->epoch ;
+	int previous = (epoch + 1) & 1 ;
+	int64 nactive = 0 ;
+	int i ;
+	for (i=0; i<XTNDBLC_READER_SLOTS; i++) {
+		nactive += __atomic_load_n(&table->slots[i].active[previous],
+		  __ATOMIC_SEQ_CST) ;
+	}
+
+	if (nactive == 0) {
+		while (table->retired_buckets[previous]) {
+			Bucket *next = table->retired_buckets[previous]->next_retired ;
+			free_bucket(table->retired_buckets[previous]) ;
+			table->retired_buckets[previous] = next ;
+			table->nretired_buckets-- ;
+		}
+		while (table->retired_pointers[previous]) {
+			PointerTable *next =
+			  table->retired_pointers[previous]->next_retired ;
+			free(table->retired_pointers[previous]) ;
+			table->retired_pointers[previous] = next ;
+			table->nretired_pointers-- ;
+		}
+		__atomic_store_n(&table->epoch, epoch + 1, __ATOMIC_SEQ_CST) ;
+	}
+
+	pthread_mutex_unlock(&table->reclaim_lock) ;
+}
+
+/* * * *
+ * growth
+ */
+
+// checks whether a full bucket, locked by the caller, can be split to make
+// room for a key with the given hash: unless the bucket is as deep as
+// allowed, splitting it would double the table of pointers past the memory
+// budget, or all of its keys share the key's lowest XTNDBLC_MAX_DEPTH hash
+// bits, so that splitting would never separate them
+static bool can_split(XtndblCHashTable *table, Bucket *bucket, int64 hash) {
+	if (bucket->depth >= XTNDBLC_MAX_DEPTH) {
+		return false ;
+	}
+	PointerTable *pointers = __atomic_load_n(&table->pointers,
+	  __ATOMIC_ACQUIRE) ;
+	if (bucket->depth == pointers->depth && !within_memory_budget(
+	  table_bytes(table->bucketsize, pointers->size * 2,
+	  __atomic_load_n(&table->nbuckets, __ATOMIC_RELAXED) + 1))) {
+		return false ;
+	}
+
+	int64 bits = rightmostnbits(XTNDBLC_MAX_DEPTH, hash) ;
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (rightmostnbits(XTNDBLC_MAX_DEPTH, h1(bucket->keys[i])) != bits) {
+			return true ;
+		}
+	}
+	return false ;
+}
+
+// replaces the table of pointers with one of twice the size, whose second
+// half points to the same buckets as its first half
+// the caller must hold pointers_lock
+static PointerTable *double_pointers(XtndblCHashTable *table) {
+	clock_t start = clock() ;
+	PointerTable *old = table->pointers ;
+	PointerTable *pointers = new_pointer_table(old->depth + 1) ;
+	memcpy(pointers->buckets, old->buckets,
+	  (sizeof *old->buckets) * old->size) ;
+	memcpy(pointers->buckets + old->size, old->buckets,
+	  (sizeof *old->buckets) * old->size) ;
+
+	__atomic_store_n(&table->pointers, pointers, __ATOMIC_RELEASE) ;
+	resize_log_add(&table->resizes, pointers->size, start) ;
+	retire_pointers(table, old) ;
+	return pointers ;
+}
+
+// replaces a full bucket, locked by the caller, with two new buckets holding
+// its keys split on their next hash bit, or if a key with the given hash
+// can't be made room for by splitting, with one bucket of twice the
+// capacity. the new buckets are filled before any pointer to them is
+// published, and the bucket is then retired and unlocked
+static void replace_bucket(XtndblCHashTable *table, Bucket *bucket,
+  int64 hash) {
+	int depth = bucket->depth ;
+	Bucket *zero, *one = NULL ;
+	int i ;
+
+	if (can_split(table, bucket, hash)) {
+		// count the keys going each way, to size each new bucket
+		int none = 0 ;
+		for (i=0; i<bucket->nkeys; i++) {
+			none += (h1(bucket->keys[i]) >> depth) & 1 ;
+		}
+		int nzero = bucket->nkeys - none ;
+		zero = new_bucket(bucket->id, depth + 1,
+		  nzero > table->bucketsize ? nzero : table->bucketsize) ;
+		one = new_bucket(bucket->id | (int64)1 << depth, depth + 1,
+		  none > table->bucketsize ? none : table->bucketsize) ;
+		for (i=0; i<bucket->nkeys; i++) {
+			move_key(bucket, i,
+			  (h1(bucket->keys[i]) >> depth) & 1 ? one : zero) ;
+		}
+	} else {
+		zero = new_bucket(bucket->id, depth, bucket->capacity * 2) ;
+		for (i=0; i<bucket->nkeys; i++) {
+			move_key(bucket, i, zero) ;
+		}
+	}
+
+	/* point the bucket's addresses at its replacements */
+	pthread_mutex_lock(&table->pointers_lock) ;
+	PointerTable *pointers = table->pointers ;
+	if (one && depth == pointers->depth) {
+		pointers = double_pointers(table) ;
+	}
+	int64 a ;
+	for (a=bucket->id; a<pointers->size; a+=(int64)1<<depth) {
+		Bucket *replacement = one && ((a >> depth) & 1) ? one : zero ;
+		__atomic_store_n(&pointers->buckets[a], replacement,
+		  __ATOMIC_RELEASE) ;
+	}
+	if (one) {
+		__atomic_store_n(&table->nbuckets, table->nbuckets + 1,
+		  __ATOMIC_RELAXED) ;
+		table->nsplits++ ;
+	} else {
+		table->ngrown++ ;
+	}
+	pthread_mutex_unlock(&table->pointers_lock) ;
+	/* ------------------------------------------ */
+
+	// writers waiting for the bucket will find it retired and look again
+	bucket->retired = true ;
+	pthread_mutex_unlock(&bucket->lock) ;
+	retire_bucket(table, bucket) ;
+}
+
+// the expected fraction of each bucket's keys in use once a table has grown
+// by splitting (about ln 2), used to estimate the depth a table will reach
+#define EXPECTED_BUCKET_FILL 0.69
+
+/* * * *
+ * main functions
+ */
+
+// initialises a concurrent extendible hash table with the given keys per
+// bucket
+XtndblCHashTable *new_xtndblc_hash_table(int bucketsize) {
+	XtndblCHashTable *table ;
+	int error = posix_memalign((void **)&table, sizeof(ReaderSlot),
+	  sizeof *table) ;
+	assert(!error) ;
+
+	/* initialise internal table data */
+	table->bucketsize = bucketsize ;
+	table->pointers = new_pointer_table(0) ;
+	table->pointers->buckets[0] = new_bucket(0, 0, bucketsize) ;
+	pthread_mutex_init(&table->pointers_lock, NULL) ;
+	/* ------------------------------ */
+
+	/* initialise reclamation */
+	memset(table->slots, 0, sizeof table->slots) ;
+	table->epoch = 0 ;
+	pthread_mutex_init(&table->reclaim_lock, NULL) ;
+	table->retired_buckets[0] = table->retired_buckets[1] = NULL ;
+	table->retired_pointers[0] = table->retired_pointers[1] = NULL ;
+	table->nretired_buckets = 0 ;
+	table->nretired_pointers = 0 ;
+	/* ---------------------- */
+
+	/* initialise counters */
+	pthread_mutex_init(&table->counters_lock, NULL) ;
+	table->chunks = NULL ;
+	table->ncounters = 0 ;
+	/* ------------------- */
+
+	/* initialise table stats */
+	table->nbuckets = 1 ;
+	table->nsplits = 0 ;
+	table->ngrown = 0 ;
+	clear_resize_log(&table->resizes) ;
+	/* ---------------------- */
+
+	return table ;
+}
+
+// frees all memory associated with a given concurrent extendible hash table
+void free_xtndblc_hash_table(XtndblCHashTable *table) {
+	assert(table) ;
+
+	free_buckets(table->pointers) ;
+	free(table->pointers) ;
+
+	// and everything still waiting to be freed
+	int parity ;
+	for (parity=0; parity<2; parity++) {
+		while (table->retired_buckets[parity]) {
+			Bucket *next = table->retired_buckets[parity]->next_retired ;
+			free_bucket(table->retired_buckets[parity]) ;
+			table->retired_buckets[parity] = next ;
+		}
+		while (table->retired_pointers[parity]) {
+			PointerTable *next =
+			  table->retired_pointers[parity]->next_retired ;
+			free(table->retired_pointers[parity]) ;
+			table->retired_pointers[parity] = next ;
+		}
+	}
+
+	while (table->chunks) {
+		CounterChunk *next = table->chunks->next ;
+		free(table->chunks) ;
+		table->chunks = next ;
+	}
+
+	pthread_mutex_destroy(&table->pointers_lock) ;
+	pthread_mutex_destroy(&table->reclaim_lock) ;
+	pthread_mutex_destroy(&table->counters_lock) ;
+	free(table) ;
+}
+
+// grows a concurrent extendible hash table up front to the depth it would
+// reach holding expected_keys keys, by rebuilding it with every bucket at
+// least that deep
+void xtndblc_hash_table_reserve(XtndblCHashTable *table,
+  int64 expected_keys) {
+	assert(table) ;
+
+	// find the smallest depth whose buckets would hold the expected keys,
+	// short of one whose buckets would put the table over budget
+	int depth = 0 ;
+	while (depth < XTNDBLC_MAX_DEPTH && ((int64)1 << depth) *
+	  (double)table->bucketsize * EXPECTED_BUCKET_FILL < expected_keys &&
+	  within_memory_budget(table_bytes(table->bucketsize, (int64)2 << depth,
+	  (int64)2 << depth))) {
+		depth++ ;
+	}
+	PointerTable *old = table->pointers ;
+	if (depth <= old->depth) {
+		return ;
+	}
+
+	// each address gets a bucket of its own at that depth (or any deeper
+	// bucket's depth), holding the keys of the old bucket which belong to it
+	clock_t start = clock() ;
+	PointerTable *pointers = new_pointer_table(depth) ;
+	int64 a, nbuckets = 0 ;
+	int i ;
+	for (a=0; a<pointers->size; a++) {
+		Bucket *bucket = old->buckets[rightmostnbits(old->depth, a)] ;
+		int bucket_depth = bucket->depth > depth ? bucket->depth : depth ;
+		int64 id = rightmostnbits(bucket_depth, a) ;
+		if (id == a) {
+			int nkeys = 0 ;
+			for (i=0; i<bucket->nkeys; i++) {
+				int64 hash = h1(bucket->keys[i]) ;
+				nkeys += rightmostnbits(bucket_depth, hash) == id ;
+			}
+			Bucket *part = new_bucket(id, bucket_depth,
+			  nkeys > table->bucketsize ? nkeys : table->bucketsize) ;
+			for (i=0; i<bucket->nkeys; i++) {
+				if (rightmostnbits(bucket_depth, h1(bucket->keys[i])) == id) {
+					move_key(bucket, i, part) ;
+				}
+			}
+			pointers->buckets[a] = part ;
+			nbuckets++ ;
+		} else {
+			pointers->buckets[a] = pointers->buckets[id] ;
+		}
+	}
+
+	free_buckets(old) ;
+	free(old) ;
+	table->pointers = pointers ;
+	table->nbuckets = nbuckets ;
+	resize_log_add(&table->resizes, pointers->size, start) ;
+}
+
+// inserts a new key into a concurrent extendible hash table
+// returns true if successful, false if the key was already present
+bool xtndblc_hash_table_insert(XtndblCHashTable *table, Key key) {
+	assert(table) ;
+	int64 hash = h1(key) ;
+	ReaderSlot *slot = thread_slot(table) ;
+	int parity = enter(table, slot) ;
+
+	bool inserted, replaced = false ;
+	while (true) {
+		Bucket *bucket = current_bucket(table, hash) ;
+		pthread_mutex_lock(&bucket->lock) ;
+
+		// a bucket replaced while waiting for it is looked up again
+		if (bucket->retired) {
+			pthread_mutex_unlock(&bucket->lock) ;
+			continue ;
+		}
+
+		/* check if key is already present */
+		if (bucket_contains(bucket, key)) {
+			pthread_mutex_unlock(&bucket->lock) ;
+			inserted = false ;
+			break ;
+		}
+		/* ------------------------------- */
+
+		/* insert key, counting it only once it is in place */
+		if (bucket->nkeys < bucket->capacity) {
+			bucket->keys[bucket->nkeys] = key ;
+			__atomic_store_n(&bucket->nkeys, bucket->nkeys + 1,
+			  __ATOMIC_RELEASE) ;
+			pthread_mutex_unlock(&bucket->lock) ;
+			inserted = true ;
+			break ;
+		}
+		/* ------------------------------------------------ */
+
+		// or make room by replacing the full bucket, then try again
+		replace_bucket(table, bucket, hash) ;
+		replaced = true ;
+	}
+
+	leave(slot, parity) ;
+	if (inserted) {
+		__atomic_fetch_add(&slot->nkeys, 1, __ATOMIC_RELAXED) ;
+	}
+	if (replaced) {
+		try_reclaim(table) ;
+	}
+	return inserted ;
+}
+
+// looks up whether a key is inside a concurrent extendible hash table
+// returns true if found, false if not
+bool xtndblc_hash_table_lookup(XtndblCHashTable *table, Key key) {
+	assert(table) ;
+	ReaderSlot *slot = thread_slot(table) ;
+	int parity = enter(table, slot) ;
+	bool found = bucket_contains(current_bucket(table, h1(key)), key) ;
+	leave(slot, parity) ;
+	return found ;
+}
+
+// adds delta to the count of a key in a concurrent extendible hash table,
+// inserting it with a count of delta if it isn't there
+// returns true if the key was inserted, and stores its new count in *count
+bool xtndblc_hash_table_increment(XtndblCHashTable *table, Key key,
+  int64 delta, int64 *count) {
+	assert(table) ;
+	int64 hash = h1(key) ;
+	ReaderSlot *slot = thread_slot(table) ;
+	int parity = enter(table, slot) ;
+
+	/* a key with a counter is counted without any lock, as the counter is
+	   shared by every bucket the key has been in */
+	Bucket *bucket = current_bucket(table, hash) ;
+	int i = key_index(bucket, key) ;
+	int64 *counter = i >= 0 ? find_counter(bucket, i) : NULL ;
+	if (counter) {
+		*count = __atomic_add_fetch(counter, delta, __ATOMIC_RELAXED) ;
+		leave(slot, parity) ;
+		return false ;
+	}
+	/* ------------------------------------------------------------------- */
+
+	bool inserted, replaced = false ;
+	while (true) {
+		bucket = current_bucket(table, hash) ;
+		pthread_mutex_lock(&bucket->lock) ;
+
+		// a bucket replaced while waiting for it is looked up again
+		if (bucket->retired) {
+			pthread_mutex_unlock(&bucket->lock) ;
+			continue ;
+		}
+
+		/* give a key already present a counter, if it has none yet */
+		i = key_index(bucket, key) ;
+		if (i >= 0) {
+			counter = own_counter(table, bucket, i) ;
+			pthread_mutex_unlock(&bucket->lock) ;
+			*count = __atomic_add_fetch(counter, delta, __ATOMIC_RELAXED) ;
+			inserted = false ;
+			break ;
+		}
+		/* ------------------------------------------------------- */
+
+		/* insert key with its counter, counting it once it is in place */
+		if (bucket->nkeys < bucket->capacity) {
+			bucket->keys[bucket->nkeys] = key ;
+			counter = own_counter(table, bucket, bucket->nkeys) ;
+			__atomic_store_n(counter, delta, __ATOMIC_RELAXED) ;
+			__atomic_store_n(&bucket->nkeys, bucket->nkeys + 1,
+			  __ATOMIC_RELEASE) ;
+			pthread_mutex_unlock(&bucket->lock) ;
+			*count = delta ;
+			inserted = true ;
+			break ;
+		}
+		/* ------------------------------------------------------------ */
+
+		// or make room by replacing the full bucket, then try again
+		replace_bucket(table, bucket, hash) ;
+		replaced = true ;
+	}
+
+	leave(slot, parity) ;
+	if (inserted) {
+		__atomic_fetch_add(&slot->nkeys, 1, __ATOMIC_RELAXED) ;
+	}
+	if (replaced) {
+		try_reclaim(table) ;
+	}
+	return inserted ;
+}
+
+// the count of a key in a concurrent extendible hash table, or 0 if it isn't
+// there
+int64 xtndblc_hash_table_count(XtndblCHashTable *table, Key key) {
+	assert(table) ;
+	ReaderSlot *slot = thread_slot(table) ;
+	int parity = enter(table, slot) ;
+	Bucket *bucket = current_bucket(table, h1(key)) ;
+	int i = key_index(bucket, key) ;
+	int64 *counter = i >= 0 ? find_counter(bucket, i) : NULL ;
+	int64 count = counter ? __atomic_load_n(counter, __ATOMIC_RELAXED) : 0 ;
+	leave(slot, parity) ;
+	return count ;
+}
+
+// the cursor of an iteration holds an address (up to and including the
+// table's size) in its high bits and the position of a key in that address's
+// bucket in the rest
+#define CURSOR_KEY_BITS (63 - XTNDBLC_MAX_DEPTH)
+
+// steps through the keys of a concurrent extendible hash table, one per call
+// the cursor counts through the keys of each bucket in turn, visiting each
+// bucket from the first address pointing to it
+bool xtndblc_hash_table_next(XtndblCHashTable *table, int64 *cursor,
+  Key *key) {
+	assert(table) ;
+
+	PointerTable *pointers = table->pointers ;
+	int64 address = *cursor >> CURSOR_KEY_BITS ;
+	int64 i = rightmostnbits(CURSOR_KEY_BITS, *cursor) ;
+	while (address < pointers->size) {
+		Bucket *bucket = pointers->buckets[address] ;
+		if (bucket->id == address && i < bucket->nkeys) {
+			*key = bucket->keys[i] ;
+			*cursor = (address << CURSOR_KEY_BITS) + i + 1 ;
+			return true ;
+		}
+		address++ ;
+		i = 0 ;
+	}
+
+	*cursor = address << CURSOR_KEY_BITS ;
+	return false ;
+}
+
+// prints the contents of a concurrent extendible hash table to stdout
+void xtndblc_hash_table_print(XtndblCHashTable *table) {
+	assert(table) ;
+	PointerTable *pointers = table->pointers ;
+	printf("--- table size: %llu\n", pointers->size) ;
+
+	// print header
+	printf("  table:               buckets:\n") ;
+	printf("  address | bucketid   bucketid [key]\n") ;
+
+	// print table and buckets
+	char keystr[KEY_STR_LEN] ;
+	int64 i ;
+	for (i = 0; i < pointers->size; i++) {
+		// table entry
+		Bucket *bucket = pointers->buckets[i] ;
+		printf("%9llu | %-9llu ", i, bucket->id) ;
+
+		// if this is the first address at which a bucket occurs, print it now
+		if (bucket->id == i) {
+			printf("%9llu ", bucket->id) ;
+			printf("[") ;
+			for (int j = 0; j < bucket->capacity; j++) {
+				if (j < bucket->nkeys) {
+					printf(" %s", keytostr(bucket->keys[j], keystr)) ;
+				} else {
+					printf(" -") ;
+				}
+			}
+			printf(" ]") ;
+		}
+		printf("\n") ;
+	}
+
+	printf("--- end table ---\n") ;
+}
+
+// the number of keys inserted into a table, summed over its reader slots
+static int64 count_keys(XtndblCHashTable *table) {
+	int64 nkeys = 0 ;
+	int i ;
+	for (i=0; i<XTNDBLC_READER_SLOTS; i++) {
+		nkeys += __atomic_load_n(&table->slots[i].nkeys, __ATOMIC_RELAXED) ;
+	}
+	return nkeys ;
+}
+
+// prints statistics about a concurrent extendible hash table to stdout
+void xtndblc_hash_table_stats(XtndblCHashTable *table) {
+	assert(table) ;
+	PointerTable *pointers = table->pointers ;
+	int64 nkeys = count_keys(table) ;
+
+	printf("\n----- table stats -----\n") ;
+
+	// print table info
+	printf("current table size:\t%llu\n", pointers->size) ;
+	printf("number of keys    :\t%llu\n", nkeys) ;
+	printf("number of buckets :\t%llu\n\n", table->nbuckets) ;
+	printf("space usage factor:\t%.3f%%\n", nkeys * 100.0 /
+	  (pointers->size * table->bucketsize)) ;
+	printf("bucket size       :\t%d\n", table->bucketsize) ;
+	printf("buckets split     :\t%llu\n", table->nsplits) ;
+	printf("buckets grown     :\t%llu\n", table->ngrown) ;
+	printf("waiting to free   :\t%llu buckets, %llu tables of pointers\n",
+	  table->nretired_buckets, table->nretired_pointers) ;
+	printf("keys with counters:\t%llu\n", table->ncounters) ;
+
+	printf("   --- end stats ---\n") ;
+}
+
+// writes metrics about a concurrent extendible hash table to out as a JSON
+// object
+void xtndblc_hash_table_metrics(XtndblCHashTable *table, FILE *out) {
+	assert(table) ;
+	PointerTable *pointers = table->pointers ;
+	int64 nkeys = count_keys(table) ;
+
+	fprintf(out, "{\"size\":%llu,\"depth\":%d,\"bucketsize\":%d,"
+	  "\"nbuckets\":%llu,\"nkeys\":%llu,\"nsplits\":%llu,\"ngrown\":%llu,"
+	  "\"load_factor\":%.4f,", pointers->size, pointers->depth,
+	  table->bucketsize, table->nbuckets, nkeys, table->nsplits,
+	  table->ngrown, nkeys * 1.0 / (table->nbuckets * table->bucketsize)) ;
+	fprintf(out, "\"retired\":{\"buckets\":%llu,\"pointer_tables\":%llu},",
+	  table->nretired_buckets, table->nretired_pointers) ;
+	fprintf(out, "\"ncounters\":%llu,", table->ncounters) ;
+	fprintf(out, "\"resizes\":") ;
+	resize_log_json(&table->resizes, out) ;
+	fprintf(out, "}") ;
+}
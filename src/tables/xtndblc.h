@@ -0,0 +1,104 @@
+/* * * * * * * * *
+ * Concurrent dynamic hash table using extendible hashing with multiple keys
+ * per bucket, which any number of threads may insert into and look up in at
+ * once
+ *
+ * lookups take no locks: they read the current table of pointers and a
+ * bucket's keys through pointers which writers publish with release stores.
+ * an insert locks only the bucket its key goes in, so inserts into different
+ * buckets run in parallel. a full bucket isn't emptied in place, as a reader
+ * may be looking through it: it is split into two new buckets, which replace
+ * it in the table of pointers, and a table of pointers which needs doubling
+ * is copied at twice the size and replaces the old one with a single store.
+ * only those pointer updates are serialised, by a short-held lock on the
+ * table of pointers. replaced buckets and tables of pointers are freed once
+ * no operation which might still be reading them is running (epoch-based
+ * reclamation)
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef XTNDBLC_H
+#define XTNDBLC_H
+
+#include   <stdio.h>
+#include <stdbool.h>
+#include "../inthash.h"
+#include "xtndbln.h"
+
+// the greatest depth a bucket may be split to, as for xtndbln tables. a full
+// bucket which can't be split (as it is this deep, its keys all share their
+// lowest XTNDBLC_MAX_DEPTH hash bits, or doubling the table of pointers would
+// put the table over the memory budget) is replaced by one with room for
+// twice as many keys instead
+#define XTNDBLC_MAX_DEPTH XTNDBLN_MAX_DEPTH
+
+// the number of counters of running operations, each on its own cache line.
+// threads are spread over them, so that starting and finishing operations
+// doesn't make every thread contend for one cache line
+#define XTNDBLC_READER_SLOTS 64
+
+typedef struct xtndblc_table XtndblCHashTable ;
+
+// initialises a concurrent extendible hash table with the given keys per
+// bucket
+XtndblCHashTable *new_xtndblc_hash_table(int bucketsize) ;
+
+// frees all memory associated with a given concurrent extendible hash table
+// no other thread may be using the table
+void free_xtndblc_hash_table(XtndblCHashTable *table) ;
+
+// grows a concurrent extendible hash table up front to the depth it would
+// reach holding expected_keys keys, so that loading them needs no doubling
+// and few splits
+// no other thread may be using the table
+void xtndblc_hash_table_reserve(XtndblCHashTable *table,
+  int64 expected_keys) ;
+
+// inserts a new key into a concurrent extendible hash table
+// returns true if successful, false if the key was already present
+// safe to call from any number of threads at once, along with lookups
+bool xtndblc_hash_table_insert(XtndblCHashTable *table, Key key) ;
+
+// looks up whether a key is inside a concurrent extendible hash table
+// returns true if found, false if not. a key whose insert has returned is
+// always found
+// safe to call from any number of threads at once, along with inserts
+bool xtndblc_hash_table_lookup(XtndblCHashTable *table, Key key) ;
+
+// adds delta to the count of a key in a concurrent extendible hash table,
+// inserting it with a count of delta if it isn't there. a key inserted
+// without a count has a count of 0
+// returns true if the key was inserted, and stores its new count in *count
+// safe to call from any number of threads at once, along with inserts and
+// lookups: a key's first increment locks its bucket to give it a counter,
+// and later ones add to that counter with an atomic fetch-add, taking no lock
+bool xtndblc_hash_table_increment(XtndblCHashTable *table, Key key,
+  int64 delta, int64 *count) ;
+
+// the count of a key in a concurrent extendible hash table, or 0 if it isn't
+// there. safe to call from any number of threads at once, along with
+// increments, each of which it sees all or none of
+int64 xtndblc_hash_table_count(XtndblCHashTable *table, Key key) ;
+
+// steps through the keys of a concurrent extendible hash table, one per
+// call: set *cursor to 0 to start from the first key, then pass it back
+// unchanged for each next key. the table must not be changed between calls
+// returns true and stores the next key in *key, or false once all are seen
+bool xtndblc_hash_table_next(XtndblCHashTable *table, int64 *cursor,
+  Key *key) ;
+
+// prints the contents of a concurrent extendible hash table to stdout
+void xtndblc_hash_table_print(XtndblCHashTable *table) ;
+
+// prints statistics about a concurrent extendible hash table to stdout
+void xtndblc_hash_table_stats(XtndblCHashTable *table) ;
+
+// writes metrics about a concurrent extendible hash table to out as a JSON
+// object: sizes, the numbers of splits and of buckets grown rather than
+// split, the number of buckets and tables of pointers waiting to be freed,
+// the number of keys given counters, and a log of each time the table of
+// pointers doubled
+void xtndblc_hash_table_metrics(XtndblCHashTable *table, FILE *out) ;
+
+#endif
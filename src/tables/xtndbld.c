@@ -0,0 +1,550 @@
+/* * * * * * * * *
+ * Disk-resident dynamic hash table using extendible hashing, with each
+ * bucket a fixed-size page of a file, buffered by a pool of pages evicted
+ * in CLOCK order
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include  <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include   <time.h>
+#include  <fcntl.h>
+#include <unistd.h>
+
+#include "xtndbld.h"
+#include "../metrics.h"
+
+// the deepest the table of pointers can grow. it is kept in memory, at
+// 8 bytes per address
+#define MAX_DISK_DEPTH 30
+
+// template for the name of an anonymous page file
+#define TEMP_FILE_TEMPLATE "/tmp/xtndbld-XXXXXX"
+
+// a page holds one bucket: how many hash value bits it uses, and its keys
+typedef struct page {
+	int depth ;     // number of hash value bits being used by this bucket
+	int nkeys ;     // number of keys currently contained in this bucket
+	Key keys[] ;    // the keys, as many as fit in the rest of the page
+} Page ;
+
+// number of keys that fit in each page
+#define PAGE_KEYS ((PAGE_SIZE - offsetof(Page, keys)) / sizeof(Key))
+
+// the page number of a frame holding no page
+#define NO_PAGE ((int64)-1)
+
+// a frame is one page buffer of the pool
+typedef struct frame {
+	int64 page ;        // number of the page held, or NO_PAGE
+	int pins ;          // number of users of the page, which can't be evicted
+	bool dirty ;        // has the page changed since it was read?
+	bool referenced ;   // has the page been used since the hand last passed?
+	Page *data ;        // the page's bytes
+} Frame ;
+
+typedef struct pool_stats {
+	int64 nhits ;       // page requests served from the pool
+	int64 nreads ;      // pages read from the file
+	int64 nwrites ;     // pages written to the file
+	int64 nevictions ;  // pages evicted to make room for another
+} PoolStats ;
+
+// a pool of page buffers. a page's frame is found through frame_of, indexed
+// by page number, and the CLOCK hand sweeps the frames to pick which to evict
+typedef struct pool {
+	Frame *frames ;
+	int nframes ;
+	int hand ;          // the next frame to consider for eviction
+	int *frame_of ;     // the frame holding each page, or -1 if none
+	int64 capacity ;    // number of pages frame_of has room for
+	PoolStats stats ;
+} Pool ;
+
+// a hash table is an array of page numbers, one per address, with a file of
+// the pages holding up to PAGE_KEYS keys each, along with some information
+// about the number of hash value bits to use for addressing
+struct xtndbld_table {
+	int64 *directory ;  // the page number of each address's bucket
+	int size ;          // number of entries in the directory (2^depth)
+	int depth ;         // how many bits of the hash value to use (log2(size))
+	int fd ;            // the page file
+	int64 npages ;      // number of pages of the file in use
+	int64 nkeys ;       // number of keys being stored in the table
+	int time ;          // CPU time elapsed to insert/lookup keys
+	Pool pool ;
+	ResizeLog resizes ; // each time the directory doubled
+} ;
+
+/* * * *
+ * page pool functions
+ */
+
+// reads or writes a page of the file
+static void read_page(XtndblDHashTable *table, int64 page, Page *data) {
+	ssize_t n = pread(table->fd, data, PAGE_SIZE, (off_t)page * PAGE_SIZE) ;
+	assert(n == PAGE_SIZE && "error: couldn't read page file!") ;
+	table->pool.stats.nreads++ ;
+}
+static void write_page(XtndblDHashTable *table, int64 page, Page *data) {
+	ssize_t n = pwrite(table->fd, data, PAGE_SIZE, (off_t)page * PAGE_SIZE) ;
+	assert(n == PAGE_SIZE && "error: couldn't write page file!") ;
+	table->pool.stats.nwrites++ ;
+}
+
+// makes room in a pool's page index for pages up to page
+static void grow_frame_index(Pool *pool, int64 page) {
+	if (page < pool->capacity) {
+		return ;
+	}
+	int64 capacity = pool->capacity * 2 ;
+	while (capacity <= page) {
+		capacity *= 2 ;
+	}
+	pool->frame_of = realloc(pool->frame_of,
+	  (sizeof *pool->frame_of) * capacity) ;
+	assert(pool->frame_of) ;
+	int64 i ;
+	for (i=pool->capacity; i<capacity; i++) {
+		pool->frame_of[i] = -1 ;
+	}
+	pool->capacity = capacity ;
+}
+
+// chooses a frame to hold a new page, by sweeping the CLOCK hand past frames
+// until one is unpinned and unused since the hand last passed it. the chosen
+// frame's page is written back if it has changed
+static Frame *evict_frame(XtndblDHashTable *table) {
+	Pool *pool = &table->pool ;
+	int swept = 0 ;
+	while (true) {
+		Frame *frame = &pool->frames[pool->hand] ;
+		pool->hand = (pool->hand + 1) % pool->nframes ;
+		swept++ ;
+		assert(swept <= 2 * pool->nframes && "error: every page is pinned!") ;
+
+		if (frame->pins > 0) {
+			continue ;
+		}
+		if (frame->referenced) {
+			frame->referenced = false ;
+			continue ;
+		}
+
+		if (frame->page != NO_PAGE) {
+			if (frame->dirty) {
+				write_page(table, frame->page, frame->data) ;
+			}
+			pool->frame_of[frame->page] = -1 ;
+			pool->stats.nevictions++ ;
+		}
+		return frame ;
+	}
+}
+
+// pins a page into the pool, reading it from the file if necessary
+// returns the page, which stays in the pool until unpinned
+static Page *pin_page(XtndblDHashTable *table, int64 page) {
+	Pool *pool = &table->pool ;
+	Frame *frame ;
+	if (pool->frame_of[page] >= 0) {
+		frame = &pool->frames[pool->frame_of[page]] ;
+		pool->stats.nhits++ ;
+	} else {
+		frame = evict_frame(table) ;
+		read_page(table, page, frame->data) ;
+		frame->page = page ;
+		frame->dirty = false ;
+		pool->frame_of[page] = frame - pool->frames ;
+	}
+	frame->pins++ ;
+	frame->referenced = true ;
+	return frame->data ;
+}
+
+// unpins a page, noting whether it has been changed
+static void unpin_page(XtndblDHashTable *table, int64 page, bool dirty) {
+	Frame *frame = &table->pool.frames[table->pool.frame_of[page]] ;
+	frame->pins-- ;
+	frame->dirty |= dirty ;
+}
+
+// adds a new empty page to the end of the file, pinned into the pool
+// returns its number, storing the page in *data
+static int64 new_page(XtndblDHashTable *table, int depth, Page **data) {
+	int64 page = table->npages++ ;
+	grow_frame_index(&table->pool, page) ;
+
+	Frame *frame = evict_frame(table) ;
+	memset(frame->data, 0, PAGE_SIZE) ;
+	frame->data->depth = depth ;
+	frame->data->nkeys = 0 ;
+	frame->page = page ;
+	frame->pins = 1 ;
+	frame->dirty = true ;
+	frame->referenced = true ;
+	table->pool.frame_of[page] = frame - table->pool.frames ;
+
+	*data = frame->data ;
+	return page ;
+}
+
+/* * * *
+ * helper functions
+ */
+
+// the number of hash value bits used by the bucket in a page
+static int page_depth(XtndblDHashTable *table, int64 number) {
+	Page *page = pin_page(table, number) ;
+	int depth = page->depth ;
+	unpin_page(table, number, false) ;
+	return depth ;
+}
+
+// doubles the directory, duplicating pointers from 1st half into 2nd
+static void double_xd_table(XtndblDHashTable *table) {
+	clock_t start = clock() ;
+	assert(table->depth < MAX_DISK_DEPTH &&
+	  "error: table has grown too large!") ;
+
+	int size = table->size * 2 ;
+	table->directory = realloc(table->directory,
+	  (sizeof *table->directory) * size) ;
+	assert(table->directory) ;
+	int i ;
+	for (i=0; i<table->size; i++) {
+		table->directory[table->size + i] = table->directory[i] ;
+	}
+
+	table->size = size ;
+	table->depth++ ;
+
+	resize_log_add(&table->resizes, size, start) ;
+}
+
+// splits the bucket at address into two pages, doubling the directory if
+// necessary
+static void split_xd_bucket(XtndblDHashTable *table, int address) {
+	int64 o_page = table->directory[address] ;
+	Page *old = pin_page(table, o_page) ;
+
+	// check if directory growth is needed
+	if (old->depth == table->depth) {
+		double_xd_table(table) ;
+	}
+
+	// create the new bucket's page and update depths of both
+	int depth = old->depth ;
+	Page *new ;
+	int64 n_page = new_page(table, depth + 1, &new) ;
+	old->depth = depth + 1 ;
+
+	// move keys with the new hash bit set over to the new page
+	int i, kept = 0 ;
+	for (i=0; i<old->nkeys; i++) {
+		if ((h1(old->keys[i]) >> depth) & 1) {
+			new->keys[new->nkeys++] = old->keys[i] ;
+		} else {
+			old->keys[kept++] = old->keys[i] ;
+		}
+	}
+	old->nkeys = kept ;
+
+	// redirect every second address of the old bucket to the new page
+	int first = (rightmostnbits(depth, address)) | (1 << depth) ;
+	int a ;
+	for (a=first; a<table->size; a+=1<<(depth+1)) {
+		table->directory[a] = n_page ;
+	}
+
+	unpin_page(table, o_page, true) ;
+	unpin_page(table, n_page, true) ;
+}
+
+/* * * *
+ * main functions
+ */
+
+// initialises a disk-resident extendible hash table stored in a new file at
+// path, or an anonymous temporary file, buffered by a pool of nframes pages
+XtndblDHashTable *new_xtndbld_hash_table(const char *path, int nframes) {
+
+	/* create the page file */
+	int fd ;
+	if (path) {
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) ;
+	} else {
+		char name[] = TEMP_FILE_TEMPLATE ;
+		fd = mkstemp(name) ;
+		if (fd >= 0) {
+			unlink(name) ;
+		}
+	}
+	if (fd < 0) {
+		return NULL ;
+	}
+	/* -------------------- */
+
+	XtndblDHashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->fd = fd ;
+	table->npages = 0 ;
+	table->nkeys = 0 ;
+	table->time = 0 ;
+	clear_resize_log(&table->resizes) ;
+
+	/* initialise the pool of page buffers */
+	Pool *pool = &table->pool ;
+	pool->nframes = nframes < MIN_POOL_FRAMES ? MIN_POOL_FRAMES : nframes ;
+	pool->frames = malloc((sizeof *pool->frames) * pool->nframes) ;
+	assert(pool->frames) ;
+	int i ;
+	for (i=0; i<pool->nframes; i++) {
+		pool->frames[i].page = NO_PAGE ;
+		pool->frames[i].pins = 0 ;
+		pool->frames[i].dirty = false ;
+		pool->frames[i].referenced = false ;
+		pool->frames[i].data = malloc(PAGE_SIZE) ;
+		assert(pool->frames[i].data) ;
+	}
+	pool->hand = 0 ;
+	pool->capacity = 16 ;
+	pool->frame_of = malloc((sizeof *pool->frame_of) * pool->capacity) ;
+	assert(pool->frame_of) ;
+	for (i=0; i<pool->capacity; i++) {
+		pool->frame_of[i] = -1 ;
+	}
+	pool->stats.nhits = 0 ;
+	pool->stats.nreads = 0 ;
+	pool->stats.nwrites = 0 ;
+	pool->stats.nevictions = 0 ;
+	/* ----------------------------------- */
+
+	/* start with a single address pointing to a single empty page */
+	table->size = 1 ;
+	table->depth = 0 ;
+	table->directory = malloc(sizeof *table->directory) ;
+	assert(table->directory) ;
+	Page *page ;
+	table->directory[0] = new_page(table, 0, &page) ;
+	unpin_page(table, table->directory[0], true) ;
+	/* ----------------------------------------------------------- */
+
+	return table ;
+}
+
+// frees all memory associated with a given disk-resident hash table, and
+// closes its file
+void free_xtndbld_hash_table(XtndblDHashTable *table) {
+	assert(table) ;
+
+	int i ;
+	for (i=0; i<table->pool.nframes; i++) {
+		free(table->pool.frames[i].data) ;
+	}
+	free(table->pool.frames) ;
+	free(table->pool.frame_of) ;
+	free(table->directory) ;
+	close(table->fd) ;
+	free(table) ;
+}
+
+// grows a disk-resident hash table up front to the depth it would reach
+// holding expected_keys keys, so that loading them needs no doubling and
+// few splits
+void xtndbld_hash_table_reserve(XtndblDHashTable *table,
+  int64 expected_keys) {
+	assert(table) ;
+
+	// find the smallest depth whose pages would hold the expected keys,
+	// assuming they end up about ln 2 full as they would by splitting
+	int depth = 0 ;
+	while (depth < MAX_DISK_DEPTH &&
+	  (1 << depth) * (double)PAGE_KEYS * 0.69 < expected_keys) {
+		depth++ ;
+	}
+
+	while (table->depth < depth) {
+		double_xd_table(table) ;
+	}
+
+	// split each address's bucket until it reaches the full depth; the new
+	// pages this creates sit at later addresses and are reached later
+	int i ;
+	for (i=0; i<table->size; i++) {
+		while (page_depth(table, table->directory[i]) < depth) {
+			split_xd_bucket(table, i) ;
+		}
+	}
+}
+
+// inserts a new key into a disk-resident hash table
+// returns true if successful, false if the key was already present
+bool xtndbld_hash_table_insert(XtndblDHashTable *table, Key key) {
+	assert(table) ;
+	int start_time = clock() ;
+
+	int64 hash = h1(key) ;
+	while (true) {
+		/* find the key's page, and look through it */
+		int address = rightmostnbits(table->depth, hash) ;
+		int64 number = table->directory[address] ;
+		Page *page = pin_page(table, number) ;
+
+		int i ;
+		for (i=0; i<page->nkeys; i++) {
+			if (page->keys[i] == key) {
+				unpin_page(table, number, false) ;
+				table->time += clock() - start_time ;
+				return false ;
+			}
+		}
+		/* ---------------------------------------- */
+
+		// add the key if there is room, otherwise split the page & retry
+		if (page->nkeys < PAGE_KEYS) {
+			page->keys[page->nkeys++] = key ;
+			unpin_page(table, number, true) ;
+			table->nkeys++ ;
+			table->time += clock() - start_time ;
+			return true ;
+		}
+		unpin_page(table, number, false) ;
+		split_xd_bucket(table, address) ;
+	}
+}
+
+// looks up whether a key is inside a disk-resident hash table
+// returns true if found, false if not
+bool xtndbld_hash_table_lookup(XtndblDHashTable *table, Key key) {
+	assert(table) ;
+	int start_time = clock() ;
+
+	int address = rightmostnbits(table->depth, h1(key)) ;
+	int64 number = table->directory[address] ;
+	Page *page = pin_page(table, number) ;
+
+	bool found = false ;
+	int i ;
+	for (i=0; i<page->nkeys && !found; i++) {
+		found = page->keys[i] == key ;
+	}
+
+	unpin_page(table, number, false) ;
+	table->time += clock() - start_time ;
+	return found ;
+}
+
+// steps through the keys of a disk-resident hash table, one per call
+// the cursor counts through the keys of each page of the file in turn
+bool xtndbld_hash_table_next(XtndblDHashTable *table, int64 *cursor,
+  Key *key) {
+	assert(table) ;
+
+	int64 number = *cursor / PAGE_KEYS ;
+	int i = *cursor % PAGE_KEYS ;
+	while (number < table->npages) {
+		Page *page = pin_page(table, number) ;
+		bool found = i < page->nkeys ;
+		if (found) {
+			*key = page->keys[i] ;
+		}
+		unpin_page(table, number, false) ;
+
+		if (found) {
+			*cursor = number * PAGE_KEYS + i + 1 ;
+			return true ;
+		}
+		number++ ;
+		i = 0 ;
+	}
+
+	*cursor = number * PAGE_KEYS ;
+	return false ;
+}
+
+// prints the contents of a disk-resident hash table to stdout
+void xtndbld_hash_table_print(XtndblDHashTable *table) {
+	assert(table) ;
+	printf("--- table size: %d\n", table->size) ;
+
+	// print header
+	printf("  table:               pages:\n") ;
+	printf("  address | page       page [key, key, ...]\n") ;
+
+	// print each address, and each page from the first address using it
+	char keystr[KEY_STR_LEN] ;
+	int i ;
+	for (i = 0; i < table->size; i++) {
+		int64 number = table->directory[i] ;
+		printf("%9d | %-9llu ", i, number) ;
+
+		Page *page = pin_page(table, number) ;
+		if ((rightmostnbits(page->depth, i)) == i) {
+			printf("%9llu [", number) ;
+			int j ;
+			for (j = 0; j < page->nkeys; j++) {
+				printf(" %s", keytostr(page->keys[j], keystr)) ;
+			}
+			printf(" ]") ;
+		}
+		unpin_page(table, number, false) ;
+		printf("\n") ;
+	}
+
+	printf("--- end table ---\n") ;
+}
+
+// prints statistics about a disk-resident hash table to stdout
+void xtndbld_hash_table_stats(XtndblDHashTable *table) {
+	assert(table) ;
+	PoolStats *stats = &table->pool.stats ;
+	int64 nrequests = stats->nhits + stats->nreads ;
+
+	printf("\n----- table stats -----\n") ;
+
+	// print table info
+	printf("current table size:\t%d\n", table->size) ;
+	printf("number of keys    :\t%llu\n", table->nkeys) ;
+	printf("number of pages   :\t%llu (%llu bytes)\n", table->npages,
+	  table->npages * PAGE_SIZE) ;
+	printf("keys per page     :\t%d\n", (int)PAGE_KEYS) ;
+	printf("space usage factor:\t%.3f%%\n", table->nkeys * 100.0 /
+	  (table->npages * PAGE_KEYS)) ;
+
+	// print page pool info
+	printf("pool size         :\t%d pages\n", table->pool.nframes) ;
+	printf("pool hit rate     :\t%.3f%% of %llu requests\n",
+	  nrequests ? stats->nhits * 100.0 / nrequests : 0.0, nrequests) ;
+	printf("pages read        :\t%llu\n", stats->nreads) ;
+	printf("pages written     :\t%llu\n", stats->nwrites) ;
+	printf("pages evicted     :\t%llu\n", stats->nevictions) ;
+
+	// calculate print time details
+	float seconds = table->time * 1.0 / CLOCKS_PER_SEC ;
+	printf("CPU time spent    :\t%.6f sec\n", seconds) ;
+	printf("\n--- end stats ---\n") ;
+}
+
+// writes metrics about a disk-resident hash table to out as a JSON object
+void xtndbld_hash_table_metrics(XtndblDHashTable *table, FILE *out) {
+	assert(table) ;
+	PoolStats *stats = &table->pool.stats ;
+
+	fprintf(out, "{\"size\":%d,\"depth\":%d,\"page_keys\":%d,\"npages\":%llu,"
+	  "\"nkeys\":%llu,\"cpu_secs\":%.6f,", table->size, table->depth,
+	  (int)PAGE_KEYS, table->npages, table->nkeys,
+	  table->time * 1.0 / CLOCKS_PER_SEC) ;
+	fprintf(out, "\"pool\":{\"frames\":%d,\"hits\":%llu,\"reads\":%llu,"
+	  "\"writes\":%llu,\"evictions\":%llu},\"resizes\":",
+	  table->pool.nframes, stats->nhits, stats->nreads, stats->nwrites,
+	  stats->nevictions) ;
+	resize_log_json(&table->resizes, out) ;
+	fprintf(out, "}") ;
+}
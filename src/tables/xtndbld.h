@@ -0,0 +1,68 @@
+/* * * * * * * * *
+ * Disk-resident dynamic hash table using extendible hashing, with each
+ * bucket a fixed-size page of a file. the table of pointers stays in memory,
+ * while pages are read and written through a bounded pool of page buffers,
+ * so a table can hold many times more keys than fit in memory
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef XTNDBLD_H
+#define XTNDBLD_H
+
+#include   <stdio.h>
+#include <stdbool.h>
+#include "../inthash.h"
+
+// size of each page of the file, and so of each bucket, in bytes
+#define PAGE_SIZE 4096
+
+// the fewest page buffers a pool can have: a split needs two pages at once
+#define MIN_POOL_FRAMES 4
+
+typedef struct xtndbld_table XtndblDHashTable ;
+
+// initialises a disk-resident extendible hash table whose pages are stored in
+// a new file at path (replacing any file there), or in an anonymous temporary
+// file if path is NULL, and buffered by a pool of nframes pages
+// returns NULL if the file couldn't be created
+XtndblDHashTable *new_xtndbld_hash_table(const char *path, int nframes) ;
+
+// frees all memory associated with a given disk-resident hash table, and
+// closes its file
+void free_xtndbld_hash_table(XtndblDHashTable *table) ;
+
+// grows a disk-resident hash table up front to the depth it would reach
+// holding expected_keys keys, so that loading them needs no doubling and
+// few splits
+void xtndbld_hash_table_reserve(XtndblDHashTable *table,
+  int64 expected_keys) ;
+
+// inserts a new key into a disk-resident hash table
+// returns true if successful, false if the key was already present
+bool xtndbld_hash_table_insert(XtndblDHashTable *table, Key key) ;
+
+// looks up whether a key is inside a disk-resident hash table, reading at
+// most one page from the file
+// returns true if found, false if not
+bool xtndbld_hash_table_lookup(XtndblDHashTable *table, Key key) ;
+
+// steps through the keys of a disk-resident hash table, one per call: set
+// *cursor to 0 to start from the first key, then pass it back unchanged for
+// each next key. the table must not be changed between calls
+// returns true and stores the next key in *key, or false once all are seen
+bool xtndbld_hash_table_next(XtndblDHashTable *table, int64 *cursor,
+  Key *key) ;
+
+// prints the contents of a disk-resident hash table to stdout
+void xtndbld_hash_table_print(XtndblDHashTable *table) ;
+
+// prints statistics about a disk-resident hash table to stdout
+void xtndbld_hash_table_stats(XtndblDHashTable *table) ;
+
+// writes metrics about a disk-resident hash table to out as a JSON object:
+// sizes, page pool hits, reads, writes and evictions, and a log of each time
+// the table of pointers doubled
+void xtndbld_hash_table_metrics(XtndblDHashTable *table, FILE *out) ;
+
+#endif
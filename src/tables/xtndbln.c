@@ -7,147 +7,651 @@
 
 #include  <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include   <time.h>
 
 #include "xtndbln.h"
+#include "xtndbln_fast.h"
+#include "../budget.h"
 
-// macro to calculate the rightmost n bits of a number x
-#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
-
-// a bucket stores an array of keys
-// it also knows how many bits are shared between possible keys, and the first 
-// table address that references it
-typedef struct xtndbln_bucket {
-	int id ;        // a unique id for this bucket, equal to the first address
-                    // in the table which points to it
-	int depth ;     // number of hash value bits being used by this bucket
-	int nkeys ;     // number of keys currently contained in this bucket
-	int64 *keys ;   // the keys stored in this bucket
-} Bucket ;
-
-typedef struct stats {
-	int nbuckets ;  // number of distinct buckets does the table point to
-	int nkeys ;     // number of keys being stored in the table
-	int time ;      // CPU time elapsed to insert/lookup keys in this table
-} Stats ;
-
-// a hash table is an array of slots pointing to buckets holding up to 
-// bucketsize keys, along with some information about the number of hash value 
-// bits to use for addressing
-struct xtndbln_table {
-	Bucket **buckets ;  // array of pointers to buckets
-	int size ;          // number of entries in the table of pointers (2^depth)
-	int depth ;         // how many bits of the hash value to use (log2(size))
-	int bucketsize ;    // maximum number of keys per bucket
-	Stats stats ;
-} ;
+// the table layout is defined in xtndbln_fast.h, for the inline fast paths
+typedef struct xtndbln_bucket   Bucket ;
+typedef struct xtndbln_overflow Overflow ;
+typedef struct xtndbln_stats    Stats ;
 
 /* * * *
  * helper functions
  */
 
 // creates a new empty bucket with first_address as its id
-static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
+static Bucket *new_bucket(int64 first_address, int depth, int bucketsize) {
 	Bucket *bucket = malloc(sizeof *bucket) ; 
 	assert(bucket) ;
 
 	bucket->id = first_address ;
 	bucket->depth = depth ;
 	bucket->nkeys = 0 ;
+	bucket->refs = 1 ;
 	
 	bucket->keys = malloc((sizeof *bucket->keys) * bucketsize) ;
 	assert(bucket->keys) ;
+	bucket->counts = NULL ;
+	bucket->overflow = NULL ;
 
 	return bucket ;
 }
 
+// creates a new empty overflow page for up to bucketsize keys
+static Overflow *new_overflow_page(int bucketsize) {
+	Overflow *page = malloc(sizeof *page) ;
+	assert(page) ;
+
+	page->nkeys = 0 ;
+	page->keys = malloc((sizeof *page->keys) * bucketsize) ;
+	assert(page->keys) ;
+	page->counts = NULL ;
+	page->next = NULL ;
+
+	return page ;
+}
+
+// frees a chain of overflow pages
+static void free_overflow_pages(Overflow *page) {
+	while (page) {
+		Overflow *next = page->next ;
+		free(page->keys) ;
+		free(page->counts) ;
+		free(page) ;
+		page = next ;
+	}
+}
+
+// frees a bucket along with its overflow pages
+static void free_bucket(Bucket *bucket) {
+	free_overflow_pages(bucket->overflow) ;
+	free(bucket->keys) ;
+	free(bucket->counts) ;
+	free(bucket) ;
+}
+
+// the ith count of a bucket's or overflow page's counts
+static int64 count_at(int64 *counts, int i) {
+	return counts ? counts[i] : 0 ;
+}
+
+// sets the ith count of a bucket's or overflow page's counts, which are only
+// allocated once one of them isn't 0
+static void set_count(int64 **counts, int bucketsize, int i, int64 count) {
+	if (*counts == NULL) {
+		if (count == 0) {
+			return ;
+		}
+		*counts = calloc(bucketsize, sizeof **counts) ;
+		assert(*counts) ;
+	}
+	(*counts)[i] = count ;
+}
+
+// copies the first n counts of a bucket or overflow page, if it has any
+static int64 *copy_counts(int64 *counts, int bucketsize, int n) {
+	if (counts == NULL) {
+		return NULL ;
+	}
+	int64 *copy = malloc((sizeof *copy) * bucketsize) ;
+	assert(copy) ;
+	memcpy(copy, counts, (sizeof *copy) * n) ;
+	return copy ;
+}
+
+// adds a key with the given count to a bucket, or to its newest overflow
+// page once it is full, starting a new page when that one is full too
+static void add_key(Bucket *bucket, int bucketsize, Key key, int64 count) {
+	if (bucket->nkeys < bucketsize) {
+		set_count(&bucket->counts, bucketsize, bucket->nkeys, count) ;
+		bucket->keys[bucket->nkeys++] = key ;
+		return ;
+	}
+
+	Overflow *page = bucket->overflow ;
+	if (page == NULL || page->nkeys == bucketsize) {
+		page = new_overflow_page(bucketsize) ;
+		page->next = bucket->overflow ;
+		bucket->overflow = page ;
+	}
+	set_count(&page->counts, bucketsize, page->nkeys, count) ;
+	page->keys[page->nkeys++] = key ;
+}
+
+// adds delta to the count of a key in a bucket or its overflow pages
+// returns false if the key isn't there, or stores its new count in *count
+static bool add_to_count(Bucket *bucket, int bucketsize, Key key,
+  int64 delta, int64 *count) {
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			*count = count_at(bucket->counts, i) + delta ;
+			set_count(&bucket->counts, bucketsize, i, *count) ;
+			return true ;
+		}
+	}
+
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		for (i=0; i<page->nkeys; i++) {
+			if (page->keys[i] == key) {
+				*count = count_at(page->counts, i) + delta ;
+				set_count(&page->counts, bucketsize, i, *count) ;
+				return true ;
+			}
+		}
+	}
+	return false ;
+}
+
+// the count of a key in a bucket or its overflow pages, or 0 if it isn't
+// there
+static int64 key_count(Bucket *bucket, Key key) {
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			return count_at(bucket->counts, i) ;
+		}
+	}
+
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		for (i=0; i<page->nkeys; i++) {
+			if (page->keys[i] == key) {
+				return count_at(page->counts, i) ;
+			}
+		}
+	}
+	return 0 ;
+}
+
+// checks whether a bucket, or any of its overflow pages, holds a key
+static bool bucket_contains(Bucket *bucket, Key key) {
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			return true ;
+		}
+	}
+
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		for (i=0; i<page->nkeys; i++) {
+			if (page->keys[i] == key) {
+				return true ;
+			}
+		}
+	}
+	return false ;
+}
+
+// finds the ith key of a bucket, counting on through its overflow pages
+// returns false if the bucket has i keys or fewer
+static bool nth_key(Bucket *bucket, int64 i, Key *key) {
+	if (i < bucket->nkeys) {
+		*key = bucket->keys[i] ;
+		return true ;
+	}
+	i -= bucket->nkeys ;
+
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		if (i < page->nkeys) {
+			*key = page->keys[i] ;
+			return true ;
+		}
+		i -= page->nkeys ;
+	}
+	return false ;
+}
+
+// counts the keys in a bucket, including those in its overflow pages
+static int count_keys(Bucket *bucket) {
+	int nkeys = bucket->nkeys ;
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		nkeys += page->nkeys ;
+	}
+	return nkeys ;
+}
+
+// counts the overflow pages chained from a bucket
+static int chain_length(Bucket *bucket) {
+	int npages = 0 ;
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		npages++ ;
+	}
+	return npages ;
+}
+
+// the memory taken by a table with a table of pointers of the given size and
+// the given number of buckets of bucketsize keys, not counting overflow pages
+static int64 table_bytes(int bucketsize, int64 size, int64 nbuckets) {
+	return size * sizeof(Bucket *) +
+	  nbuckets * (sizeof(Bucket) + bucketsize * sizeof(Key)) ;
+}
+
+// checks whether a full bucket should take a key with the given hash into
+// its overflow pages rather than be split: when the bucket is as deep as
+// allowed, when splitting it (and doubling the table of pointers, if it is
+// as deep as the table) would put the table over the memory budget, or when
+// all of its keys share the key's lowest XTNDBLN_MAX_DEPTH hash bits, so
+// that splitting would never separate them
+static bool needs_overflow(XtndblNHashTable *table, Bucket *bucket,
+  int64 hash) {
+	if (bucket->depth >= XTNDBLN_MAX_DEPTH) {
+		return true ;
+	}
+	int64 size = bucket->depth == table->depth ? table->size * 2
+	  : table->size ;
+	if (!within_memory_budget(table_bytes(table->bucketsize, size,
+	  table->stats.nbuckets + 1))) {
+		return true ;
+	}
+
+	// in a bucket which can be split, a key with other bits usually comes
+	// first, so this seldom hashes more than one or two keys
+	int64 bits = rightmostnbits(XTNDBLN_MAX_DEPTH, hash) ;
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if ((rightmostnbits(XTNDBLN_MAX_DEPTH, h1(bucket->keys[i]))) != bits) {
+			return false ;
+		}
+	}
+
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		for (i=0; i<page->nkeys; i++) {
+			if ((rightmostnbits(XTNDBLN_MAX_DEPTH, h1(page->keys[i])))
+			  != bits) {
+				return false ;
+			}
+		}
+	}
+	return true ;
+}
+
+// the bucket a table's table of pointers points to at address
+static Bucket *bucket_at(XtndblNHashTable *table, int64 address) {
+	return directory_get(&table->directory, address) ;
+}
+
+// gives a table its own copy of the bucket at address if it shares it with a
+// snapshot, so that the table can change it
+// returns the table's own bucket
+static Bucket *own_bucket(XtndblNHashTable *table, int64 address) {
+	Bucket *bucket = bucket_at(table, address) ;
+	if (bucket->refs == 1) {
+		return bucket ;
+	}
+
+	Bucket *copy = new_bucket(bucket->id, bucket->depth, table->bucketsize) ;
+	memcpy(copy->keys, bucket->keys, (sizeof *copy->keys) * bucket->nkeys) ;
+	copy->counts = copy_counts(bucket->counts, table->bucketsize,
+	  bucket->nkeys) ;
+	copy->nkeys = bucket->nkeys ;
+	bucket->refs-- ;
+
+	// the overflow pages are copied too, in the same order
+	Overflow **tail = &copy->overflow ;
+	Overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		*tail = new_overflow_page(table->bucketsize) ;
+		memcpy((*tail)->keys, page->keys, (sizeof *page->keys) * page->nkeys) ;
+		(*tail)->counts = copy_counts(page->counts, table->bucketsize,
+		  page->nkeys) ;
+		(*tail)->nkeys = page->nkeys ;
+		tail = &(*tail)->next ;
+	}
+
+	// point each of the bucket's addresses at the copy instead, which copies
+	// any segments of the table of pointers shared with the snapshot
+	int64 a ;
+	for (a=bucket->id; a<table->size; a+=(int64)1<<bucket->depth) {
+		directory_set(&table->directory, a, copy) ;
+	}
+	return copy ;
+}
+
 // doubles the table of bucket pointers, duplicating pointers from 1st
 //  half of table into 2nd
+// the 2nd half shares the 1st half's segments until either is changed, so
+// no pointers are copied here
 static void double_xn_table(XtndblNHashTable *table) {
 
-	int size = table->size * 2 ;
-	assert (size < MAX_TABLE_SIZE && "error: table has grown too large!") ;
+	clock_t start = clock() ;
+	int64 size = table->size * 2 ;
+	assert (within_memory_budget(table_bytes(table->bucketsize, size,
+	  table->stats.nbuckets)) && "error: table has grown too large!") ;
 
-	// create new array of double the number of bucket pointers
-	table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size) ;
-	assert (table->buckets) ;
-	// copy the pointers down the array
-	int i ;
-	for (i=0; i<table->size; i++) {
-		table->buckets[table->size + i] = table->buckets[i] ;
-	}
+	double_directory(&table->directory, table->size) ;
 
 	// increase recorded size & depth
 	table->size = size ;
 	table->depth++ ;
+
+	resize_log_add(&table->resizes, size, start) ;
 }
 
-// reinserts a key into an extendible hash table
+// reinserts a key, with its count, into an extendible hash table
 //  for use only when a bucket has been split & its keys removed
-static void reinsert_key(XtndblNHashTable *table, int64 key) {
-	int address = rightmostnbits(table->depth, h1(key)) ;
-	int b_nkeys = table->buckets[address]->nkeys ;
-
-	table->buckets[address]->keys[b_nkeys] = key ;
-	table->buckets[address]->nkeys++ ;
+static void reinsert_key(XtndblNHashTable *table, Key key, int64 count) {
+	int64 address = rightmostnbits(table->depth, h1(key)) ;
+	add_key(bucket_at(table, address), table->bucketsize, key, count) ;
 }
 
 // splits the bucket in an extendible table at address, grows table if necessary
-static void split_xn_bucket(XtndblNHashTable *table, int address) {
+static void split_xn_bucket(XtndblNHashTable *table, int64 address) {
+
+	// a bucket shared with a snapshot is copied before it is split
+	Bucket *o_bucket = own_bucket(table, address) ;
 
 	// check if table growth is needed
-	if (table->buckets[address]->depth == table->depth) {
+	if (o_bucket->depth == table->depth) {
 		double_xn_table(table) ;
 	}
 
 	/* create new bucket and update depths of both */
-	Bucket *o_bucket = table->buckets[address] ;
 	int depth = o_bucket->depth ;
-	int first_address = o_bucket->id ;
+	int64 first_address = o_bucket->id ;
 
 	int new_depth = depth + 1 ;
 	o_bucket->depth = new_depth ;
 
 	// new first address is 1 bit plus old first address
-	int new_first_address = 1 << depth | first_address ;
+	int64 new_first_address = (int64)1 << depth | first_address ;
 	Bucket *n_bucket = new_bucket(new_first_address, new_depth,
 	  table->bucketsize) ;
 	table->stats.nbuckets++ ;
+	table->stats.nsplits++ ;
 	/* ------------------------------------------- */
 
 	/* redirect every second address from old bucket to new bucket
 		using joining of prefix & suffix to construct address      */
 
 	// suffix is 1 bit followed by previous bucket bit address
-	int bit_address = rightmostnbits(depth, first_address) ;
-	int suffix = (1 << depth) | bit_address ;
+	int64 bit_address = rightmostnbits(depth, first_address) ;
+	int64 suffix = ((int64)1 << depth) | bit_address ;
 
 	// prefix is all bitstrings of length equal to the difference
 	//   between the new bucket depth & the table depth
-	int max_pref = 1 << (table->depth - new_depth) ;
-	int prefix ;
+	int64 max_pref = (int64)1 << (table->depth - new_depth) ;
+	int64 prefix ;
 
 	for (prefix=0; prefix<max_pref; prefix++) {
 		// construct each address by joining prefix & suffix
-		int a = (prefix << new_depth) | suffix ;
+		int64 a = (prefix << new_depth) | suffix ;
 		// redirect this address in table to point to new bucket
-		table->buckets[a] = n_bucket ;
+		directory_set(&table->directory, a, n_bucket) ;
 	}
 	/* ----------------------------------------------------------- */
 
-	/* reinsert keys from old bucket into table */
-	int64 key ;
+	/* reinsert keys from old bucket into table. a key reinserted into the
+	   old bucket goes no later than where it was, so is read before any key
+	   or count overwrites it */
+	Key key ;
 	int i ;
 	int b_nkeys = o_bucket->nkeys ;
 	o_bucket->nkeys = 0 ;
 	for (i=0; i<b_nkeys; i++) {
 		key = o_bucket->keys[i] ;
-		reinsert_key(table, key) ;
+		reinsert_key(table, key, count_at(o_bucket->counts, i)) ;
 	}
+
+	// then those from its overflow pages, which may need pages again
+	Overflow *overflow = o_bucket->overflow ;
+	o_bucket->overflow = NULL ;
+	Overflow *page ;
+	for (page=overflow; page; page=page->next) {
+		for (i=0; i<page->nkeys; i++) {
+			reinsert_key(table, page->keys[i],
+			  count_at(page->counts, i)) ;
+		}
+	}
+	free_overflow_pages(overflow) ;
 	/* ------------------------------------- */
 }
 
+// the expected fraction of each bucket's keys in use once a table has grown
+// by splitting (about ln 2), used to estimate the depth a table will reach
+#define EXPECTED_BUCKET_FILL 0.69
+
+// splits every bucket of an extendible table until all of them use depth
+// bits, first doubling the table of pointers until it is that deep
+static void grow_xn_table(XtndblNHashTable *table, int depth) {
+	while (table->depth < depth) {
+		double_xn_table(table) ;
+	}
+
+	// each address's bucket is split until it reaches the full depth; the
+	// new buckets this creates sit at later addresses and are reached later
+	int64 i ;
+	for (i=0; i<table->size; i++) {
+		while (bucket_at(table, i)->depth < depth) {
+			split_xn_bucket(table, i) ;
+		}
+	}
+}
+
+// adds a key known not to be in an extendible hash table, with the given
+// hash and count
+static void add_new_key(XtndblNHashTable *table, Key key, int64 hash,
+  int64 count) {
+	int64 address = rightmostnbits(table->depth, hash) ;
+
+	/* make space in table if bucket is full, unless splitting it wouldn't
+	   make space for this key, in which case it overflows instead */
+	while (bucket_at(table, address)->nkeys == table->bucketsize &&
+	  !needs_overflow(table, bucket_at(table, address), hash)) {
+		split_xn_bucket(table, address) ;
+		address = rightmostnbits(table->depth, hash) ;
+	}
+	/* ------------------------------------- */
+
+	/* insert key, into an overflow page if there is no space, copying a
+	   shared bucket first */
+	Bucket *bucket = own_bucket(table, address) ;
+	add_key(bucket, table->bucketsize, key, count) ;
+	table->stats.nkeys++ ;
+	/* ------------------------------ */
+}
+
+/* * * *
+ * bulk construction helpers
+ */
+
+// number of hash bits partitioned on in each radix pass, giving 2^RADIX_BITS
+// partitions per pass: few enough that every partition's output position
+// stays in cache
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+// groups of at most this many keys are finished off with in-place binary
+// partitioning instead of further radix passes, removing duplicates first
+#define SMALL_GROUP 64
+
+// a key to be placed by a bulk build, along with its hash
+typedef struct hashed_key {
+	int64 hash ;
+	Key key ;
+} HashedKey ;
+
+// the state of a bulk build: the buckets emitted so far and the deepest
+typedef struct builder {
+	Bucket **buckets ;  // emitted buckets, in no particular order
+	int64 nbuckets ;
+	int64 capacity ;
+	int depth ;         // greatest depth of any emitted bucket
+	int max_depth ;     // depth past which groups go in overflow pages
+	int64 nkeys ;       // number of distinct keys placed in buckets
+	int bucketsize ;
+	HashedKey *scratch ;// buffer for radix passes, as long as the input
+	int reversed[RADIX_SIZE] ; // each RADIX_BITS value with its bits reversed
+} Builder ;
+
+// creates a bucket holding the given (distinct) keys for a bulk build, with
+// any beyond bucketsize in overflow pages
+static void emit_bucket(Builder *builder, HashedKey *keys, int64 n,
+  int depth, int64 first_address) {
+	Bucket *bucket = new_bucket(first_address, depth, builder->bucketsize) ;
+	int64 i ;
+	for (i=0; i<n; i++) {
+		add_key(bucket, builder->bucketsize, keys[i].key, 0) ;
+	}
+	builder->nkeys += n ;
+
+	if (builder->nbuckets == builder->capacity) {
+		builder->capacity *= 2 ;
+		builder->buckets = realloc(builder->buckets,
+		  (sizeof *builder->buckets) * builder->capacity) ;
+		assert(builder->buckets) ;
+	}
+	builder->buckets[builder->nbuckets++] = bucket ;
+	if (depth > builder->depth) {
+		builder->depth = depth ;
+	}
+}
+
+// orders hashed keys by key, for removing duplicates with qsort
+static int compare_keys(const void *a, const void *b) {
+	Key x = ((const HashedKey *)a)->key ;
+	Key y = ((const HashedKey *)b)->key ;
+	return (x > y) - (x < y) ;
+}
+
+// checks whether every key of a group shares its lowest XTNDBLN_MAX_DEPTH
+// hash bits, so that no partitioning could separate them
+static bool shares_hash_bits(HashedKey *keys, int64 n) {
+	int64 i ;
+	for (i=1; i<n; i++) {
+		if ((rightmostnbits(XTNDBLN_MAX_DEPTH, keys[i].hash ^ keys[0].hash))) {
+			return false ;
+		}
+	}
+	return true ;
+}
+
+// removes duplicate keys from a group, returning its new length
+static int64 remove_duplicates(HashedKey *keys, int64 n) {
+	int64 i, j, m = 0 ;
+	if (n > SMALL_GROUP) {
+		// sort then drop repeats
+		qsort(keys, n, sizeof *keys, compare_keys) ;
+		for (i=0; i<n; i++) {
+			if (m == 0 || keys[m-1].key != keys[i].key) {
+				keys[m++] = keys[i] ;
+			}
+		}
+		return m ;
+	}
+
+	for (i=0; i<n; i++) {
+		for (j=0; j<m && keys[j].key != keys[i].key; j++) ;
+		if (j == m) {
+			keys[m++] = keys[i] ;
+		}
+	}
+	return m ;
+}
+
+// places a small group of keys sharing their lowest depth hash bits (equal
+// to those of first_address) into buckets, partitioning in place one bit at
+// a time. a group which partitioning can't split up further goes into one
+// bucket with overflow pages
+static void build_small(Builder *builder, HashedKey *keys, int64 n,
+  int depth, int64 first_address) {
+	n = remove_duplicates(keys, n) ;
+	if (n <= builder->bucketsize || depth == builder->max_depth ||
+	  shares_hash_bits(keys, n)) {
+		emit_bucket(builder, keys, n, depth, first_address) ;
+		return ;
+	}
+
+	// move keys with a 0 at this bit to the front
+	int64 i, m = 0 ;
+	for (i=0; i<n; i++) {
+		if (!((keys[i].hash >> depth) & 1)) {
+			HashedKey tmp = keys[m] ;
+			keys[m++] = keys[i] ;
+			keys[i] = tmp ;
+		}
+	}
+	build_small(builder, keys, m, depth+1, first_address) ;
+	build_small(builder, keys + m, n - m, depth+1,
+	  first_address | ((int64)1 << depth)) ;
+}
+
+static void build_group(Builder *builder, HashedKey *keys, int64 n,
+  int depth, int64 first_address) ;
+
+// places the keys of one node of the binary tree of hash bits within a radix
+// pass into buckets. the pass sorted keys by their next RADIX_BITS hash bits
+// reversed, so the node level bits below the pass's first bit, with value
+// bits, covers the contiguous range of reversed values from rstart, and its
+// keys are keys[offsets[rstart]] to keys[offsets[rstart + width]]
+static void build_node(Builder *builder, HashedKey *keys, int64 *offsets,
+  int depth, int64 first_address, int level, int64 bits, int rstart) {
+
+	int width = RADIX_SIZE >> level ;
+	HashedKey *start = keys + offsets[rstart] ;
+	int64 n = offsets[rstart + width] - offsets[rstart] ;
+	int64 address = first_address | (bits << depth) ;
+
+	if (n <= SMALL_GROUP || level == RADIX_BITS ||
+	  shares_hash_bits(start, n)) {
+		build_group(builder, start, n, depth + level, address) ;
+		return ;
+	}
+
+	// a 0 at the next bit sorts into the first half of the range
+	build_node(builder, keys, offsets, depth, first_address, level+1,
+	  bits, rstart) ;
+	build_node(builder, keys, offsets, depth, first_address, level+1,
+	  bits | ((int64)1 << level), rstart + width/2) ;
+}
+
+// places a group of keys sharing their lowest depth hash bits (equal to those
+// of first_address) into buckets, radix partitioning large groups by their
+// next RADIX_BITS hash bits
+static void build_group(Builder *builder, HashedKey *keys, int64 n,
+  int depth, int64 first_address) {
+
+	if (n <= SMALL_GROUP || depth + RADIX_BITS > builder->max_depth ||
+	  shares_hash_bits(keys, n)) {
+		build_small(builder, keys, n, depth, first_address) ;
+		return ;
+	}
+
+	/* counting sort into scratch by the next hash bits, reversed */
+	int64 offsets[RADIX_SIZE + 1] = { 0 } ;
+	int64 i ;
+	for (i=0; i<n; i++) {
+		int digit = (keys[i].hash >> depth) & (RADIX_SIZE - 1) ;
+		offsets[builder->reversed[digit] + 1]++ ;
+	}
+	for (i=0; i<RADIX_SIZE; i++) {
+		offsets[i+1] += offsets[i] ;
+	}
+
+	int64 next[RADIX_SIZE] ;
+	memcpy(next, offsets, sizeof next) ;
+	HashedKey *scratch = builder->scratch ;
+	for (i=0; i<n; i++) {
+		int digit = (keys[i].hash >> depth) & (RADIX_SIZE - 1) ;
+		scratch[next[builder->reversed[digit]]++] = keys[i] ;
+	}
+	memcpy(keys, scratch, (sizeof *keys) * n) ;
+	/* ---------------------------------------------------------- */
+
+	build_node(builder, keys, offsets, depth, first_address, 0, 0, 0) ;
+}
+
 /* * * *
  * main functions
  */
@@ -160,134 +664,452 @@ XtndblNHashTable *new_xtndbln_hash_table(int bucketsize) {
 	/* initialise internal table data */
 	table->bucketsize = bucketsize ;
 	table->size = 1 ;
-	table->buckets = malloc(sizeof *table->buckets) ;
-	assert(table->buckets) ;
-	table->buckets[0] = new_bucket(0, 0, bucketsize) ;
+	init_directory(&table->directory, 1) ;
+	directory_set(&table->directory, 0, new_bucket(0, 0, bucketsize)) ;
 	table->depth = 0 ;
+	table->readonly = false ;
 	/* ------------------------------ */
 
 	/* initialise table stats */
 	table->stats.nbuckets = 1 ;
 	table->stats.nkeys = 0 ;
+	table->stats.nsplits = 0 ;
 	table->stats.time = 0 ;
+	clear_resize_log(&table->resizes) ;
 	/* ---------------------- */
 
 	return table ;
 }
 
+// builds an extendible hash table with the given keys per bucket holding
+// the nkeys given keys (duplicates are stored once), by hashing them all once
+// and radix partitioning them on their low hash bits straight into buckets,
+// rather than inserting them one at a time
+XtndblNHashTable *new_xtndbln_hash_table_bulk(int bucketsize, const Key *keys,
+  int64 nkeys) {
+	clock_t start_time = clock() ;
+
+	/* hash every key once */
+	HashedKey *hashed = malloc((sizeof *hashed) * (nkeys + 1)) ;
+	assert(hashed) ;
+	int64 i ;
+	for (i=0; i<nkeys; i++) {
+		hashed[i].hash = h1(keys[i]) ;
+		hashed[i].key = keys[i] ;
+	}
+	/* ------------------- */
+
+	/* partition the keys into buckets */
+	Builder builder ;
+	builder.capacity = 16 ;
+	builder.buckets = malloc((sizeof *builder.buckets) * builder.capacity) ;
+	assert(builder.buckets) ;
+	builder.nbuckets = 0 ;
+	builder.depth = 0 ;
+	builder.nkeys = 0 ;
+	builder.bucketsize = bucketsize ;
+	// as with inserts, stop splitting where the table of pointers and the
+	// fewest buckets that could hold the keys would go over budget
+	builder.max_depth = 0 ;
+	while (builder.max_depth < XTNDBLN_MAX_DEPTH && within_memory_budget(
+	  table_bytes(bucketsize, (int64)2 << builder.max_depth,
+	  nkeys / bucketsize + 1))) {
+		builder.max_depth++ ;
+	}
+	builder.scratch = malloc((sizeof *builder.scratch) * (nkeys + 1)) ;
+	assert(builder.scratch) ;
+	for (i=0; i<RADIX_SIZE; i++) {
+		int b, r = 0 ;
+		for (b=0; b<RADIX_BITS; b++) {
+			r |= ((i >> b) & 1) << (RADIX_BITS - 1 - b) ;
+		}
+		builder.reversed[i] = r ;
+	}
+
+	build_group(&builder, hashed, nkeys, 0, 0) ;
+	free(builder.scratch) ;
+	free(hashed) ;
+	/* ------------------------------- */
+
+	/* point every address at its bucket */
+	int64 size = (int64)1 << builder.depth ;
+	XtndblNHashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->bucketsize = bucketsize ;
+	assert(within_memory_budget(table_bytes(table->bucketsize, size, builder.nbuckets))
+	  && "error: table has grown too large!") ;
+	table->size = size ;
+	table->depth = builder.depth ;
+	init_directory(&table->directory, size) ;
+	table->readonly = false ;
+
+	int64 b ;
+	for (b=0; b<builder.nbuckets; b++) {
+		Bucket *bucket = builder.buckets[b] ;
+		int64 a ;
+		for (a=bucket->id; a<size; a+=(int64)1<<bucket->depth) {
+			directory_set(&table->directory, a, bucket) ;
+		}
+	}
+	free(builder.buckets) ;
+	/* --------------------------------- */
+
+	table->stats.nbuckets = builder.nbuckets ;
+	table->stats.nkeys = builder.nkeys ;
+	table->stats.nsplits = 0 ;
+	table->stats.time = clock() - start_time ;
+	clear_resize_log(&table->resizes) ;
+	return table ;
+}
+
+// combines ntables extendible tables into one, where ntables is a power of
+// two and table t holds only keys whose hash values' low bits are t, by
+// bringing them to a common depth and taking each address's bucket from the
+// table owning its low bits. no key is moved or rehashed
+XtndblNHashTable *xtndbln_hash_table_merge(XtndblNHashTable **tables,
+  int ntables) {
+	assert(ntables > 0 && (ntables & (ntables - 1)) == 0) ;
+	clock_t start_time = clock() ;
+
+	int bits = 0 ;
+	while ((1 << bits) < ntables) {
+		bits++ ;
+	}
+	int mask = ntables - 1 ;
+
+	/* find the common depth, and free each table's buckets whose addresses
+	   are all owned by other tables, which can hold no keys */
+	int depth = bits ;
+	int64 nbuckets = 0 ;
+	int t ;
+	int64 i ;
+	for (t=0; t<ntables; t++) {
+		XtndblNHashTable *part = tables[t] ;
+		assert(part->bucketsize == tables[0]->bucketsize) ;
+		if (part->depth > depth) {
+			depth = part->depth ;
+		}
+
+		nbuckets += part->stats.nbuckets ;
+
+		// iterate backwards so each bucket is seen by its 1st reference last
+		for (i=part->size; i-- > 0; ) {
+			Bucket *bucket = bucket_at(part, i) ;
+			assert(bucket->refs == 1 &&
+			  "error: can't merge a table with snapshots!") ;
+			int common = bucket->depth < bits ? bucket->depth : bits ;
+			if (bucket->id == i &&
+			  (rightmostnbits(common, i)) != (rightmostnbits(common, t))) {
+				assert(bucket->nkeys == 0) ;
+				free_bucket(bucket) ;
+			}
+		}
+	}
+	/* ---------------------------------------------------------------- */
+
+	/* point every address at its bucket in the table owning it */
+	int64 size = (int64)1 << depth ;
+	XtndblNHashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+	table->bucketsize = tables[0]->bucketsize ;
+	assert(within_memory_budget(table_bytes(table->bucketsize, size, nbuckets)) &&
+	  "error: table has grown too large!") ;
+	table->size = size ;
+	table->depth = depth ;
+	init_directory(&table->directory, size) ;
+	table->readonly = false ;
+	table->stats.nbuckets = 0 ;
+
+	int64 a ;
+	for (a=0; a<size; a++) {
+		XtndblNHashTable *part = tables[a & mask] ;
+		Bucket *bucket = bucket_at(part, rightmostnbits(part->depth, a)) ;
+
+		// a bucket shallower than the partition bits now only has the
+		// addresses of its own table's partition
+		if (bucket->depth < bits) {
+			bucket->depth = bits ;
+		}
+		bucket->id = (rightmostnbits(bucket->depth, a)) ;
+		directory_set(&table->directory, a, bucket) ;
+		table->stats.nbuckets += bucket->id == a ;
+	}
+	/* ------------------------------------------------------- */
+
+	/* total up the tables' stats, and free what is left of them */
+	table->stats.nkeys = 0 ;
+	table->stats.nsplits = 0 ;
+	table->stats.time = 0 ;
+	for (t=0; t<ntables; t++) {
+		XtndblNHashTable *part = tables[t] ;
+		table->stats.nkeys += part->stats.nkeys ;
+		table->stats.nsplits += part->stats.nsplits ;
+		// CPU time is per process, so tables built at the same time each
+		// already count all of the others' time
+		if (part->stats.time > table->stats.time) {
+			table->stats.time = part->stats.time ;
+		}
+		free_directory(&part->directory) ;
+		free(part) ;
+	}
+	table->stats.time += clock() - start_time ;
+	clear_resize_log(&table->resizes) ;
+	/* -------------------------------------------------------- */
+
+	return table ;
+}
+
 // frees all memory associated with a given extendible hash table
 void free_xtndbln_hash_table(XtndblNHashTable *table) {
 	assert(table) ;
 
-	// iterate backwards freeing each bucket by their 1st reference
-	int i ;
-	for (i=table->size-1; i>=0; i--) {
-		if (table->buckets[i]->id == i) {
-			free(table->buckets[i]) ;
+	// iterate backwards releasing each bucket by their 1st reference, and
+	// freeing those no other table shares
+	int64 i ;
+	for (i=table->size; i-- > 0; ) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->id == i && --bucket->refs == 0) {
+			free_bucket(bucket) ;
 		}
 	}
 
-	// free the buckets array & the table
-	free(table->buckets) ;
+	// free the buckets array's segments, unless shared, & the table
+	free_directory(&table->directory) ;
 	free(table) ;
 }
 
+// takes a read-only snapshot of an extendible hash table, sharing its
+// buckets and array of pointers until the table next changes them
+XtndblNHashTable *xtndbln_hash_table_snapshot(XtndblNHashTable *table) {
+	assert(table) ;
+
+	XtndblNHashTable *snapshot = malloc(sizeof *snapshot) ;
+	assert(snapshot) ;
+	*snapshot = *table ;
+	snapshot->readonly = true ;
+	snapshot->stats.time = 0 ;
+	clear_resize_log(&snapshot->resizes) ;
+
+	// the snapshot shares every bucket, and the segments of the array of
+	// pointers
+	share_directory(&snapshot->directory, &table->directory) ;
+	int64 i ;
+	for (i=0; i<table->size; i++) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->id == i) {
+			bucket->refs++ ;
+		}
+	}
+
+	return snapshot ;
+}
+
+// grows an extendible hash table up front to the depth it would reach
+// holding expected_keys keys, so that loading them needs no doubling and
+// few splits
+void xtndbln_hash_table_reserve(XtndblNHashTable *table,
+  int64 expected_keys) {
+	assert(table) ;
+	assert(!table->readonly && "error: snapshots are read-only!") ;
+
+	// find the smallest depth whose buckets would hold the expected keys,
+	// short of one whose buckets would put the table over budget
+	int depth = 0 ;
+	while (depth < XTNDBLN_MAX_DEPTH && ((int64)1 << depth) *
+	  (double)table->bucketsize * EXPECTED_BUCKET_FILL < expected_keys &&
+	  within_memory_budget(table_bytes(table->bucketsize, (int64)2 << depth,
+	  (int64)2 << depth))) {
+		depth++ ;
+	}
+	grow_xn_table(table, depth) ;
+}
+
 // inserts a new key into an extendible hash table
-// returns true if successful, false if the key was already present
-bool xtndbln_hash_table_insert(XtndblNHashTable *table, int64 key) {
+// returns true if successful, false if the key was already present or the
+// table is a snapshot
+bool xtndbln_hash_table_insert(XtndblNHashTable *table, Key key) {
 	assert (table) ;
-	int start_time = clock() ;
+	if (table->readonly) {
+		return false ;
+	}
+	clock_t start_time = clock() ;
 	
 	// calculate the table address
-	int hash = h1(key) ;
-	int address = rightmostnbits(table->depth, hash) ;
+	int64 hash = h1(key) ;
+	int64 address = rightmostnbits(table->depth, hash) ;
 
 	/* check if key is already present */
-	int i ;
-	int b_nkeys = table->buckets[address]->nkeys ;
-
-	if (b_nkeys > 0) {
-		for (i=0; i<b_nkeys; i++) {
-			if (table->buckets[address]->keys[i] == key) {
-				table->stats.time += clock() - start_time ;
-				return false ;
-			}
-		}
+	if (bucket_contains(bucket_at(table, address), key)) {
+		table->stats.time += clock() - start_time ;
+		return false ;
 	}
 	/* ------------------------------- */
 
-	/* make space in table if bucket is full */
-	while (table->buckets[address]->nkeys == table->bucketsize) {
-		split_xn_bucket(table, address) ;
-		address = rightmostnbits(table->depth, hash) ;
+	add_new_key(table, key, hash, 0) ;
+
+	table->stats.time += clock() - start_time ;
+	return true ;
+}
+
+// adds delta to the count of a key in an extendible hash table, inserting it
+// with a count of delta if it isn't there
+// returns true if the key was inserted, and stores its new count in *count
+bool xtndbln_hash_table_increment(XtndblNHashTable *table, Key key,
+  int64 delta, int64 *count) {
+	assert (table) ;
+	assert(!table->readonly && "error: snapshots are read-only!") ;
+	clock_t start_time = clock() ;
+
+	// the key's bucket is copied first if it is shared with a snapshot, as
+	// either its count or its keys are about to change
+	int64 hash = h1(key) ;
+	Bucket *bucket = own_bucket(table, rightmostnbits(table->depth, hash)) ;
+	if (add_to_count(bucket, table->bucketsize, key, delta, count)) {
+		table->stats.time += clock() - start_time ;
+		return false ;
 	}
-	b_nkeys = table->buckets[address]->nkeys ;
-	/* ------------------------------------- */
 
-	/* space is available, insert key */
-	table->buckets[address]->keys[b_nkeys] = key ;
-	table->buckets[address]->nkeys++ ;
-	table->stats.nkeys++ ;
-	/* ------------------------------ */
+	add_new_key(table, key, hash, delta) ;
+	*count = delta ;
 
 	table->stats.time += clock() - start_time ;
 	return true ;
 }
 
+// the count of a key in an extendible hash table, or 0 if it isn't there
+int64 xtndbln_hash_table_count(XtndblNHashTable *table, Key key) {
+	assert(table) ;
+	return key_count(bucket_at(table, rightmostnbits(table->depth, h1(key))),
+	  key) ;
+}
+
 // looks up whether a key is inside an extendible hash table
 // returns true if found, false if not
-bool xtndbln_hash_table_lookup(XtndblNHashTable *table, int64 key) {
+bool xtndbln_hash_table_lookup(XtndblNHashTable *table, Key key) {
 	assert(table) ;
 
-	int start_time = clock() ;
+	clock_t start_time = clock() ;
 
 	/* calculate table address for this key and look through that bucket */
-	int address = rightmostnbits(table->depth, h1(key)) ;
+	int64 address = rightmostnbits(table->depth, h1(key)) ;
+	bool found = bucket_contains(bucket_at(table, address), key) ;
+	/* ----------------------------------------------------------------- */
+
+	table->stats.time += clock() - start_time ;
+	return found ;
+}
+
+// the cursor of an iteration holds an address (up to and including the
+// table's size) in its high bits and the position of a key in that address's
+// bucket (and overflow pages) in the rest, of which there are at least 23
+#define CURSOR_KEY_BITS (63 - XTNDBLN_MAX_DEPTH)
+
+// steps through the keys of an extendible hash table, one per call
+// the cursor counts through the keys of each bucket in turn, visiting each
+// bucket from the first address pointing to it
+bool xtndbln_hash_table_next(XtndblNHashTable *table, int64 *cursor,
+  Key *key) {
+	assert(table) ;
 
-	if (table->buckets[address]->nkeys > 0) {
+	int64 address = *cursor >> CURSOR_KEY_BITS ;
+	int64 i = rightmostnbits(CURSOR_KEY_BITS, *cursor) ;
+	while (address < table->size) {
+		Bucket *bucket = bucket_at(table, address) ;
+		if (bucket->id == address && nth_key(bucket, i, key)) {
+			*cursor = (address << CURSOR_KEY_BITS) + i + 1 ;
+			return true ;
+		}
+		address++ ;
+		i = 0 ;
+	}
+
+	*cursor = address << CURSOR_KEY_BITS ;
+	return false ;
+}
+
+// dumps the buckets of an extendible hash table whose first addresses are in
+// the dump's range, each visited once at its first address
+void xtndbln_hash_table_dump(XtndblNHashTable *table, Dump *dump) {
+	assert(table) ;
+	bool directory = dump_options(dump).directory ;
+
+	int64 first, last, address ;
+	dump_range(dump, table->size, &first, &last) ;
+	dump_section(dump, directory ? "directory" : "buckets") ;
+	for (address=first; address<last; address++) {
+		Bucket *bucket = bucket_at(table, address) ;
+		if (bucket->id != address) {
+			continue ;
+		}
+
+		if (directory) {
+			dump_bucket(dump, 1, address, bucket->depth,
+			  (int64)1 << (table->depth - bucket->depth), count_keys(bucket)) ;
+			continue ;
+		}
 		int i ;
 		for (i=0; i<table->bucketsize; i++) {
-			if (table->buckets[address]->keys[i] == key) {
-				table->stats.time += clock() - start_time ;
-				return true ;
+			dump_slot(dump, address, i, i < bucket->nkeys,
+			  i < bucket->nkeys ? bucket->keys[i] : 0) ;
+		}
+
+		// overflow pages' slots follow on from the bucket's
+		int64 slot = table->bucketsize ;
+		Overflow *page ;
+		for (page=bucket->overflow; page; page=page->next) {
+			for (i=0; i<table->bucketsize; i++) {
+				dump_slot(dump, address, slot++, i < page->nkeys,
+				  i < page->nkeys ? page->keys[i] : 0) ;
 			}
 		}
 	}
-	/* ----------------------------------------------------------------- */
-
-	table->stats.time += clock() - start_time ;
-	return false ;
 }
 
 // prints the contents of an extendible hash table to stdout
 void xtndbln_hash_table_print(XtndblNHashTable *table) {
 	assert(table) ;
-	printf("--- table size: %d\n", table->size) ;
+	printf("--- table size: %llu\n", table->size) ;
 
 	// print header
 	printf("  table:               buckets:\n") ;
 	printf("  address | bucketid   bucketid [key]\n") ;
 	
 	// print table and buckets
-	int i ;
+	char keystr[KEY_STR_LEN] ;
+	int64 i ;
 	for (i = 0; i < table->size; i++) {
 		// table entry
-		printf("%9d | %-9d ", i, table->buckets[i]->id) ;
+		Bucket *bucket = bucket_at(table, i) ;
+		printf("%9llu | %-9llu ", i, bucket->id) ;
 
 		// if this is the first address at which a bucket occurs, print it now
-		if (table->buckets[i]->id == i) {
-			printf("%9d ", table->buckets[i]->id) ;
+		if (bucket->id == i) {
+			printf("%9llu ", bucket->id) ;
 
 			// print the bucket's contents
 			printf("[") ;
 			for(int j = 0; j < table->bucketsize; j++) {
-				if (j < table->buckets[i]->nkeys) {
-					printf(" %llu", table->buckets[i]->keys[j]) ;
+				if (j < bucket->nkeys) {
+					printf(" %s", keytostr(bucket->keys[j], keystr)) ;
 				} else {
 					printf(" -") ;
 				}
 			}
 			printf(" ]") ;
+
+			// followed by any overflow pages
+			Overflow *page ;
+			for (page=bucket->overflow; page; page=page->next) {
+				printf(" + [") ;
+				for (int j = 0; j < table->bucketsize; j++) {
+					if (j < page->nkeys) {
+						printf(" %s", keytostr(page->keys[j], keystr)) ;
+					} else {
+						printf(" -") ;
+					}
+				}
+				printf(" ]") ;
+			}
 		}
 		printf("\n") ;
 	}
@@ -302,16 +1124,81 @@ void xtndbln_hash_table_stats(XtndblNHashTable *table) {
 	printf("\n----- table stats -----\n") ;
 
 	// print table info
-	printf("current table size:\t%d\n", table->size) ;
-	printf("number of keys    :\t%d\n", table->stats.nkeys) ;
-	printf("number of buckets :\t%d\n\n", table->stats.nbuckets) ;
+	printf("current table size:\t%llu\n", table->size) ;
+	printf("number of keys    :\t%llu\n", table->stats.nkeys) ;
+	printf("number of buckets :\t%llu\n\n", table->stats.nbuckets) ;
 	printf("space usage factor:\t%.3f%%\n", table->stats.nkeys * 100.0 /
 	  (table->size * table->bucketsize)) ;
 	printf("bucket size       :\t%d\n", table->bucketsize) ;
 
+	// count overflow pages and the buckets they hang off
+	int64 noverflowing = 0, npages = 0 ;
+	int longest = 0 ;
+	int64 i ;
+	for (i=0; i<table->size; i++) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->id == i && bucket->overflow) {
+			int length = chain_length(bucket) ;
+			noverflowing++ ;
+			npages += length ;
+			if (length > longest) {
+				longest = length ;
+			}
+		}
+	}
+	printf("overflow pages    :\t%llu (%llu buckets, longest chain %d)\n",
+	  npages, noverflowing, longest) ;
+
 	// calculate print time details
 	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC ;
 	printf("CPU time spent    :\t%.6f sec\n", seconds) ;
 	
 	printf("   --- end stats ---\n") ;
 }
+
+// writes metrics about an extendible hash table to out as a JSON object
+void xtndbln_hash_table_metrics(XtndblNHashTable *table, FILE *out) {
+	assert(table) ;
+
+	// count buckets by their depth and by their number of keys
+	int64 *depths = calloc(table->depth + 1, sizeof *depths) ;
+	assert(depths) ;
+	int64 *occupancy = calloc(table->bucketsize + 1, sizeof *occupancy) ;
+	assert(occupancy) ;
+	// and overflow chains by their length in pages
+	Log2Histogram chains ;
+	clear_log2_histogram(&chains) ;
+	int64 npages = 0 ;
+	int64 i ;
+	for (i=0; i<table->size; i++) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->id == i) {
+			depths[bucket->depth]++ ;
+			occupancy[bucket->nkeys]++ ;
+			int length = chain_length(bucket) ;
+			log2_histogram_add(&chains, length) ;
+			npages += length ;
+		}
+	}
+
+	fprintf(out, "{\"size\":%llu,\"depth\":%d,\"bucketsize\":%d,"
+	  "\"nbuckets\":%llu,\"nkeys\":%llu,\"nsplits\":%llu,"
+	  "\"load_factor\":%.4f,\"cpu_secs\":%.6f,", table->size,
+	  table->depth, table->bucketsize, table->stats.nbuckets,
+	  table->stats.nkeys, table->stats.nsplits, table->stats.nkeys * 1.0 /
+	  (table->stats.nbuckets * table->bucketsize),
+	  table->stats.time * 1.0 / CLOCKS_PER_SEC) ;
+
+	fprintf(out, "\"local_depths\":") ;
+	counts_json(depths, table->depth + 1, out) ;
+	fprintf(out, ",\"bucket_occupancy\":") ;
+	counts_json(occupancy, table->bucketsize + 1, out) ;
+	fprintf(out, ",\"overflow_pages\":%llu,\"overflow_chains\":", npages) ;
+	log2_histogram_json(&chains, out) ;
+	fprintf(out, ",\"resizes\":") ;
+	resize_log_json(&table->resizes, out) ;
+	fprintf(out, "}") ;
+
+	free(depths) ;
+	free(occupancy) ;
+}
@@ -8,29 +8,110 @@
 #ifndef XTNDBLN_H
 #define XTNDBLN_H
 
+#include   <stdio.h>
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../dump.h"
+
+// the greatest depth a bucket may be split to. once a bucket is full, keys
+// sharing all of its keys' lowest XTNDBLN_MAX_DEPTH hash bits (which no split
+// could separate), or any keys at all if it is already this deep, go in a
+// chain of overflow pages from the bucket instead, so that a cluster of keys
+// can't double the table of pointers without bound. the table of pointers
+// has at most 2^XTNDBLN_MAX_DEPTH entries (8 bytes each), and keys also go in
+// overflow pages once doubling it would put the table over the memory budget
+// (see budget.h). set with -DXTNDBLN_MAX_DEPTH (MAXDEPTH in the Makefile)
+#ifndef XTNDBLN_MAX_DEPTH
+#define XTNDBLN_MAX_DEPTH 24
+#endif
+
+#if XTNDBLN_MAX_DEPTH < 0 || XTNDBLN_MAX_DEPTH > 40
+#error "XTNDBLN_MAX_DEPTH must be from 0 to 40"
+#endif
 
 typedef struct xtndbln_table XtndblNHashTable ;
 
 // initialises an extendible hash table with the given keys per bucket
 XtndblNHashTable *new_xtndbln_hash_table(int bucketsize) ;
 
+// builds an extendible hash table with the given keys per bucket holding
+// the nkeys given keys (duplicates are stored once), by hashing them all once
+// and radix partitioning them on their low hash bits straight into buckets,
+// rather than inserting them one at a time
+XtndblNHashTable *new_xtndbln_hash_table_bulk(int bucketsize, const Key *keys,
+  int64 nkeys) ;
+
+// combines ntables extendible tables into one, where ntables is a power of
+// two and table t holds only keys whose hash values (from h1) have t as
+// their low bits, as when each was built from one hash partition of a set of
+// keys. the tables' buckets are stitched into one table of pointers at their
+// greatest depth, so no key is moved or rehashed.
+// frees the given tables, which must have no snapshots
+XtndblNHashTable *xtndbln_hash_table_merge(XtndblNHashTable **tables,
+  int ntables) ;
+
+// takes a read-only snapshot of an extendible hash table: a view of its keys
+// as they are now, which later changes to the table don't affect. the
+// snapshot shares the table's buckets and the segments of its array of
+// pointers, and the table copies each of them only when it first changes it
+// after the snapshot. taking a snapshot visits each bucket once but copies
+// no keys.
+// free the snapshot with free_xtndbln_hash_table
+XtndblNHashTable *xtndbln_hash_table_snapshot(XtndblNHashTable *table) ;
+
 // frees all memory associated with a given extendible hash table
 void free_xtndbln_hash_table(XtndblNHashTable *table) ;
 
+// grows an extendible hash table up front to the depth it would reach
+// holding expected_keys keys, so that loading them needs no doubling and
+// few splits
+void xtndbln_hash_table_reserve(XtndblNHashTable *table,
+  int64 expected_keys) ;
+
 // inserts a new key into an extendible hash table
-// returns true if successful, false if the key was already present
-bool xtndbln_hash_table_insert(XtndblNHashTable *table, int64 key) ;
+// returns true if successful, false if the key was already present or the
+// table is a snapshot, which is read-only
+bool xtndbln_hash_table_insert(XtndblNHashTable *table, Key key) ;
 
 // looks up whether a key is inside an extendible hash table
 // returns true if found, false if not
-bool xtndbln_hash_table_lookup(XtndblNHashTable *table, int64 key) ;
+bool xtndbln_hash_table_lookup(XtndblNHashTable *table, Key key) ;
+
+// adds delta to the count of a key in an extendible hash table, inserting it
+// with a count of delta if it isn't there. a key inserted without a count
+// has a count of 0
+// returns true if the key was inserted, and stores its new count in *count
+bool xtndbln_hash_table_increment(XtndblNHashTable *table, Key key,
+  int64 delta, int64 *count) ;
+
+// the count of a key in an extendible hash table, or 0 if it isn't there
+// counts can be read from snapshots too
+int64 xtndbln_hash_table_count(XtndblNHashTable *table, Key key) ;
+
+// steps through the keys of an extendible hash table, one per call: set
+// *cursor to 0 to start from the first key, then pass it back unchanged for
+// each next key. the table must not be changed between calls
+// returns true and stores the next key in *key, or false once all are seen
+bool xtndbln_hash_table_next(XtndblNHashTable *table, int64 *cursor,
+  Key *key) ;
 
 // prints the contents of an extendible hash table to stdout
 void xtndbln_hash_table_print(XtndblNHashTable *table) ;
 
+// dumps the buckets of an extendible hash table whose first addresses are in
+// the dump's range: the slots of each followed by those of its overflow
+// pages, or for a directory dump, a summary of each with the number of
+// pointers to it
+void xtndbln_hash_table_dump(XtndblNHashTable *table, Dump *dump) ;
+
 // prints statistics about an extendible hash table to stdout
 void xtndbln_hash_table_stats(XtndblNHashTable *table) ;
 
+// writes metrics about an extendible hash table to out as a JSON object:
+// sizes, the distributions of bucket depths (indexed by depth) and of bucket
+// occupancy (indexed by number of keys), a histogram of buckets' overflow
+// chain lengths in pages, and a log of each time the table of pointers
+// doubled
+void xtndbln_hash_table_metrics(XtndblNHashTable *table, FILE *out) ;
+
 #endif
\ No newline at end of file
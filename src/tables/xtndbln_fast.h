@@ -0,0 +1,122 @@
+/* * * * * * * * *
+ * Header-inline fast paths for extendible hash tables, for tight loops over a
+ * table whose type is known at compile time. also defines the table layout
+ * shared with xtndbln.c
+ *
+ * the fast paths skip the argument checks and CPU time accounting done by
+ * xtndbln_hash_table_insert and xtndbln_hash_table_lookup
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef XTNDBLN_FAST_H
+#define XTNDBLN_FAST_H
+
+#include "xtndbln.h"
+#include "../metrics.h"
+#include "../directory.h"
+
+// an overflow page holds up to bucketsize more keys for a full bucket whose
+// keys a split would not separate, in a chain hanging off the bucket
+struct xtndbln_overflow {
+	int nkeys ;     // number of keys currently contained in this page
+	Key *keys ;     // the keys stored in this page
+	int64 *counts ; // the count of each key, or NULL while all are 0
+	struct xtndbln_overflow *next ; // the next page in the chain, or NULL
+} ;
+
+// a bucket stores an array of keys
+// it also knows how many bits are shared between possible keys, and the first 
+// table address that references it
+struct xtndbln_bucket {
+	int64 id ;      // a unique id for this bucket, equal to the first address
+                    // in the table which points to it
+	int depth ;     // number of hash value bits being used by this bucket
+	int nkeys ;     // number of keys currently contained in this bucket
+	int refs ;      // number of tables sharing this bucket: a live table
+                    // and any snapshots of it taken before it changed
+	Key *keys ;     // the keys stored in this bucket
+	int64 *counts ; // the count of each key, or NULL while all are 0. may
+                    // hold stale counts past nkeys, after a split
+	struct xtndbln_overflow *overflow ; // pages of keys beyond bucketsize,
+                    // newest first, or NULL. only ever used by a full bucket
+} ;
+
+struct xtndbln_stats {
+	int64 nbuckets ; // number of distinct buckets does the table point to
+	int64 nkeys ;   // number of keys being stored in the table
+	int64 nsplits ; // number of buckets split
+	int64 time ;    // CPU time elapsed to insert/lookup keys in this table
+} ;
+
+// a hash table is an array of slots pointing to buckets holding up to 
+// bucketsize keys, along with some information about the number of hash value 
+// bits to use for addressing
+struct xtndbln_table {
+	Directory directory ; // table of pointers to buckets, whose segments
+                        // may be shared with snapshots
+	int64 size ;        // number of entries in the table of pointers (2^depth)
+	int depth ;         // how many bits of the hash value to use (log2(size))
+	int bucketsize ;    // maximum number of keys per bucket
+	bool readonly ;     // is this table a snapshot?
+	struct xtndbln_stats stats ;
+	ResizeLog resizes ; // each time the table of pointers doubled
+} ;
+
+// looks up whether a key is inside an extendible hash table
+// returns true if found, false if not
+static inline bool xtndbln_hash_table_lookup_fast(XtndblNHashTable *table,
+  Key key) {
+	struct xtndbln_bucket *bucket = directory_get(&table->directory,
+	  rightmostnbits(table->depth, h1(key))) ;
+
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			return true ;
+		}
+	}
+
+	struct xtndbln_overflow *page ;
+	for (page=bucket->overflow; page; page=page->next) {
+		for (i=0; i<page->nkeys; i++) {
+			if (page->keys[i] == key) {
+				return true ;
+			}
+		}
+	}
+	return false ;
+}
+
+// inserts a new key into an extendible hash table
+// returns true if successful, false if the key was already present or the
+// table is a snapshot
+// only the common case of an unshared bucket with space is handled inline,
+// anything needing a split, an overflow page or a copy (or refusing a
+// snapshot) goes through xtndbln_hash_table_insert. a bucket with space has
+// no overflow pages, so its own keys are the only ones to check
+static inline bool xtndbln_hash_table_insert_fast(XtndblNHashTable *table,
+  Key key) {
+	struct xtndbln_bucket *bucket = directory_get(&table->directory,
+	  rightmostnbits(table->depth, h1(key))) ;
+
+	if (bucket->nkeys == table->bucketsize || bucket->refs > 1
+	  || table->readonly) {
+		return xtndbln_hash_table_insert(table, key) ;
+	}
+
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			return false ;
+		}
+	}
+	if (bucket->counts) {
+		bucket->counts[bucket->nkeys] = 0 ;
+	}
+	bucket->keys[bucket->nkeys++] = key ;
+	table->stats.nkeys++ ;
+	return true ;
+}
+
+#endif
@@ -0,0 +1,497 @@
+/* * * * * * * * *
+ * Dynamic hash table of variable-length string keys using extendible hashing
+ * with multiple keys per bucket. key bytes live in a per-table append-only
+ * arena, while buckets hold each key's hash, length and an inline prefix
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#include  <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include   <time.h>
+
+#include "xtndbls.h"
+#include "../strhash.h"
+#include "../metrics.h"
+#include "../budget.h"
+
+// number of leading key bytes stored inline in each bucket entry. keys no
+// longer than this are stored entirely inline and never touch the arena
+#define PREFIX_LEN 12
+
+// initial capacity of the key arena, in bytes
+#define INITIAL_ARENA_SIZE 4096
+
+// the deepest the table of pointers may grow, as its addresses are ints
+#define XTNDBLS_MAX_DEPTH 30
+
+// an entry describes one key stored in a bucket
+// comparing hash, length and prefix rejects almost every mismatch without
+// reading the arena
+typedef struct xtndbls_entry {
+	int64 hash ;              // full 64-bit hash of the key
+	int64 offset ;            // where the key's bytes start in the arena
+	uint32_t len ;            // length of the key in bytes
+	char prefix[PREFIX_LEN] ; // first bytes of the key, zero padded
+} Entry ;
+
+// a bucket stores an array of key entries
+// it also knows how many bits are shared between possible keys, and the first
+// table address that references it
+typedef struct xtndbls_bucket {
+	int id ;        // a unique id for this bucket, equal to the first address
+                    // in the table which points to it
+	int depth ;     // number of hash value bits being used by this bucket
+	int nkeys ;     // number of keys currently contained in this bucket
+	Entry *keys ;   // the key entries stored in this bucket
+} Bucket ;
+
+// an arena is an append-only byte buffer holding the bytes of long keys
+typedef struct arena {
+	char *bytes ;   // the stored key bytes
+	int64 used ;    // number of bytes in use
+	int64 size ;    // number of bytes allocated
+} Arena ;
+
+typedef struct stats {
+	int nbuckets ;      // number of distinct buckets does the table point to
+	int nkeys ;         // number of keys being stored in the table
+	int64 ncompares ;   // number of key comparisons against bucket entries
+	int64 narena ;      // number of comparisons that had to read the arena
+	int time ;          // CPU time elapsed to insert/lookup keys in this table
+} Stats ;
+
+// a hash table is an array of slots pointing to buckets holding up to
+// bucketsize keys, along with the arena of key bytes and some information
+// about the number of hash value bits to use for addressing
+struct xtndbls_table {
+	Bucket **buckets ;  // array of pointers to buckets
+	int size ;          // number of entries in the table of pointers (2^depth)
+	int depth ;         // how many bits of the hash value to use (log2(size))
+	int bucketsize ;    // maximum number of keys per bucket
+	Arena arena ;       // storage for the bytes of long keys
+	Stats stats ;
+	ResizeLog resizes ; // each time the table of pointers doubled
+} ;
+
+/* * * *
+ * helper functions
+ */
+
+// creates a new empty bucket with first_address as its id
+static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
+	Bucket *bucket = malloc(sizeof *bucket) ;
+	assert(bucket) ;
+
+	bucket->id = first_address ;
+	bucket->depth = depth ;
+	bucket->nkeys = 0 ;
+
+	bucket->keys = malloc((sizeof *bucket->keys) * bucketsize) ;
+	assert(bucket->keys) ;
+
+	return bucket ;
+}
+
+// appends len bytes to the arena, growing it if necessary
+// returns the offset at which the bytes were stored
+static int64 arena_append(Arena *arena, const char *bytes, int len) {
+	if (arena->used + len > arena->size) {
+		while (arena->used + len > arena->size) {
+			arena->size *= 2 ;
+		}
+		arena->bytes = realloc(arena->bytes, arena->size) ;
+		assert(arena->bytes) ;
+	}
+
+	int64 offset = arena->used ;
+	memcpy(arena->bytes + offset, bytes, len) ;
+	arena->used += len ;
+	return offset ;
+}
+
+// fills in an entry describing the key of len bytes with the given hash
+// the key's bytes are only copied to the arena if they don't fit inline
+static void make_entry(XtndblSHashTable *table, Entry *entry, const char *key,
+  int len, int64 hash) {
+	entry->hash = hash ;
+	entry->len = len ;
+	memset(entry->prefix, 0, PREFIX_LEN) ;
+	memcpy(entry->prefix, key, len < PREFIX_LEN ? len : PREFIX_LEN) ;
+
+	if (len > PREFIX_LEN) {
+		entry->offset = arena_append(&table->arena, key, len) ;
+	} else {
+		entry->offset = 0 ;
+	}
+}
+
+// checks whether an entry holds the key of len bytes with the given hash
+static bool entry_matches(XtndblSHashTable *table, Entry *entry,
+  const char *key, int len, int64 hash) {
+	table->stats.ncompares++ ;
+
+	// reject on hash, length or prefix before looking at the arena
+	if (entry->hash != hash || entry->len != len) {
+		return false ;
+	}
+	if (memcmp(entry->prefix, key, len < PREFIX_LEN ? len : PREFIX_LEN) != 0) {
+		return false ;
+	}
+	if (len <= PREFIX_LEN) {
+		return true ;
+	}
+
+	table->stats.narena++ ;
+	return memcmp(table->arena.bytes + entry->offset, key, len) == 0 ;
+}
+
+// doubles the table of bucket pointers, duplicating pointers from 1st
+//  half of table into 2nd
+static void double_xs_table(XtndblSHashTable *table) {
+
+	clock_t start = clock() ;
+	int size = table->size * 2 ;
+	assert (table->depth < XTNDBLS_MAX_DEPTH &&
+	  within_memory_budget((int64)size * sizeof *table->buckets) &&
+	  "error: table has grown too large!") ;
+
+	// create new array of double the number of bucket pointers
+	table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size) ;
+	assert (table->buckets) ;
+	// copy the pointers down the array
+	int i ;
+	for (i=0; i<table->size; i++) {
+		table->buckets[table->size + i] = table->buckets[i] ;
+	}
+
+	// increase recorded size & depth
+	table->size = size ;
+	table->depth++ ;
+
+	resize_log_add(&table->resizes, size, start) ;
+}
+
+// splits the bucket in an extendible table at address, grows table if necessary
+// entries are redistributed by their stored hash, so no key is rehashed
+static void split_xs_bucket(XtndblSHashTable *table, int address) {
+
+	// check if table growth is needed
+	if (table->buckets[address]->depth == table->depth) {
+		double_xs_table(table) ;
+	}
+
+	/* create new bucket and update depths of both */
+	Bucket *o_bucket = table->buckets[address] ;
+	int depth = o_bucket->depth ;
+	int first_address = o_bucket->id ;
+
+	int new_depth = depth + 1 ;
+	o_bucket->depth = new_depth ;
+
+	// new first address is 1 bit plus old first address
+	int new_first_address = 1 << depth | first_address ;
+	Bucket *n_bucket = new_bucket(new_first_address, new_depth,
+	  table->bucketsize) ;
+	table->stats.nbuckets++ ;
+	/* ------------------------------------------- */
+
+	/* redirect every second address from old bucket to new bucket
+		using joining of prefix & suffix to construct address      */
+
+	// suffix is 1 bit followed by previous bucket bit address
+	int bit_address = rightmostnbits(depth, first_address) ;
+	int suffix = (1 << depth) | bit_address ;
+
+	// prefix is all bitstrings of length equal to the difference
+	//   between the new bucket depth & the table depth
+	int max_pref = 1 << (table->depth - new_depth) ;
+	int prefix ;
+
+	for (prefix=0; prefix<max_pref; prefix++) {
+		// construct each address by joining prefix & suffix
+		int a = (prefix << new_depth) | suffix ;
+		// redirect this address in table to point to new bucket
+		table->buckets[a] = n_bucket ;
+	}
+	/* ----------------------------------------------------------- */
+
+	/* move entries whose new hash bit is set into the new bucket */
+	int i ;
+	int b_nkeys = o_bucket->nkeys ;
+	o_bucket->nkeys = 0 ;
+	for (i=0; i<b_nkeys; i++) {
+		Entry entry = o_bucket->keys[i] ;
+		if ((entry.hash >> depth) & 1) {
+			n_bucket->keys[n_bucket->nkeys++] = entry ;
+		} else {
+			o_bucket->keys[o_bucket->nkeys++] = entry ;
+		}
+	}
+	/* ---------------------------------------------------------- */
+}
+
+// the expected fraction of each bucket's keys in use once a table has grown
+// by splitting (about ln 2), used to estimate the depth a table will reach
+#define EXPECTED_BUCKET_FILL 0.69
+
+// splits every bucket of an extendible table until all of them use depth
+// bits, first doubling the table of pointers until it is that deep
+static void grow_xs_table(XtndblSHashTable *table, int depth) {
+	while (table->depth < depth) {
+		double_xs_table(table) ;
+	}
+
+	// each address's bucket is split until it reaches the full depth; the
+	// new buckets this creates sit at later addresses and are reached later
+	int i ;
+	for (i=0; i<table->size; i++) {
+		while (table->buckets[i]->depth < depth) {
+			split_xs_bucket(table, i) ;
+		}
+	}
+}
+
+/* * * *
+ * main functions
+ */
+
+// initialises an extendible string hash table with the given keys per bucket
+XtndblSHashTable *new_xtndbls_hash_table(int bucketsize) {
+	XtndblSHashTable *table = malloc(sizeof *table) ;
+	assert(table) ;
+
+	/* initialise internal table data */
+	table->bucketsize = bucketsize ;
+	table->size = 1 ;
+	table->buckets = malloc(sizeof *table->buckets) ;
+	assert(table->buckets) ;
+	table->buckets[0] = new_bucket(0, 0, bucketsize) ;
+	table->depth = 0 ;
+	/* ------------------------------ */
+
+	/* initialise key arena */
+	table->arena.size = INITIAL_ARENA_SIZE ;
+	table->arena.used = 0 ;
+	table->arena.bytes = malloc(table->arena.size) ;
+	assert(table->arena.bytes) ;
+	/* -------------------- */
+
+	/* initialise table stats */
+	table->stats.nbuckets = 1 ;
+	table->stats.nkeys = 0 ;
+	table->stats.ncompares = 0 ;
+	table->stats.narena = 0 ;
+	table->stats.time = 0 ;
+	clear_resize_log(&table->resizes) ;
+	/* ---------------------- */
+
+	return table ;
+}
+
+// frees all memory associated with a given extendible string hash table
+void free_xtndbls_hash_table(XtndblSHashTable *table) {
+	assert(table) ;
+
+	// iterate backwards freeing each bucket by their 1st reference
+	int i ;
+	for (i=table->size-1; i>=0; i--) {
+		if (table->buckets[i]->id == i) {
+			free(table->buckets[i]->keys) ;
+			free(table->buckets[i]) ;
+		}
+	}
+
+	// free the arena, the buckets array & the table
+	free(table->arena.bytes) ;
+	free(table->buckets) ;
+	free(table) ;
+}
+
+// grows an extendible string hash table up front to the depth it would
+// reach holding expected_keys keys, so that loading them needs no doubling
+// and few splits
+void xtndbls_hash_table_reserve(XtndblSHashTable *table,
+  int64 expected_keys) {
+	assert(table) ;
+
+	// find the smallest depth whose buckets would hold the expected keys
+	int depth = 0 ;
+	while (depth < XTNDBLS_MAX_DEPTH
+	  && within_memory_budget(((int64)2 << depth) * sizeof *table->buckets)
+	  && (1 << depth) *
+	  (double)table->bucketsize * EXPECTED_BUCKET_FILL < expected_keys) {
+		depth++ ;
+	}
+	grow_xs_table(table, depth) ;
+}
+
+// inserts a new key of len bytes into an extendible string hash table
+// returns true if successful, false if the key was already present
+bool xtndbls_hash_table_insert(XtndblSHashTable *table, const char *key,
+  int len) {
+	assert (table) ;
+	int start_time = clock() ;
+
+	// calculate the table address
+	int64 hash = strhash(key, len) ;
+	int address = rightmostnbits(table->depth, hash) ;
+
+	/* check if key is already present */
+	int i ;
+	Bucket *bucket = table->buckets[address] ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (entry_matches(table, &bucket->keys[i], key, len, hash)) {
+			table->stats.time += clock() - start_time ;
+			return false ;
+		}
+	}
+	/* ------------------------------- */
+
+	/* make space in table if bucket is full */
+	while (table->buckets[address]->nkeys == table->bucketsize) {
+		split_xs_bucket(table, address) ;
+		address = rightmostnbits(table->depth, hash) ;
+	}
+	bucket = table->buckets[address] ;
+	/* ------------------------------------- */
+
+	/* space is available, insert key */
+	make_entry(table, &bucket->keys[bucket->nkeys], key, len, hash) ;
+	bucket->nkeys++ ;
+	table->stats.nkeys++ ;
+	/* ------------------------------ */
+
+	table->stats.time += clock() - start_time ;
+	return true ;
+}
+
+// looks up whether a key of len bytes is inside an extendible string table
+// returns true if found, false if not
+bool xtndbls_hash_table_lookup(XtndblSHashTable *table, const char *key,
+  int len) {
+	assert(table) ;
+
+	int start_time = clock() ;
+
+	/* calculate table address for this key and look through that bucket */
+	int64 hash = strhash(key, len) ;
+	int address = rightmostnbits(table->depth, hash) ;
+
+	Bucket *bucket = table->buckets[address] ;
+	int i ;
+	for (i=0; i<bucket->nkeys; i++) {
+		if (entry_matches(table, &bucket->keys[i], key, len, hash)) {
+			table->stats.time += clock() - start_time ;
+			return true ;
+		}
+	}
+	/* ----------------------------------------------------------------- */
+
+	table->stats.time += clock() - start_time ;
+	return false ;
+}
+
+// prints the contents of an extendible string hash table to stdout
+void xtndbls_hash_table_print(XtndblSHashTable *table) {
+	assert(table) ;
+	printf("--- table size: %d\n", table->size) ;
+
+	// print header
+	printf("  table:               buckets:\n") ;
+	printf("  address | bucketid   bucketid [key]\n") ;
+
+	// print table and buckets
+	int i ;
+	for (i = 0; i < table->size; i++) {
+		// table entry
+		printf("%9d | %-9d ", i, table->buckets[i]->id) ;
+
+		// if this is the first address at which a bucket occurs, print it now
+		if (table->buckets[i]->id == i) {
+			printf("%9d ", table->buckets[i]->id) ;
+
+			// print the bucket's contents, from inline prefix or arena
+			printf("[") ;
+			for(int j = 0; j < table->bucketsize; j++) {
+				if (j < table->buckets[i]->nkeys) {
+					Entry *entry = &table->buckets[i]->keys[j] ;
+					const char *bytes = entry->len > PREFIX_LEN ?
+					  table->arena.bytes + entry->offset : entry->prefix ;
+					printf(" %.*s", (int)entry->len, bytes) ;
+				} else {
+					printf(" -") ;
+				}
+			}
+			printf(" ]") ;
+		}
+		printf("\n") ;
+	}
+
+	printf("--- end table ---\n") ;
+}
+
+// prints statistics about an extendible string hash table to stdout
+void xtndbls_hash_table_stats(XtndblSHashTable *table) {
+	assert(table) ;
+
+	printf("\n----- table stats -----\n") ;
+
+	// print table info
+	printf("current table size:\t%d\n", table->size) ;
+	printf("number of keys    :\t%d\n", table->stats.nkeys) ;
+	printf("number of buckets :\t%d\n\n", table->stats.nbuckets) ;
+	printf("space usage factor:\t%.3f%%\n", table->stats.nkeys * 100.0 /
+	  (table->size * table->bucketsize)) ;
+	printf("bucket size       :\t%d\n", table->bucketsize) ;
+	printf("arena bytes used  :\t%llu of %llu\n", table->arena.used,
+	  table->arena.size) ;
+
+	// print how often comparisons had to go to the arena
+	printf("key comparisons   :\t%llu\n", table->stats.ncompares) ;
+	printf("  reading arena   :\t%llu\n", table->stats.narena) ;
+
+	// calculate print time details
+	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC ;
+	printf("CPU time spent    :\t%.6f sec\n", seconds) ;
+
+	printf("   --- end stats ---\n") ;
+}
+
+// writes metrics about an extendible string hash table to out as a JSON object
+void xtndbls_hash_table_metrics(XtndblSHashTable *table, FILE *out) {
+	assert(table) ;
+
+	// count buckets by their depth and by their number of keys
+	int64 *depths = calloc(table->depth + 1, sizeof *depths) ;
+	assert(depths) ;
+	int64 *occupancy = calloc(table->bucketsize + 1, sizeof *occupancy) ;
+	assert(occupancy) ;
+	int i ;
+	for (i=0; i<table->size; i++) {
+		if (table->buckets[i]->id == i) {
+			depths[table->buckets[i]->depth]++ ;
+			occupancy[table->buckets[i]->nkeys]++ ;
+		}
+	}
+
+	fprintf(out, "{\"size\":%d,\"depth\":%d,\"bucketsize\":%d,"
+	  "\"nbuckets\":%d,\"nkeys\":%d,\"ncompares\":%llu,\"narena\":%llu,"
+	  "\"arena_bytes\":%llu,\"cpu_secs\":%.6f,", table->size, table->depth,
+	  table->bucketsize, table->stats.nbuckets, table->stats.nkeys,
+	  table->stats.ncompares, table->stats.narena, table->arena.used,
+	  table->stats.time * 1.0 / CLOCKS_PER_SEC) ;
+
+	fprintf(out, "\"local_depths\":") ;
+	counts_json(depths, table->depth + 1, out) ;
+	fprintf(out, ",\"bucket_occupancy\":") ;
+	counts_json(occupancy, table->bucketsize + 1, out) ;
+	fprintf(out, ",\"resizes\":") ;
+	resize_log_json(&table->resizes, out) ;
+	fprintf(out, "}") ;
+
+	free(depths) ;
+	free(occupancy) ;
+}
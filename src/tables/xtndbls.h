@@ -0,0 +1,50 @@
+/* * * * * * * * *
+ * Dynamic hash table of variable-length string keys using extendible hashing
+ * with multiple keys per bucket. key bytes live in a per-table append-only
+ * arena, while buckets hold each key's hash, length and an inline prefix
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef XTNDBLS_H
+#define XTNDBLS_H
+
+#include   <stdio.h>
+#include <stdbool.h>
+#include "../inthash.h"
+
+typedef struct xtndbls_table XtndblSHashTable ;
+
+// initialises an extendible string hash table with the given keys per bucket
+XtndblSHashTable *new_xtndbls_hash_table(int bucketsize) ;
+
+// frees all memory associated with a given extendible string hash table
+void free_xtndbls_hash_table(XtndblSHashTable *table) ;
+
+// grows an extendible string hash table up front to the depth it would
+// reach holding expected_keys keys, so that loading them needs no doubling
+// and few splits
+void xtndbls_hash_table_reserve(XtndblSHashTable *table,
+  int64 expected_keys) ;
+
+// inserts a new key of len bytes into an extendible string hash table
+// returns true if successful, false if the key was already present
+bool xtndbls_hash_table_insert(XtndblSHashTable *table, const char *key,
+  int len) ;
+
+// looks up whether a key of len bytes is inside an extendible string table
+// returns true if found, false if not
+bool xtndbls_hash_table_lookup(XtndblSHashTable *table, const char *key,
+  int len) ;
+
+// prints the contents of an extendible string hash table to stdout
+void xtndbls_hash_table_print(XtndblSHashTable *table) ;
+
+// prints statistics about an extendible string hash table to stdout
+void xtndbls_hash_table_stats(XtndblSHashTable *table) ;
+
+// writes metrics about an extendible string hash table to out as a JSON
+// object, as for xtndbln_hash_table_metrics plus key comparison counts
+void xtndbls_hash_table_metrics(XtndblSHashTable *table, FILE *out) ;
+
+#endif
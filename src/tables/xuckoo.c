@@ -13,49 +13,27 @@
 #include   <time.h>
 
 #include "xuckoo.h"
+#include "xuckoo_fast.h"
+#include "../budget.h"
 
 #define FIRST_COUNT_MAX 20000
 #define FINAL_COUNT_MAX 21000
 
-// a bucket stores a single key, or is empty
-// it also knows how many bits are shared between possible keys, and the first 
-// table address that references it
-typedef struct bucket {
-	int		   id ; // a unique id for this bucket, equal to the first address
-				    // in the table which points to it
-	int		depth ; // how many hash value bits are being used by this bucket
-	bool	 full ; // does this bucket contain a key
-	int64	  key ; // the key stored in this bucket
-} Bucket ;
-
-// an inner table is an extendible hash table with an array of slots pointing 
-// to buckets holding up to 1 key, along with some information about the number 
-// of hash value bits to use for addressing
-typedef struct inner_table {
-	Bucket **buckets ;  // array of pointers to buckets
-	int		size ;      // how many entries in the table of pointers (2^depth)
-	int		depth ;     // how many bits of the hash value to use (log2(size))
-	int		nkeys ;     // how many keys are being stored in the table
-	int		nbuckets ;  // total number of buckets in table
-	int		id ;        // this table's id number (1 or 2)
-} InnerTable ;
-
-// a xuckoo hash table is just two inner tables for storing inserted keys
-struct xuckoo_table {
-	InnerTable *table1 ;
-	InnerTable *table2 ;
-	int			  time ; // CPU time elapsed
-} ;
-
-// macro to calculate the rightmost n bits of a number x
-#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
+// the table layout is defined in xuckoo_fast.h, for the inline fast paths
+typedef struct xuckoo_bucket      Bucket ;
+typedef struct xuckoo_inner_table InnerTable ;
 
 /* * * *
  * helper functions
  */
 
+// the bucket an inner table's table of pointers points to at address
+static Bucket *bucket_at(InnerTable *table, int64 address) {
+	return directory_get(&table->directory, address) ;
+}
+
 // creates a new empty bucket with first_address as its id
-static Bucket *new_bucket (int first_address, int depth) {
+static Bucket *new_bucket (int64 first_address, int depth) {
 
 	Bucket *bucket = malloc(sizeof *bucket) ;
 	assert(bucket) ;
@@ -63,19 +41,21 @@ static Bucket *new_bucket (int first_address, int depth) {
 	bucket->id = first_address ;
 	bucket->depth = depth ;
 	bucket->full = false ;
+	bucket->count = 0 ;
 
 	return bucket ;
 }
 
+// the memory taken by an inner table with a table of pointers of the given
+// size and the given number of buckets
+static int64 table_bytes(int64 size, int64 nbuckets) {
+	return size * sizeof(Bucket *) + nbuckets * sizeof(Bucket) ;
+}
+
 // initialises an empty InnerTable to be used in a larger XuckooHashTable
 static void initialise_in_table(InnerTable *table) {
-	assert(table->size < MAX_TABLE_SIZE &&
-	  "error: table has grown too large!") ;
-
-	table->buckets = malloc(sizeof *table->buckets) ;
-	assert(table->buckets) ;
-
-	table->buckets[0] = new_bucket(0, 0) ;
+	init_directory(&table->directory, 1) ;
+	directory_set(&table->directory, 0, new_bucket(0, 0)) ;
 
 	table->size = 1 ;
 	table->depth = 0 ;
@@ -84,9 +64,10 @@ static void initialise_in_table(InnerTable *table) {
 	table->id = 0 ;
 }
 
-// after splitting a bucket & removing its key, reinserts that key into table
-static void reinsert(InnerTable *table, int64 key) {
-	int address ;
+// after splitting a bucket & removing its key, reinserts that key (with its
+// count) into table
+static void reinsert(InnerTable *table, Key key, int64 count) {
+	int64 address ;
 	/* find if key was in table1 or table2 */
 	if (table->id == 1) {
 		address = rightmostnbits(table->depth, h1(key)) ;
@@ -95,124 +76,134 @@ static void reinsert(InnerTable *table, int64 key) {
 	}
 	/* ----------------------------------- */
 
-	table->buckets[address]->key = key ;
-	table->buckets[address]->full = true ;
+	Bucket *bucket = bucket_at(table, address) ;
+	bucket->key = key ;
+	bucket->count = count ;
+	bucket->full = true ;
 }
 
+static void insert_key(XuckooHashTable *hash_table, Key key, int64 count) ;
+
 // doubles the table of bucket pointers, duplicating pointers from 1st
-//  half of table into 2nd
+//  half of table into 2nd (sharing its segments until either changes)
 // once a new array of pointers is made, removes all keys from the innner table
 //  and inserts them again into the hash_table
 static void double_inner_table(XuckooHashTable *hash_table, InnerTable *table) {
 
-	int size = table->size * 2 ;
-	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!") ;
+	clock_t start = clock() ;
+	hash_table->ndoublings++ ;
+	int64 size = table->size * 2 ;
+	assert(within_memory_budget(table_bytes(size, table->nbuckets)) &&
+	  "error: table has grown too large!") ;
 
-	// create new array of double the number of bucket pointers
-	table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size) ;
-	assert (table->buckets) ;
-	// copy the pointers down the array
-	int i ;
-	for (i=0; i<table->size; i++) {
-		table->buckets[table->size + i] = table->buckets[i] ;
-	}
+	double_directory(&table->directory, table->size) ;
+	int64 i ;
 
 	// increase table size & depth
 	table->size = size ;
 	table->depth++ ;
 
 	// remove & reinsert all keys in newly doubled table
-	for (i=table->size-1; i>=0; i--) {
-		if (table->buckets[i]->full && table->buckets[i]->id == i) {
-			table->buckets[i]->full = false ;
+	for (i=table->size; i-- > 0; ) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->full && bucket->id == i) {
+			bucket->full = false ;
 			table->nkeys-- ;
-			xuckoo_hash_table_insert(hash_table, table->buckets[i]->key) ;
+			insert_key(hash_table, bucket->key, bucket->count) ;
 		}
 	}
+
+	resize_log_add(&hash_table->resizes, size, start) ;
 }
 
 // splits the bucket in a table at address, grows table if necessary
-static void split_xuck_bucket(XuckooHashTable *hash_table, InnerTable *table, int address) {
+static void split_xuck_bucket(XuckooHashTable *hash_table, InnerTable *table,
+  int64 address) {
 
 	// check if table growth is needed
-	if (table->buckets[address]->depth == table->depth) {
+	if (bucket_at(table, address)->depth == table->depth) {
 		double_inner_table(hash_table, table) ;
 	}
 
 	/* create new bucket and update depths of both */
-	Bucket *o_bucket = table->buckets[address] ;
+	Bucket *o_bucket = bucket_at(table, address) ;
 	int depth = o_bucket->depth ;
-	int first_address = o_bucket->id ;
+	int64 first_address = o_bucket->id ;
 
 	int new_depth = depth+1 ;
 	o_bucket->depth = new_depth ;
 
 	// new first address is 1 bit plus old first address
-	int new_first_address = 1 << depth | first_address ;
+	int64 new_first_address = (int64)1 << depth | first_address ;
 	Bucket *n_bucket = new_bucket(new_first_address, new_depth) ;
 	table->nbuckets++ ;
+	hash_table->nsplits++ ;
 	/* ------------------------------------------- */
 
 	/* redirect every second address from old bucket to new bucket
 		using joining of prefix & suffix to construct address      */
 
 	// suffix is 1 bit followed by previous bucket bit address
-	int bit_address = rightmostnbits(depth, first_address) ;
-	int suffix = (1 << depth) | bit_address ;
+	int64 bit_address = rightmostnbits(depth, first_address) ;
+	int64 suffix = ((int64)1 << depth) | bit_address ;
 
 	// prefix is all bitstrings of length equal to the difference
 	//   between the new bucket depth & the table depth
-	int max_pref = 1 << (table->depth - new_depth) ;
-	int prefix ;
+	int64 max_pref = (int64)1 << (table->depth - new_depth) ;
+	int64 prefix ;
 
 	for (prefix=0; prefix<max_pref; prefix++) {
 		// construct each address by joining prefix & suffix
-		int a = (prefix << new_depth) | suffix ;
+		int64 a = (prefix << new_depth) | suffix ;
 		// redirect this address in table to point to new bucket
-		table->buckets[a] = n_bucket ;
+		directory_set(&table->directory, a, n_bucket) ;
 	}
 	/* ----------------------------------------------------------- */
 	
 	// remove and reinsert the key
 	o_bucket->full = false ;
-	reinsert(table, o_bucket->key) ;
+	reinsert(table, o_bucket->key, o_bucket->count) ;
 }
 
-// inserts key into table
-// if the address is already taken, bumps the pre-existing key to the other
-//  table, continuing this process recursively.
+// inserts key, with its count key_count, into table
+// if the address is already taken, bumps the pre-existing key (and its count)
+//  to the other table, continuing this process recursively.
 // uses a count variable to guess whether it has made too many recursive calls,
 //  and if so, doubles the table
 static void in_table_insert(XuckooHashTable *hash_table, InnerTable *table,
-  InnerTable *other_table, int64 key, int count) {
+  InnerTable *other_table, Key key, int64 key_count, int count) {
 
 	count++ ;
 	/* find hash & address depending on which table was passed */
-	int hash ;
+	int64 hash ;
 	if (table->id == 1) {
 		hash = h1(key) ;
 	} else {
 		hash = h2(key) ;
 	}
-	int address = rightmostnbits(table->depth, hash) ;
+	int64 address = rightmostnbits(table->depth, hash) ;
 	/* ------------------------------------------------------- */
 
 	// if the address is free, insert the key immediately
-	if (!table->buckets[address]->full) {
-		table->buckets[address]->key = key ;
-		table->buckets[address]->full = true ;
+	Bucket *bucket = bucket_at(table, address) ;
+	if (!bucket->full) {
+		bucket->key = key ;
+		bucket->count = key_count ;
+		bucket->full = true ;
 		table->nkeys++ ;
 		return ;
 	}
 
 	// a key is already present, insert anyway & store the old key
-	int64 old_key = table->buckets[address]->key ;
-	table->buckets[address]->key = key ;
+	Key old_key = bucket->key ;
+	int64 old_count = bucket->count ;
+	bucket->key = key ;
+	bucket->count = key_count ;
 
 	/* if count reaches a lower limit AND is at a bucket with
 		more potential pointers, split bucket                 */
 	if (count >= FIRST_COUNT_MAX &&
-		(table->buckets[address]->depth != table->depth)) {
+		(bucket->depth != table->depth)) {
 		split_xuck_bucket(hash_table, table, address) ;
 	}
 	/* ------------------------------------------------------ */
@@ -225,7 +216,89 @@ static void in_table_insert(XuckooHashTable *hash_table, InnerTable *table,
 	/* ---------------------------------------------- */
 
 	// try to re-insert the old key in the other table
-	in_table_insert(hash_table, other_table, table, old_key, count) ;
+	in_table_insert(hash_table, other_table, table, old_key, old_count,
+	  count) ;
+}
+
+// inserts a key which isn't in the table, with the given count, into the
+// inner table with fewer keys
+static void insert_key(XuckooHashTable *hash_table, Key key, int64 count) {
+	if (hash_table->table1->nkeys <= hash_table->table2->nkeys) {
+		in_table_insert(hash_table, hash_table->table1,
+		  hash_table->table2, key, count, 0) ;
+	} else {
+		in_table_insert(hash_table, hash_table->table2,
+		  hash_table->table1, key, count, 0) ;
+	}
+}
+
+// the bucket holding a key in either inner table, or NULL if it isn't there
+static Bucket *find_bucket(XuckooHashTable *hash_table, Key key) {
+	Bucket *bucket_1 = bucket_at(hash_table->table1,
+	  rightmostnbits(hash_table->table1->depth, h1(key))) ;
+	if (bucket_1->full && bucket_1->key == key) {
+		return bucket_1 ;
+	}
+	Bucket *bucket_2 = bucket_at(hash_table->table2,
+	  rightmostnbits(hash_table->table2->depth, h2(key))) ;
+	if (bucket_2->full && bucket_2->key == key) {
+		return bucket_2 ;
+	}
+	return NULL ;
+}
+
+// rebuilds an inner table with a separate bucket at every address of a table
+//  of pointers with the given depth, then reinserts the keys it held
+static void rebuild_inner_table(XuckooHashTable *hash_table, InnerTable *table,
+  int depth) {
+
+	int64 size = (int64)1 << depth ;
+	assert(within_memory_budget(table_bytes(size, size)) &&
+	  "error: table has grown too large!") ;
+
+	/* take the keys (and counts) out of the table, freeing each bucket */
+	int64 nkeys = 0 ;
+	int64 i ;
+	for (i=table->size; i-- > 0; ) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->id == i && bucket->full) {
+			nkeys++ ;
+		}
+	}
+	Key *keys = malloc((sizeof *keys) * (nkeys + 1)) ;
+	assert(keys) ;
+	int64 *counts = malloc((sizeof *counts) * (nkeys + 1)) ;
+	assert(counts) ;
+	nkeys = 0 ;
+	for (i=table->size; i-- > 0; ) {
+		Bucket *bucket = bucket_at(table, i) ;
+		if (bucket->id == i) {
+			if (bucket->full) {
+				keys[nkeys] = bucket->key ;
+				counts[nkeys++] = bucket->count ;
+			}
+			free(bucket) ;
+		}
+	}
+	/* ----------------------------------------------------------------- */
+
+	/* create the new table of pointers & buckets */
+	free_directory(&table->directory) ;
+	init_directory(&table->directory, size) ;
+	for (i=0; i<size; i++) {
+		directory_set(&table->directory, i, new_bucket(i, depth)) ;
+	}
+	table->size = size ;
+	table->depth = depth ;
+	table->nkeys = 0 ;
+	table->nbuckets = size ;
+	/* ------------------------------------------ */
+
+	for (i=0; i<nkeys; i++) {
+		insert_key(hash_table, keys[i], counts[i]) ;
+	}
+	free(keys) ;
+	free(counts) ;
 }
 
 /* * * *
@@ -247,6 +320,9 @@ XuckooHashTable *new_xuckoo_hash_table() {
 	/* -------------------------------------------- */
 
 	hash_table->time = 0 ;
+	hash_table->nsplits = 0 ;
+	hash_table->ndoublings = 0 ;
+	clear_resize_log(&hash_table->resizes) ;
 	return hash_table ;
 }
 
@@ -255,22 +331,24 @@ void free_xuckoo_hash_table(XuckooHashTable *hash_table) {
 	assert(hash_table != NULL) ;
 
 	/* work backwards freeing each bucket in each table */
-	int i ;
-	for (i=hash_table->table1->size-1; i>=0; i--) {
-		if (hash_table->table1->buckets[i]->id == i) {
-			free(hash_table->table1->buckets[i]) ;
+	int64 i ;
+	for (i=hash_table->table1->size; i-- > 0; ) {
+		Bucket *bucket = bucket_at(hash_table->table1, i) ;
+		if (bucket->id == i) {
+			free(bucket) ;
 		}
 	}
-	for (i=hash_table->table2->size-1; i>=0; i--) {
-		if (hash_table->table2->buckets[i]->id == i) {
-			free(hash_table->table2->buckets[i]) ;
+	for (i=hash_table->table2->size; i-- > 0; ) {
+		Bucket *bucket = bucket_at(hash_table->table2, i) ;
+		if (bucket->id == i) {
+			free(bucket) ;
 		}
 	}
 	/* ------------------------------------------------ */
 	
-	/* free the buckets array, tables, & hash_table */
-	free(hash_table->table1->buckets) ;
-	free(hash_table->table2->buckets) ;
+	/* free the buckets arrays, tables, & hash_table */
+	free_directory(&hash_table->table1->directory) ;
+	free_directory(&hash_table->table2->directory) ;
 
 	free(hash_table->table1) ;
 	free(hash_table->table2) ;
@@ -279,60 +357,108 @@ void free_xuckoo_hash_table(XuckooHashTable *hash_table) {
 	/* -------------------------------------------- */
 }
 
+// grows both inner tables of an extendible cuckoo hash table up front so
+// that each has a bucket for every one of expected_keys keys, so that loading
+// them needs no doubling
+void xuckoo_hash_table_reserve(XuckooHashTable *hash_table,
+  int64 expected_keys) {
+	assert(hash_table != NULL) ;
+
+	// find the smallest depth with an address for every expected key, short
+	// of one which would put an inner table over budget
+	int depth = 0 ;
+	while (((int64)1 << depth) < expected_keys && within_memory_budget(
+	  table_bytes((int64)2 << depth, (int64)2 << depth))) {
+		depth++ ;
+	}
+
+	if (hash_table->table1->depth < depth) {
+		rebuild_inner_table(hash_table, hash_table->table1, depth) ;
+	}
+	if (hash_table->table2->depth < depth) {
+		rebuild_inner_table(hash_table, hash_table->table2, depth) ;
+	}
+}
+
 // inserts a new key into an extendible cuckoo hash table
 // returns true if successful, false if the key was already present
-bool xuckoo_hash_table_insert(XuckooHashTable *hash_table, int64 key) {
+bool xuckoo_hash_table_insert(XuckooHashTable *hash_table, Key key) {
 	assert(hash_table != NULL) ;
-	int start_time = clock() ;
+	clock_t start_time = clock() ;
 
 	// create addresses
-	int address_1 = rightmostnbits(hash_table->table1->depth, h1(key)) ;
-	int address_2 = rightmostnbits(hash_table->table2->depth, h2(key)) ;
+	int64 address_1 = rightmostnbits(hash_table->table1->depth, h1(key)) ;
+	int64 address_2 = rightmostnbits(hash_table->table2->depth, h2(key)) ;
 
 	/* check if key is already in either table */
-	if (hash_table->table1->buckets[address_1]->full &&
-	  (hash_table->table1->buckets[address_1]->key == key)) {
+	Bucket *bucket_1 = bucket_at(hash_table->table1, address_1) ;
+	Bucket *bucket_2 = bucket_at(hash_table->table2, address_2) ;
+	if (bucket_1->full && (bucket_1->key == key)) {
 		hash_table->time += clock() - start_time ;
 		return false ;
 	}
-	else if (hash_table->table2->buckets[address_2]->full &&
-	  (hash_table->table2->buckets[address_2]->key == key)) {
+	else if (bucket_2->full && (bucket_2->key == key)) {
 		hash_table->time += clock() - start_time ;
 		return false ;
 	}
 	/* --------------------------------------- */
 
-	/* insert in table with smallest number of keys */
-	if (hash_table->table1->nkeys <= hash_table->table2->nkeys) {
-		in_table_insert(hash_table, hash_table->table1,
-		  hash_table->table2, key, 0) ;
+	// insert in table with smallest number of keys
+	insert_key(hash_table, key, 0) ;
+
+	hash_table->time += clock() - start_time ;
+	return true ;
+}
+
+// adds delta to the count of a key in an extendible cuckoo hash table,
+// inserting it with a count of delta if it isn't there
+// returns true if the key was inserted, and stores its new count in *count
+bool xuckoo_hash_table_increment(XuckooHashTable *hash_table, Key key,
+  int64 delta, int64 *count) {
+	assert(hash_table != NULL) ;
+	clock_t start_time = clock() ;
+
+	Bucket *bucket = find_bucket(hash_table, key) ;
+	bool inserted = bucket == NULL ;
+	if (bucket) {
+		bucket->count += delta ;
+		*count = bucket->count ;
 	} else {
-		in_table_insert(hash_table, hash_table->table2,
-		  hash_table->table1, key, 0) ;
+		insert_key(hash_table, key, delta) ;
+		*count = delta ;
 	}
 
 	hash_table->time += clock() - start_time ;
-	return true ;
-		/* -------------------------------------------- */
+	return inserted ;
+}
+
+// the count of a key in an extendible cuckoo hash table, or 0 if it isn't
+// there
+int64 xuckoo_hash_table_count(XuckooHashTable *hash_table, Key key) {
+	assert(hash_table != NULL) ;
+	Bucket *bucket = find_bucket(hash_table, key) ;
+	return bucket ? bucket->count : 0 ;
 }
 
 
 // looks up whether a key is inside an extendible cuckoo hash table
 // returns true if found, false if not
-bool xuckoo_hash_table_lookup(XuckooHashTable *hash_table, int64 key) {
+bool xuckoo_hash_table_lookup(XuckooHashTable *hash_table, Key key) {
 	assert(hash_table) ;
-	int start_time = clock() ;
+	clock_t start_time = clock() ;
 
 	// calculate table addresses for this key
-	int address_1 = rightmostnbits(hash_table->table1->depth, h1(key)) ;
-	int address_2 = rightmostnbits(hash_table->table2->depth, h2(key)) ;
+	int64 address_1 = rightmostnbits(hash_table->table1->depth, h1(key)) ;
+	int64 address_2 = rightmostnbits(hash_table->table2->depth, h2(key)) ;
 
+	Bucket *bucket_1 = bucket_at(hash_table->table1, address_1) ;
+	Bucket *bucket_2 = bucket_at(hash_table->table2, address_2) ;
 	bool found = false ;
-	if (hash_table->table1->buckets[address_1]->full) {
-		found = hash_table->table1->buckets[address_1]->key == key ;
+	if (bucket_1->full) {
+		found = bucket_1->key == key ;
 	}
-	if (hash_table->table2->buckets[address_2]->full && !found) {
-		found = hash_table->table2->buckets[address_2]->key == key ;
+	if (bucket_2->full && !found) {
+		found = bucket_2->key == key ;
 	}
 
 	hash_table->time += clock() - start_time ;
@@ -340,6 +466,61 @@ bool xuckoo_hash_table_lookup(XuckooHashTable *hash_table, int64 key) {
 }
 
 
+// steps through the keys of an extendible cuckoo hash table, one per call
+// the cursor counts through table one's addresses then table two's, visiting
+// each full bucket from the first address pointing to it
+bool xuckoo_hash_table_next(XuckooHashTable *hash_table, int64 *cursor,
+  Key *key) {
+	assert(hash_table) ;
+
+	InnerTable *t1 = hash_table->table1 ;
+	InnerTable *t2 = hash_table->table2 ;
+	while (*cursor < t1->size + t2->size) {
+		InnerTable *table = (*cursor < t1->size) ? t1 : t2 ;
+		int64 address = (*cursor < t1->size) ? *cursor : *cursor - t1->size ;
+		(*cursor)++ ;
+
+		Bucket *bucket = bucket_at(table, address) ;
+		if (bucket->full && bucket->id == address) {
+			*key = bucket->key ;
+			return true ;
+		}
+	}
+	return false ;
+}
+
+
+// dumps the buckets of each inner table of an extendible cuckoo hash table
+// whose first addresses are in the dump's range
+void xuckoo_hash_table_dump(XuckooHashTable *table, Dump *dump) {
+	assert(table != NULL) ;
+	bool directory = dump_options(dump).directory ;
+
+	InnerTable *innertables[2] = {table->table1, table->table2} ;
+	int t ;
+	for (t = 0; t < 2; t++) {
+		InnerTable *inner = innertables[t] ;
+		char title[32] ;
+		sprintf(title, "table %d%s", inner->id, directory ? " directory" : "") ;
+		dump_section(dump, title) ;
+
+		int64 first, last, address ;
+		dump_range(dump, inner->size, &first, &last) ;
+		for (address = first; address < last; address++) {
+			Bucket *bucket = bucket_at(inner, address) ;
+			if (bucket->id != address) {
+				continue ;
+			}
+			if (directory) {
+				dump_bucket(dump, inner->id, address, bucket->depth,
+				  (int64)1 << (inner->depth - bucket->depth), bucket->full) ;
+			} else {
+				dump_slot(dump, inner->id, address, bucket->full, bucket->key) ;
+			}
+		}
+	}
+}
+
 // prints the contents of an extendible cuckoo hash table to stdout
 void xuckoo_hash_table_print(XuckooHashTable *table) {
 	assert(table != NULL) ;
@@ -347,6 +528,7 @@ void xuckoo_hash_table_print(XuckooHashTable *table) {
 	printf("--- table ---\n") ;
 
 	// loop through the two tables, printing them
+	char keystr[KEY_STR_LEN] ;
 	InnerTable *innertables[2] = {table->table1, table->table2} ;
 	int t ;
 	for (t = 0; t < 2; t++) {
@@ -357,16 +539,18 @@ void xuckoo_hash_table_print(XuckooHashTable *table) {
 		printf("  address | bucketid   bucketid [key]\n") ;
 		
 		// print table and buckets
-		int i ;
+		int64 i ;
 		for (i = 0; i < innertables[t]->size; i++) {
 			// table entry
-			printf("%9d | %-9d ", i, innertables[t]->buckets[i]->id) ;
+			Bucket *bucket = bucket_at(innertables[t], i) ;
+			printf("%9llu | %-9llu ", i, bucket->id) ;
 
 			// if this is the first address at which a bucket occurs, print it
-			if (innertables[t]->buckets[i]->id == i) {
-				printf("%9d ", innertables[t]->buckets[i]->id) ;
-				if (innertables[t]->buckets[i]->full) {
-					printf("[%llu]", innertables[t]->buckets[i]->key) ;
+			if (bucket->id == i) {
+				printf("%9llu ", bucket->id) ;
+				if (bucket->full) {
+					printf("[%s]",
+					  keytostr(bucket->key, keystr)) ;
 				} else {
 					printf("[ ]") ;
 				}
@@ -382,10 +566,10 @@ void xuckoo_hash_table_print(XuckooHashTable *table) {
 void xuckoo_hash_table_stats(XuckooHashTable *hash_table) {
 	
 	assert(hash_table != NULL) ;
-	int total_size = hash_table->table1->size + hash_table->table2->size ;
-	int total_buckets = hash_table->table1->nbuckets +
+	int64 total_size = hash_table->table1->size + hash_table->table2->size ;
+	int64 total_buckets = hash_table->table1->nbuckets +
 	  hash_table->table2->nbuckets ;
-	int total_keys = hash_table->table1->nkeys + hash_table->table2->nkeys ;
+	int64 total_keys = hash_table->table1->nkeys + hash_table->table2->nkeys ;
 	float seconds = hash_table->time * 1.0 / CLOCKS_PER_SEC ;
 
 	printf("\n----- table stats -----\n") ;
@@ -393,9 +577,9 @@ void xuckoo_hash_table_stats(XuckooHashTable *hash_table) {
 	// print high level cuckoo table info
 	printf("\n    --- overall ---\n") ;
 	printf("CPU time spent   :\t%.6f sec\n", seconds) ;
-	printf("total size       :\t%d potential slots\n", total_size) ;
-	printf("total keys       :\t%d\n", total_keys) ;
-	printf("total buckets    :\t%d\n", total_buckets) ;
+	printf("total size       :\t%llu potential slots\n", total_size) ;
+	printf("total keys       :\t%llu\n", total_keys) ;
+	printf("total buckets    :\t%llu\n", total_buckets) ;
 	printf("total space usage:\t%.3f%%\n", total_keys * 100.0 /
 	  total_size) ;
 	printf("    ---------------\n") ;
@@ -403,16 +587,16 @@ void xuckoo_hash_table_stats(XuckooHashTable *hash_table) {
 	// print internal table info
 	printf("\n    ---  inner  ---\n") ;
 	printf("table 1:\n") ;
-	printf("  size       :\t%d slots\n", hash_table->table1->size) ;
-	printf("  keys       :\t%d\n", hash_table->table1->nkeys) ;
-	printf("  buckets    :\t%d\n", hash_table->table1->nbuckets) ;
+	printf("  size       :\t%llu slots\n", hash_table->table1->size) ;
+	printf("  keys       :\t%llu\n", hash_table->table1->nkeys) ;
+	printf("  buckets    :\t%llu\n", hash_table->table1->nbuckets) ;
 	printf("  space usage:\t%.3f%%\n", hash_table->table1->nkeys * 100.0 /
 	  hash_table->table1->size) ;
 
 	printf("table 2:\n") ;
-	printf("  size   :\t%d slots\n", hash_table->table2->size) ;
-	printf("  keys   :\t%d\n", hash_table->table2->nkeys) ;
-	printf("  buckets:\t%d\n", hash_table->table2->nbuckets) ;
+	printf("  size   :\t%llu slots\n", hash_table->table2->size) ;
+	printf("  keys   :\t%llu\n", hash_table->table2->nkeys) ;
+	printf("  buckets:\t%llu\n", hash_table->table2->nbuckets) ;
 	printf("  space usage:\t%.3f%%\n", hash_table->table2->nkeys * 100.0 /
 	  hash_table->table2->size) ;
 	printf("    ---------------\n") ;
@@ -420,3 +604,25 @@ void xuckoo_hash_table_stats(XuckooHashTable *hash_table) {
 
 	return ;
 }
+
+// writes metrics about an extendible cuckoo hash table to out as a JSON object
+void xuckoo_hash_table_metrics(XuckooHashTable *hash_table, FILE *out) {
+	assert(hash_table != NULL) ;
+
+	fprintf(out, "{\"cpu_secs\":%.6f,\"nsplits\":%llu,\"ndoublings\":%llu,"
+	  "\"tables\":[", hash_table->time * 1.0 / CLOCKS_PER_SEC,
+	  hash_table->nsplits, hash_table->ndoublings) ;
+
+	InnerTable *innertables[2] = {hash_table->table1, hash_table->table2} ;
+	int t ;
+	for (t=0; t<2; t++) {
+		InnerTable *table = innertables[t] ;
+		fprintf(out, "%s{\"size\":%llu,\"depth\":%d,\"nkeys\":%llu,"
+		  "\"nbuckets\":%llu}", t ? "," : "", table->size, table->depth,
+		  table->nkeys, table->nbuckets) ;
+	}
+
+	fprintf(out, "],\"resizes\":") ;
+	resize_log_json(&hash_table->resizes, out) ;
+	fprintf(out, "}") ;
+}
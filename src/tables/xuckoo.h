@@ -10,8 +10,10 @@
 #ifndef XUCKOO_H
 #define XUCKOO_H
 
+#include   <stdio.h>
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../dump.h"
 
 typedef struct xuckoo_table XuckooHashTable ;
 
@@ -21,18 +23,52 @@ XuckooHashTable *new_xuckoo_hash_table() ;
 // frees all memory associated with a given extendible cuckoo hash table
 void free_xuckoo_hash_table(XuckooHashTable *hash_table) ;
 
+// grows both inner tables of an extendible cuckoo hash table up front so
+// that each has a bucket for every one of expected_keys keys, so that loading
+// them needs no doubling
+void xuckoo_hash_table_reserve(XuckooHashTable *hash_table,
+  int64 expected_keys) ;
+
 // inserts a new key into an extendible cuckoo hash table
 // returns true if successful, false if the key was already present
-bool xuckoo_hash_table_insert(XuckooHashTable *hash_table, int64 key) ;
+bool xuckoo_hash_table_insert(XuckooHashTable *hash_table, Key key) ;
 
 // looks up whether a key is inside an extendible cuckoo hash table
 // returns true if found, false if not
-bool xuckoo_hash_table_lookup(XuckooHashTable *hash_table, int64 key) ;
+bool xuckoo_hash_table_lookup(XuckooHashTable *hash_table, Key key) ;
+
+// adds delta to the count of a key in an extendible cuckoo hash table,
+// inserting it with a count of delta if it isn't there. a key inserted
+// without a count has a count of 0
+// returns true if the key was inserted, and stores its new count in *count
+bool xuckoo_hash_table_increment(XuckooHashTable *hash_table, Key key,
+  int64 delta, int64 *count) ;
+
+// the count of a key in an extendible cuckoo hash table, or 0 if it isn't
+// there
+int64 xuckoo_hash_table_count(XuckooHashTable *hash_table, Key key) ;
+
+// steps through the keys of an extendible cuckoo hash table, one per call:
+// set *cursor to 0 to start from the first key, then pass it back unchanged
+// for each next key. the table must not be changed between calls
+// returns true and stores the next key in *key, or false once all are seen
+bool xuckoo_hash_table_next(XuckooHashTable *hash_table, int64 *cursor,
+  Key *key) ;
 
 // prints the contents of an extendible cuckoo hash table to stdout
 void xuckoo_hash_table_print(XuckooHashTable *table) ;
 
+// dumps the buckets of each inner table of an extendible cuckoo hash table
+// whose first addresses are in the dump's range: the key of each, or for a
+// directory dump, a summary of each with the number of pointers to it
+void xuckoo_hash_table_dump(XuckooHashTable *table, Dump *dump) ;
+
 // prints statistics about an extendible cuckoo hash table to stdout
 void xuckoo_hash_table_stats(XuckooHashTable *hash_table) ;
 
+// writes metrics about an extendible cuckoo hash table to out as a JSON
+// object: each inner table's size, counts of bucket splits and doublings, and
+// a log of each time an inner table doubled
+void xuckoo_hash_table_metrics(XuckooHashTable *hash_table, FILE *out) ;
+
 #endif
@@ -0,0 +1,101 @@
+/* * * * * * * * *
+ * Header-inline fast paths for extendible cuckoo hash tables, for tight loops
+ * over a table whose type is known at compile time. also defines the table
+ * layout shared with xuckoo.c
+ *
+ * the fast paths skip the argument checks and CPU time accounting done by
+ * xuckoo_hash_table_insert and xuckoo_hash_table_lookup
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef XUCKOO_FAST_H
+#define XUCKOO_FAST_H
+
+#include "xuckoo.h"
+#include "../metrics.h"
+#include "../directory.h"
+
+// a bucket stores a single key, or is empty
+// it also knows how many bits are shared between possible keys, and the first 
+// table address that references it
+struct xuckoo_bucket {
+	int64	   id ; // a unique id for this bucket, equal to the first address
+				    // in the table which points to it
+	int		depth ; // how many hash value bits are being used by this bucket
+	bool	 full ; // does this bucket contain a key
+	Key		  key ; // the key stored in this bucket
+	int64	count ; // the key's count (0 unless it has been incremented)
+} ;
+
+// an inner table is an extendible hash table with an array of slots pointing 
+// to buckets holding up to 1 key, along with some information about the number 
+// of hash value bits to use for addressing
+struct xuckoo_inner_table {
+	Directory directory ; // table of pointers to buckets
+	int64	size ;      // how many entries in the table of pointers (2^depth)
+	int		depth ;     // how many bits of the hash value to use (log2(size))
+	int64	nkeys ;     // how many keys are being stored in the table
+	int64	nbuckets ;  // total number of buckets in table
+	int		id ;        // this table's id number (1 or 2)
+} ;
+
+// a xuckoo hash table is just two inner tables for storing inserted keys
+struct xuckoo_table {
+	struct xuckoo_inner_table *table1 ;
+	struct xuckoo_inner_table *table2 ;
+	int64		  time ; // CPU time elapsed
+	int64	   nsplits ; // number of buckets split
+	int64	ndoublings ; // number of times an inner table doubled
+	ResizeLog  resizes ; // each time an inner table doubled
+} ;
+
+// looks up whether a key is inside an extendible cuckoo hash table
+// returns true if found, false if not
+static inline bool xuckoo_hash_table_lookup_fast(XuckooHashTable *hash_table,
+  Key key) {
+	struct xuckoo_inner_table *t1 = hash_table->table1 ;
+	struct xuckoo_inner_table *t2 = hash_table->table2 ;
+	struct xuckoo_bucket *b1 = directory_get(&t1->directory,
+	  rightmostnbits(t1->depth, h1(key))) ;
+	struct xuckoo_bucket *b2 = directory_get(&t2->directory,
+	  rightmostnbits(t2->depth, h2(key))) ;
+
+	return (b1->full && b1->key == key) || (b2->full && b2->key == key) ;
+}
+
+// inserts a new key into an extendible cuckoo hash table
+// returns true if successful, false if the key was already present
+// only the common case of an empty bucket in the less loaded inner table is
+// handled inline, anything needing displacement goes through
+// xuckoo_hash_table_insert
+static inline bool xuckoo_hash_table_insert_fast(XuckooHashTable *hash_table,
+  Key key) {
+	if (xuckoo_hash_table_lookup_fast(hash_table, key)) {
+		return false ;
+	}
+
+	// same choice of inner table as xuckoo_hash_table_insert
+	struct xuckoo_inner_table *table ;
+	int64 hash ;
+	if (hash_table->table1->nkeys <= hash_table->table2->nkeys) {
+		table = hash_table->table1 ;
+		hash = h1(key) ;
+	} else {
+		table = hash_table->table2 ;
+		hash = h2(key) ;
+	}
+
+	struct xuckoo_bucket *bucket = directory_get(&table->directory,
+	  rightmostnbits(table->depth, hash)) ;
+	if (bucket->full) {
+		return xuckoo_hash_table_insert(hash_table, key) ;
+	}
+	bucket->key = key ;
+	bucket->count = 0 ;
+	bucket->full = true ;
+	table->nkeys++ ;
+	return true ;
+}
+
+#endif
@@ -0,0 +1,183 @@
+/* * * * * * * * *
+ * Binary operation traces: records of every insert and lookup given to a
+ * table, with the time at which it was given, for replaying later against
+ * any type of table
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include  <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include   <time.h>
+
+#include "trace.h"
+
+// identifies a file as a trace, followed by a version and the key width
+#define TRACE_MAGIC "HTTR"
+#define TRACE_VERSION 1
+
+// records are buffered in memory and written out in blocks of this size
+#define TRACE_BUFFER_SIZE 65536
+
+// the longest a single record can be: op, key, and a 64-bit LEB128 integer
+#define MAX_RECORD_LEN (1 + sizeof(Key) + 10)
+
+struct trace_writer {
+	FILE *file ;
+	unsigned char buffer[TRACE_BUFFER_SIZE] ;
+	int used ;          // number of bytes of the buffer in use
+	int64 start ;       // time at which recording started
+	int64 last ;        // time of the previous record
+} ;
+
+struct trace_reader {
+	FILE *file ;
+	int64 time ;        // time of the previous record, since the start
+} ;
+
+/* * * *
+ * helper functions
+ */
+
+// writes out the writer's buffered records
+static void flush_trace_writer(TraceWriter *writer) {
+	fwrite(writer->buffer, 1, writer->used, writer->file) ;
+	writer->used = 0 ;
+}
+
+/* * * *
+ * main functions
+ */
+
+// the current time in nanoseconds, from a monotonic clock
+int64 trace_now(void) {
+	struct timespec now ;
+	clock_gettime(CLOCK_MONOTONIC, &now) ;
+	return (int64)now.tv_sec * 1000000000 + now.tv_nsec ;
+}
+
+// creates a new trace file at path, to be written by a trace writer
+// returns NULL if the file couldn't be created
+TraceWriter *new_trace_writer(const char *path) {
+	FILE *file = fopen(path, "wb") ;
+	if (!file) {
+		return NULL ;
+	}
+
+	TraceWriter *writer = malloc(sizeof *writer) ;
+	assert(writer) ;
+	writer->file = file ;
+	writer->used = 0 ;
+	writer->start = trace_now() ;
+	writer->last = writer->start ;
+
+	// write the header: magic, version and key width
+	fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), file) ;
+	fputc(TRACE_VERSION, file) ;
+	fputc(KEY_BITS / 8, file) ;
+
+	return writer ;
+}
+
+// appends an operation (e.g. 'i' or 'l') on key to a trace, timestamped now
+void trace_record(TraceWriter *writer, char op, Key key) {
+	assert(writer) ;
+	if (writer->used + MAX_RECORD_LEN > TRACE_BUFFER_SIZE) {
+		flush_trace_writer(writer) ;
+	}
+
+	int64 now = trace_now() ;
+	int64 delta = now - writer->last ;
+	writer->last = now ;
+
+	unsigned char *out = writer->buffer + writer->used ;
+	*out++ = op ;
+	memcpy(out, &key, sizeof key) ;
+	out += sizeof key ;
+
+	// time since the previous record, 7 bits at a time, low bits first
+	do {
+		unsigned char byte = delta & 0x7f ;
+		delta >>= 7 ;
+		*out++ = byte | (delta ? 0x80 : 0) ;
+	} while (delta) ;
+
+	writer->used = out - writer->buffer ;
+}
+
+// flushes any buffered records, closes the trace file and frees the writer
+void free_trace_writer(TraceWriter *writer) {
+	assert(writer) ;
+	flush_trace_writer(writer) ;
+	fclose(writer->file) ;
+	free(writer) ;
+}
+
+// opens the trace file at path for reading
+// returns NULL if the file couldn't be opened, isn't a trace, or was
+// recorded with a different key width
+TraceReader *new_trace_reader(const char *path) {
+	FILE *file = fopen(path, "rb") ;
+	if (!file) {
+		return NULL ;
+	}
+
+	// check the header matches this build
+	char magic[4] ;
+	int version, width ;
+	if (fread(magic, 1, 4, file) != 4 ||
+	  memcmp(magic, TRACE_MAGIC, 4) != 0 ||
+	  (version = fgetc(file)) != TRACE_VERSION ||
+	  (width = fgetc(file)) != KEY_BITS / 8) {
+		fclose(file) ;
+		return NULL ;
+	}
+
+	TraceReader *reader = malloc(sizeof *reader) ;
+	assert(reader) ;
+	reader->file = file ;
+	reader->time = 0 ;
+	return reader ;
+}
+
+// reads the next record of a trace into *op, *key and *time, the nanoseconds
+// since the start of recording
+// returns false at the end of the trace
+bool trace_next(TraceReader *reader, char *op, Key *key, int64 *time) {
+	assert(reader) ;
+
+	int c = getc(reader->file) ;
+	if (c == EOF) {
+		return false ;
+	}
+	*op = c ;
+	if (fread(key, sizeof *key, 1, reader->file) != 1) {
+		return false ;
+	}
+
+	// time since the previous record, 7 bits at a time, low bits first
+	int64 delta = 0 ;
+	int shift = 0 ;
+	do {
+		if ((c = getc(reader->file)) == EOF) {
+			return false ;
+		}
+		delta |= (int64)(c & 0x7f) << shift ;
+		shift += 7 ;
+	} while (c & 0x80) ;
+
+	reader->time += delta ;
+	*time = reader->time ;
+	return true ;
+}
+
+// closes the trace file and frees the reader
+void free_trace_reader(TraceReader *reader) {
+	assert(reader) ;
+	fclose(reader->file) ;
+	free(reader) ;
+}
@@ -0,0 +1,48 @@
+/* * * * * * * * *
+ * Binary operation traces: records of every insert and lookup given to a
+ * table, with the time at which it was given, for replaying later against
+ * any type of table
+ *
+ * a trace file is a short header followed by one record per operation: the
+ * operation character, the key in KEY_BITS/8 bytes, and the nanoseconds since
+ * the previous record as a variable-length (LEB128) integer
+ *
+ * created by Maxim Kirkman <max.kirkman94@gmail.com>
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include "inthash.h"
+
+typedef struct trace_writer TraceWriter ;
+typedef struct trace_reader TraceReader ;
+
+// creates a new trace file at path, to be written by a trace writer
+// returns NULL if the file couldn't be created
+TraceWriter *new_trace_writer(const char *path) ;
+
+// appends an operation (e.g. 'i' or 'l') on key to a trace, timestamped now
+void trace_record(TraceWriter *writer, char op, Key key) ;
+
+// flushes any buffered records, closes the trace file and frees the writer
+void free_trace_writer(TraceWriter *writer) ;
+
+// opens the trace file at path for reading
+// returns NULL if the file couldn't be opened, isn't a trace, or was
+// recorded with a different key width
+TraceReader *new_trace_reader(const char *path) ;
+
+// reads the next record of a trace into *op, *key and *time, the nanoseconds
+// since the start of recording
+// returns false at the end of the trace
+bool trace_next(TraceReader *reader, char *op, Key *key, int64 *time) ;
+
+// closes the trace file and frees the reader
+void free_trace_reader(TraceReader *reader) ;
+
+// the current time in nanoseconds, from a monotonic clock
+int64 trace_now(void) ;
+
+#endif